@@ -0,0 +1,231 @@
+#include "AlbumArtProvider.h"
+#include "TagReader.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Image files next to a track, most specific first; matched ignoring case
+const char* const kFolderArt[] = {
+    "cover.jpg", "cover.png", "folder.jpg", "folder.png", "front.jpg", "front.png", "albumart.jpg",
+};
+
+// Requested sizes are rounded up to a few buckets so views share thumbnails
+int bucketFor(int size)
+{
+    static const int buckets[] = {64, 128, 256, 512, 1024};
+    for (int bucket : buckets) {
+        if (size <= bucket)
+            return bucket;
+    }
+    return buckets[std::size(buckets) - 1];
+}
+
+class AlbumArtResponse : public QQuickImageResponse, public QRunnable
+{
+public:
+    AlbumArtResponse(AlbumArtProvider* provider, const QString& trackPath, int size)
+        : m_provider(provider)
+        , m_trackPath(trackPath)
+        , m_size(size)
+    {
+        // The engine deletes the response once finished() has been emitted
+        setAutoDelete(false);
+    }
+
+    QQuickTextureFactory* textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    // A cancelled response still has to emit finished()
+    void cancel() override { m_cancelled = true; }
+
+    void run() override
+    {
+        if (!m_cancelled)
+            m_image = m_provider->thumbnail(m_trackPath, m_size, m_cancelled);
+        emit finished();
+    }
+
+private:
+    AlbumArtProvider* m_provider;
+    QString m_trackPath;
+    int m_size;
+    QImage m_image;
+    std::atomic<bool> m_cancelled{false};
+};
+
+} // namespace
+
+AlbumArtProvider::AlbumArtProvider()
+    : m_coverHashes(kCoverHashEntries)
+    , m_memory(kMemoryBudget, kMemoryShards)
+{
+    m_diskCache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/albumart";
+    QDir().mkpath(m_diskCache);
+
+    // Extraction is mostly file I/O; a few threads keep a scrolling grid fed
+    m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount(), 4));
+}
+
+AlbumArtProvider::~AlbumArtProvider()
+{
+    // Queued responses still run: they see the flag, skip the work and
+    // emit finished(), which the engine needs before it deletes them
+    m_shuttingDown = true;
+    m_pool.waitForDone();
+
+    const auto stats = m_memory.stats();
+    qDebug() << "Album art cache:" << stats.hits << "hits," << stats.misses << "misses,"
+             << stats.evictions << "evictions," << stats.weight / 1024 << "KiB held";
+}
+
+QString AlbumArtProvider::urlFor(const QString& trackPath)
+{
+    // Base64 keeps slashes and '%' in paths out of the URL's way
+    const QByteArray id = trackPath.toUtf8().toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals);
+    return QStringLiteral("image://%1/%2").arg(QLatin1String(kProviderId), QString::fromLatin1(id));
+}
+
+QQuickImageResponse* AlbumArtProvider::requestImageResponse(const QString& id, const QSize& requestedSize)
+{
+    const QString trackPath = QString::fromUtf8(
+        QByteArray::fromBase64(id.toLatin1(), QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+
+    const int requested = std::max(requestedSize.width(), requestedSize.height());
+    auto* response = new AlbumArtResponse(this, trackPath, bucketFor(requested > 0 ? requested : kDefaultSize));
+    m_pool.start(response);
+    return response;
+}
+
+QImage AlbumArtProvider::thumbnail(const QString& trackPath, int size, const std::atomic<bool>& cancelled)
+{
+    auto stopped = [&] { return cancelled || m_shuttingDown; };
+    if (stopped())
+        return QImage();
+
+    // Only the first request for a track reads and hashes its cover
+    QByteArray cover;
+    QByteArray coverHash;
+    if (const auto known = m_coverHashes.get(trackPath)) {
+        coverHash = *known;
+    } else {
+        cover = findCover(trackPath);
+        if (!cover.isEmpty())
+            coverHash = QCryptographicHash::hash(cover, QCryptographicHash::Sha1).toHex();
+        m_coverHashes.put(trackPath, coverHash);
+    }
+
+    if (coverHash.isEmpty())
+        return placeholder(size);
+
+    const QString key = QString::number(size) + ':' + QString::fromLatin1(coverHash);
+    if (const auto cached = m_memory.get(key))
+        return *cached;
+
+    if (stopped())
+        return QImage();
+
+    const QString file = diskPath(coverHash, size);
+    QImage image = QImageReader(file).read();
+
+    if (image.isNull()) {
+        if (cover.isEmpty())
+            cover = findCover(trackPath);
+        if (stopped())
+            return QImage();
+        image = decode(cover, size);
+
+        QSaveFile out(file);
+        if (!image.isNull() && QDir().mkpath(QFileInfo(file).path()) && out.open(QIODevice::WriteOnly)) {
+            if (!image.save(&out, "JPG", 90) || !out.commit())
+                qWarning() << "Cannot write album art thumbnail:" << file;
+        }
+    }
+
+    if (stopped())
+        return QImage();
+
+    // An undecodable cover is remembered as the placeholder
+    if (image.isNull())
+        image = placeholder(size);
+
+    m_memory.put(key, image);
+    return image;
+}
+
+QImage AlbumArtProvider::placeholder(int size)
+{
+    QMutexLocker locker(&m_placeholderLock);
+    auto it = m_placeholders.find(size);
+    if (it == m_placeholders.end()) {
+        QImage image;
+        QFile file(":/assests/default.jpg");
+        if (file.open(QIODevice::ReadOnly))
+            image = decode(file.readAll(), size);
+        it = m_placeholders.insert(size, image);
+    }
+    return *it;
+}
+
+QByteArray AlbumArtProvider::findCover(const QString& trackPath)
+{
+    QByteArray cover = TagReader::readCover(trackPath);
+    if (!cover.isEmpty())
+        return cover;
+
+    const QDir dir = QFileInfo(trackPath).dir();
+    QStringList filters;
+    for (const char* name : kFolderArt) {
+        filters << QLatin1String(name);
+    }
+
+    // Name filters match case-insensitively
+    const QStringList found = dir.entryList(filters, QDir::Files);
+    for (const char* name : kFolderArt) {
+        for (const QString& entry : found) {
+            if (entry.compare(QLatin1String(name), Qt::CaseInsensitive) != 0)
+                continue;
+
+            QFile file(dir.filePath(entry));
+            if (file.open(QIODevice::ReadOnly))
+                return file.readAll();
+        }
+    }
+
+    return QByteArray();
+}
+
+QImage AlbumArtProvider::decode(QByteArray data, int size)
+{
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    // Decoding at the scaled size lets the JPEG reader skip most of the work
+    QImageReader reader(&buffer);
+    const QSize full = reader.size();
+    if (full.isValid() && (full.width() > size || full.height() > size))
+        reader.setScaledSize(full.scaled(size, size, Qt::KeepAspectRatio));
+
+    return reader.read();
+}
+
+QString AlbumArtProvider::diskPath(const QByteArray& coverHash, int size) const
+{
+    // Two-character fan-out keeps directories small
+    return QStringLiteral("%1/%2/%3-%4.jpg")
+        .arg(m_diskCache, QString::fromLatin1(coverHash.left(2)), QString::fromLatin1(coverHash))
+        .arg(size);
+}
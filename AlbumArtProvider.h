@@ -0,0 +1,65 @@
+#ifndef ALBUMARTPROVIDER_H
+#define ALBUMARTPROVIDER_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QThreadPool>
+#include <atomic>
+#include "Cache.h"
+
+// Serves "image://albumart/<id>" URLs (see urlFor()) to QML.
+// Every request is answered on the provider's own pool, never the GUI
+// thread. A track's cover (embedded art, else cover.jpg / folder.jpg next
+// to it) is extracted and hashed once; thumbnails in memory and on disk are
+// keyed by that hash, so all tracks of an album share one image per size.
+// Only when both tiers miss is the cover decoded, straight to the requested
+// size via QImageReader, and written back.
+class AlbumArtProvider : public QQuickAsyncImageProvider
+{
+public:
+    static constexpr const char* kProviderId = "albumart";
+
+    AlbumArtProvider();
+    ~AlbumArtProvider() override;
+
+    QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+
+    static QString urlFor(const QString& trackPath);
+
+    // Runs on a pool thread; returns the placeholder if the track has no art
+    QImage thumbnail(const QString& trackPath, int size, const std::atomic<bool>& cancelled);
+
+private:
+    static QByteArray findCover(const QString& trackPath);
+    static QImage decode(QByteArray data, int size);
+    QString diskPath(const QByteArray& coverHash, int size) const;
+    QImage placeholder(int size);
+
+    QThreadPool m_pool;
+    QString m_diskCache;
+    std::atomic<bool> m_shuttingDown{false};
+
+    struct ImageWeigher {
+        size_t operator()(const QImage& image) const { return static_cast<size_t>(image.sizeInBytes()); }
+    };
+
+    // Track path -> hex SHA-1 of its cover; empty when the track has no art
+    ConcurrentLRUCache<QString, QByteArray> m_coverHashes;
+
+    // Decoded thumbnails keyed by "<size>:<cover hash>", bounded in bytes.
+    // The pool has at most four threads, so four shards barely contend
+    ConcurrentLRUCache<QString, QImage, ImageWeigher> m_memory;
+
+    // Decoded placeholder per size bucket
+    QMutex m_placeholderLock;
+    QHash<int, QImage> m_placeholders;
+
+    static constexpr int kDefaultSize = 256;
+    static constexpr size_t kMemoryBudget = 64 * 1024 * 1024;
+    static constexpr size_t kMemoryShards = 4;     // 16 MiB each; a 1024px thumbnail is 4 MiB
+    static constexpr size_t kCoverHashEntries = 16384;
+};
+
+#endif // ALBUMARTPROVIDER_H
@@ -0,0 +1,90 @@
+#ifndef AUDIOBLOCK_H
+#define AUDIOBLOCK_H
+
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <cstddef>
+
+// Non-owning view of one block of float samples, either interleaved (frame
+// after frame) or planar (one array per channel). Sample i of channel c is
+// channel(c)[i * stride()] in both layouts, so effects walk each channel in
+// place and nothing is ever deinterleaved into a scratch copy.
+class AudioBlock
+{
+public:
+    enum Layout {
+        Interleaved,
+        Planar
+    };
+
+    AudioBlock() = default;
+
+    static AudioBlock interleaved(float* samples, int frames, int channels, int sampleRate)
+    {
+        AudioBlock block;
+        block.m_layout = Interleaved;
+        block.m_samples = samples;
+        block.m_frames = frames;
+        block.m_channels = channels;
+        block.m_sampleRate = sampleRate;
+        return block;
+    }
+
+    // planes holds one pointer per channel and must outlive the block
+    static AudioBlock planar(float* const* planes, int frames, int channels, int sampleRate)
+    {
+        AudioBlock block;
+        block.m_layout = Planar;
+        block.m_planes = planes;
+        block.m_frames = frames;
+        block.m_channels = channels;
+        block.m_sampleRate = sampleRate;
+        return block;
+    }
+
+    // Invalid unless the buffer holds float samples
+    static AudioBlock fromBuffer(QAudioBuffer& buffer)
+    {
+        QAudioFormat format = buffer.format();
+        if (format.sampleFormat() != QAudioFormat::Float)
+            return AudioBlock();
+
+        AudioBlock block = interleaved(buffer.data<float>(), static_cast<int>(buffer.frameCount()),
+                                       format.channelCount(), format.sampleRate());
+        block.setLfeChannel(lfeChannelOf(format));
+        return block;
+    }
+
+    // Where the format has no channel layout, the usual one for its count
+    static int lfeChannelOf(QAudioFormat format)
+    {
+        if (format.channelConfig() == QAudioFormat::ChannelConfigUnknown)
+            format.setChannelConfig(QAudioFormat::defaultChannelConfigForChannelCount(format.channelCount()));
+        return format.channelOffset(QAudioFormat::LFE);
+    }
+
+    bool isValid() const { return m_frames >= 0 && m_channels > 0 && m_sampleRate > 0; }
+
+    Layout layout() const { return m_layout; }
+    int frameCount() const { return m_frames; }
+    int channelCount() const { return m_channels; }
+    int sampleRate() const { return m_sampleRate; }
+
+    size_t stride() const { return m_layout == Interleaved ? static_cast<size_t>(m_channels) : 1; }
+    float* channel(int c) const { return m_layout == Interleaved ? m_samples + c : m_planes[c]; }
+
+    // Low-frequency effects channel, -1 if there is none
+    int lfeChannel() const { return m_lfeChannel; }
+    void setLfeChannel(int channel) { m_lfeChannel = channel; }
+
+private:
+    Layout m_layout = Interleaved;
+    float* m_samples = nullptr;
+    float* const* m_planes = nullptr;
+    int m_frames = 0;
+    int m_channels = 0;
+    int m_sampleRate = 0;
+    int m_lfeChannel = -1;
+};
+
+#endif // AUDIOBLOCK_H
@@ -1,5 +1,6 @@
 #include "AudioController.h"
 #include "AudioException.h"
+#include "AudioEffect.h"
 #include <QUrl>
 #include <QFileInfo>
 #include <QProcess>
@@ -11,6 +12,12 @@
 #include <QRegularExpression>
 #include <QFile>
 
+namespace {
+
+constexpr int kFadeInMs = 1000;
+
+} // namespace
+
 // ==================== Constructor & Destructor ====================
 
 // Replace the AudioController constructor in AudioController.cpp with this:
@@ -19,12 +26,22 @@ AudioController::AudioController(QObject *parent)
     : QObject(parent)
     , m_player(new QMediaPlayer(this))
     , m_audioOutput(new QAudioOutput(this))
+    , m_pipeline(new AudioPipeline(this))
     , m_recommendationManager(new RecommendationManager(this))
 {
     // Setup audio output
     m_player->setAudioOutput(m_audioOutput);
     m_audioOutput->setVolume(m_volume);
 
+    // Effects processed on the pipeline's audio thread; their setters are
+    // lock-free, so the chain is only locked to insert them
+    auto equalizer = std::make_unique<EqualizerEffect>();
+    m_equalizer = equalizer.get();
+    m_pipeline->editEffects([&equalizer](EffectChain& chain) {
+        chain.addEffect(std::move(equalizer));
+    });
+    applyVolumeEffects();
+
     // Initialize fade timer
     m_fadeTimer = new QTimer(this);
     m_fadeTimer->setInterval(50);
@@ -48,6 +65,14 @@ AudioController::AudioController(QObject *parent)
     connect(m_player, &QMediaPlayer::mediaStatusChanged, this, &AudioController::onMediaStatusChanged);
     connect(m_player, &QMediaPlayer::errorOccurred, this, &AudioController::onErrorOccurred);
 
+    // Connect pipeline signals
+    connect(m_pipeline, &AudioPipeline::positionChanged, this, &AudioController::onPositionChanged);
+    connect(m_pipeline, &AudioPipeline::durationChanged, this, &AudioController::onDurationChanged);
+    connect(m_pipeline, &AudioPipeline::stateChanged, this, &AudioController::onPipelineStateChanged);
+    connect(m_pipeline, &AudioPipeline::mediaLoaded, this, &AudioController::onPipelineLoaded);
+    connect(m_pipeline, &AudioPipeline::endOfMedia, this, &AudioController::onPipelineEndOfMedia);
+    connect(m_pipeline, &AudioPipeline::errorOccurred, this, &AudioController::onPipelineError);
+
     // Connect recommendation manager signals
     connect(m_recommendationManager, &RecommendationManager::playYouTubeSong,
             this, &AudioController::playYouTubeAudio);
@@ -88,7 +113,12 @@ void AudioController::openFile(const QString &filePath)
         }
 
         QUrl url = QUrl::fromLocalFile(filePath);
-        m_player->setSource(url);
+        m_player->stop();
+        m_usePipeline = true;
+        m_pipeline->setSource(url);
+
+        m_mediaStatus = Loading;
+        emit mediaStatusChanged();
 
         m_currentTrack = Track(filePath);
         setTrackInfo(m_currentTrack.title(), m_currentTrack.artist());
@@ -242,6 +272,9 @@ void AudioController::playYouTubeAudio(const QString &query)
 
         // Configure media player for better streaming
         qDebug() << "Setting media source:" << audioUrl.left(50) + "...";
+        m_pipeline->stop();
+        m_usePipeline = false;
+        applyVolumeEffects();
         m_player->setSource(QUrl(audioUrl));
 
         // For network streams, add a small delay to allow buffering
@@ -270,7 +303,10 @@ void AudioController::playYouTubeAudio(const QString &query)
 
 void AudioController::play()
 {
-    m_player->play();
+    if (m_usePipeline)
+        m_pipeline->play();
+    else
+        m_player->play();
 
     if (m_fadeInEnabled) {
         startFadeIn();
@@ -279,7 +315,10 @@ void AudioController::play()
 
 void AudioController::pause()
 {
-    m_player->pause();
+    if (m_usePipeline)
+        m_pipeline->pause();
+    else
+        m_player->pause();
 
     if (m_fadeTimer->isActive()) {
         m_fadeTimer->stop();
@@ -290,14 +329,17 @@ void AudioController::seek(qint64 position)
 {
     // Ensure position is within valid range
     if (position < 0) position = 0;
-    if (m_player->duration() > 0 && position > m_player->duration()) {
-        position = m_player->duration();
+    if (duration() > 0 && position > duration()) {
+        position = duration();
     }
 
     // Only seek if the position actually changed significantly (>100ms difference)
     // to avoid unnecessary seeks during rapid slider movements
-    if (qAbs(m_player->position() - position) > 100) {
-        m_player->setPosition(position);
+    if (qAbs(this->position() - position) > 100) {
+        if (m_usePipeline)
+            m_pipeline->seek(position);
+        else
+            m_player->setPosition(position);
     }
 }
 
@@ -316,16 +358,18 @@ void AudioController::setVolume(qreal volume)
 
 qint64 AudioController::duration() const
 {
-    return m_player->duration();
+    return m_usePipeline ? m_pipeline->duration() : m_player->duration();
 }
 
 qint64 AudioController::position() const
 {
-    return m_player->position();
+    return m_usePipeline ? m_pipeline->position() : m_player->position();
 }
 
 bool AudioController::isPlaying() const
 {
+    if (m_usePipeline)
+        return m_pipeline->state() == AudioPipeline::Playing;
     return m_player->playbackState() == QMediaPlayer::PlayingState;
 }
 
@@ -390,6 +434,7 @@ void AudioController::setBalance(qreal balance)
     if (qFuzzyCompare(m_balance, balance)) return;
 
     m_balance = balance;
+    m_pipeline->setBalance(static_cast<float>(m_balance));
     emit balanceChanged();
 
     qDebug() << "Balance set to:" << m_balance;
@@ -403,6 +448,7 @@ void AudioController::setPlaybackRate(qreal rate)
 
     m_playbackRate = rate;
     m_player->setPlaybackRate(rate);
+    m_pipeline->setPlaybackRate(static_cast<float>(rate));
     emit playbackRateChanged();
 
     qDebug() << "Playback rate set to:" << m_playbackRate << "x";
@@ -418,9 +464,24 @@ void AudioController::setFadeInEnabled(bool enabled)
     qDebug() << "Fade in" << (enabled ? "enabled" : "disabled");
 }
 
+void AudioController::setEqualizerBand(int band, qreal gain)
+{
+    m_equalizer->setBand(band, static_cast<float>(gain));
+}
+
+void AudioController::setEqualizerPreset(const QString& presetName)
+{
+    m_equalizer->setPreset(presetName);
+
+    qDebug() << "Equalizer preset:" << presetName;
+}
+
 void AudioController::startFadeIn()
 {
-    if (m_fadeInEnabled && isPlaying()) {
+    if (m_fadeInEnabled && isPlaying() && m_usePipeline) {
+        m_pipeline->startFadeIn(kFadeInMs);
+        qDebug() << "Fade in started";
+    } else if (m_fadeInEnabled && isPlaying()) {
         m_fadeProgress = 0.0;
         applyVolumeEffects();
         m_fadeTimer->start();
@@ -442,12 +503,18 @@ void AudioController::resetEffects()
     }
 
     applyVolumeEffects();
+    setEqualizerPreset("Flat");
 
     qDebug() << "All effects reset to defaults";
 }
 
 void AudioController::applyVolumeEffects()
 {
+    // The pipeline applies gain and fade to the samples, so the boost is real
+    m_pipeline->setGain(static_cast<float>(m_volume * m_gainBoost));
+    if (m_usePipeline)
+        return;
+
     qreal effectiveVolume = m_volume * m_gainBoost;
 
     if (m_fadeInEnabled && m_fadeProgress < 1.0) {
@@ -653,6 +720,36 @@ void AudioController::onErrorOccurred(QMediaPlayer::Error error, const QString &
     emit mediaStatusChanged();
 }
 
+void AudioController::onPipelineStateChanged(AudioPipeline::State state)
+{
+    Q_UNUSED(state);
+    emit isPlayingChanged();
+}
+
+void AudioController::onPipelineLoaded()
+{
+    m_mediaStatus = Loaded;
+    qDebug() << "Media Status: Loaded";
+    emit mediaStatusChanged();
+}
+
+void AudioController::onPipelineEndOfMedia()
+{
+    qDebug() << "Media Status: End of Media";
+    if (m_libraryPlaybackEnabled) {
+        qDebug() << "Auto-playing next track...";
+        playNextInLibrary();
+    }
+    emit mediaStatusChanged();
+}
+
+void AudioController::onPipelineError(const QString &errorString)
+{
+    qWarning() << "Audio pipeline error:" << errorString;
+    m_mediaStatus = Error;
+    emit mediaStatusChanged();
+}
+
 void AudioController::playPreviousInLibrary()
 {
     // If not in library playback mode, just restart current track
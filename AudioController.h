@@ -10,6 +10,9 @@
 #include <vector>
 #include "Track.h"
 #include "RecommendationManager.h"
+#include "AudioPipeline.h"
+
+class EqualizerEffect;
 
 class AudioController : public QObject
 {
@@ -100,6 +103,8 @@ public:
     Q_INVOKABLE void setBalance(qreal balance);
     Q_INVOKABLE void setPlaybackRate(qreal rate);
     Q_INVOKABLE void setFadeInEnabled(bool enabled);
+    Q_INVOKABLE void setEqualizerBand(int band, qreal gain);
+    Q_INVOKABLE void setEqualizerPreset(const QString& presetName);
     Q_INVOKABLE void resetEffects();
 
     // Library Playback Methods
@@ -148,6 +153,12 @@ private slots:
     void onMediaStatusChanged(QMediaPlayer::MediaStatus status);
     void onErrorOccurred(QMediaPlayer::Error error, const QString &errorString);
 
+    // Pipeline event handlers
+    void onPipelineStateChanged(AudioPipeline::State state);
+    void onPipelineLoaded();
+    void onPipelineEndOfMedia();
+    void onPipelineError(const QString &errorString);
+
 private:
     // ==================== Private Methods ====================
     QString formatTime(qint64 milliseconds) const;
@@ -158,9 +169,13 @@ private:
 
     // ==================== Member Variables ====================
 
-    // Core media components
+    // Core media components: local files play through the pipeline so the
+    // effects run on their samples; network streams stay on QMediaPlayer
     QMediaPlayer *m_player;
     QAudioOutput *m_audioOutput;
+    AudioPipeline *m_pipeline;
+    EqualizerEffect *m_equalizer = nullptr;   // owned by the pipeline's effect chain
+    bool m_usePipeline = false;
 
     // Playback state
     qreal m_volume = 0.5;
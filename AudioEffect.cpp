@@ -3,15 +3,214 @@
 #include <algorithm>
 #include <QDebug>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 // ==================== EqualizerEffect ====================
 
+namespace {
+
+// Four float lanes: SSE, NEON, or plain arrays where neither is available
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+using Vec4 = __m128;
+inline Vec4 vLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void vStore(float* p, Vec4 v) { _mm_storeu_ps(p, v); }
+inline Vec4 vLoad2(const float* p) { return _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(p)); }
+inline void vStore2(float* p, Vec4 v) { _mm_storel_pi(reinterpret_cast<__m64*>(p), v); }
+inline Vec4 vSet(float x) { return _mm_set1_ps(x); }
+inline Vec4 vAdd(Vec4 a, Vec4 b) { return _mm_add_ps(a, b); }
+inline Vec4 vSub(Vec4 a, Vec4 b) { return _mm_sub_ps(a, b); }
+inline Vec4 vMul(Vec4 a, Vec4 b) { return _mm_mul_ps(a, b); }
+#elif defined(__ARM_NEON)
+using Vec4 = float32x4_t;
+inline Vec4 vLoad(const float* p) { return vld1q_f32(p); }
+inline void vStore(float* p, Vec4 v) { vst1q_f32(p, v); }
+inline Vec4 vLoad2(const float* p) { return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f)); }
+inline void vStore2(float* p, Vec4 v) { vst1_f32(p, vget_low_f32(v)); }
+inline Vec4 vSet(float x) { return vdupq_n_f32(x); }
+inline Vec4 vAdd(Vec4 a, Vec4 b) { return vaddq_f32(a, b); }
+inline Vec4 vSub(Vec4 a, Vec4 b) { return vsubq_f32(a, b); }
+inline Vec4 vMul(Vec4 a, Vec4 b) { return vmulq_f32(a, b); }
+#else
+struct Vec4 {
+    float v[4];
+};
+inline Vec4 vLoad(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void vStore(float* p, Vec4 v) { std::copy(v.v, v.v + 4, p); }
+inline Vec4 vLoad2(const float* p) { return {{p[0], p[1], 0.0f, 0.0f}}; }
+inline void vStore2(float* p, Vec4 v) { std::copy(v.v, v.v + 2, p); }
+inline Vec4 vSet(float x) { return {{x, x, x, x}}; }
+inline Vec4 vAdd(Vec4 a, Vec4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline Vec4 vSub(Vec4 a, Vec4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline Vec4 vMul(Vec4 a, Vec4 b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+#endif
+
+constexpr int kLanes = 4;
+constexpr int kStatePerGroup = EqualizerEffect::BAND_COUNT * 2 * kLanes;
+constexpr float kFlatGain = 0.01f;          // dB; flatter bands are skipped
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kPeakQ = 1.41421356237;    // one octave
+constexpr double kBassFrequency = 100.0;
+constexpr int kRampMs = 30;                 // parameter changes are spread over this
+
+int rampFrames(int sampleRate)
+{
+    return sampleRate * kRampMs / 1000;
+}
+
+size_t equalizerStateSize(int channels)
+{
+    return static_cast<size_t>((channels + kLanes - 1) / kLanes) * kStatePerGroup;
+}
+
+enum FilterShape {
+    LowShelf,
+    Peaking,
+    HighShelf
+};
+
+// RBJ audio EQ cookbook; gain in dB, shelves with slope S = 1
+BiquadCoefficients designBiquad(FilterShape shape, double frequency, float gain, int sampleRate)
+{
+    const double A = std::pow(10.0, gain / 40.0);
+    const double w0 = 2.0 * kPi * frequency / sampleRate;
+    const double cosW = std::cos(w0);
+    const double sinW = std::sin(w0);
+
+    double b0, b1, b2, a0, a1, a2;
+    if (shape != Peaking) {
+        const double twoSqrtAAlpha = 2.0 * std::sqrt(A) * sinW / 2.0 * std::sqrt(2.0);
+        if (shape == LowShelf) {
+            b0 = A * ((A + 1) - (A - 1) * cosW + twoSqrtAAlpha);
+            b1 = 2 * A * ((A - 1) - (A + 1) * cosW);
+            b2 = A * ((A + 1) - (A - 1) * cosW - twoSqrtAAlpha);
+            a0 = (A + 1) + (A - 1) * cosW + twoSqrtAAlpha;
+            a1 = -2 * ((A - 1) + (A + 1) * cosW);
+            a2 = (A + 1) + (A - 1) * cosW - twoSqrtAAlpha;
+        } else {
+            b0 = A * ((A + 1) + (A - 1) * cosW + twoSqrtAAlpha);
+            b1 = -2 * A * ((A - 1) + (A + 1) * cosW);
+            b2 = A * ((A + 1) + (A - 1) * cosW - twoSqrtAAlpha);
+            a0 = (A + 1) - (A - 1) * cosW + twoSqrtAAlpha;
+            a1 = 2 * ((A - 1) - (A + 1) * cosW);
+            a2 = (A + 1) - (A - 1) * cosW - twoSqrtAAlpha;
+        }
+    } else {
+        const double alpha = sinW / (2.0 * kPeakQ);
+        b0 = 1 + alpha * A;
+        b1 = -2 * cosW;
+        b2 = 1 - alpha * A;
+        a0 = 1 + alpha / A;
+        a1 = -2 * cosW;
+        a2 = 1 - alpha / A;
+    }
+
+    return {static_cast<float>(b0 / a0), static_cast<float>(b1 / a0), static_cast<float>(b2 / a0),
+            static_cast<float>(a1 / a0), static_cast<float>(a2 / a0)};
+}
+
+BiquadCoefficients equalizerSection(int band, float gain, int sampleRate)
+{
+    const FilterShape shape = band == 0 ? LowShelf
+                            : band == EqualizerEffect::BAND_COUNT - 1 ? HighShelf
+                            : Peaking;
+    return designBiquad(shape, EqualizerEffect::BAND_FREQUENCIES[band], gain, sampleRate);
+}
+
+// Channels [first, first + lanes) through the whole cascade, one frame at a
+// time; state holds z1/z2 per band, bands[s] being the band of section s.
+// Four or two adjacent interleaved channels are loaded directly, anything
+// else is gathered in place. Stereo leaves two lanes idle: each section
+// needs the previous frame's output, so frames cannot share a vector.
+void processLanes(const AudioBlock& block, int first, int lanes, const BiquadCoefficients* sections,
+                  const int* bands, int sectionCount, float* state)
+{
+    Vec4 b0[EqualizerEffect::BAND_COUNT], b1[EqualizerEffect::BAND_COUNT];
+    Vec4 b2[EqualizerEffect::BAND_COUNT], a1[EqualizerEffect::BAND_COUNT];
+    Vec4 a2[EqualizerEffect::BAND_COUNT];
+    Vec4 z1[EqualizerEffect::BAND_COUNT], z2[EqualizerEffect::BAND_COUNT];
+
+    for (int s = 0; s < sectionCount; ++s) {
+        b0[s] = vSet(sections[s].b0);
+        b1[s] = vSet(sections[s].b1);
+        b2[s] = vSet(sections[s].b2);
+        a1[s] = vSet(sections[s].a1);
+        a2[s] = vSet(sections[s].a2);
+        z1[s] = vLoad(state + (2 * bands[s]) * kLanes);
+        z2[s] = vLoad(state + (2 * bands[s] + 1) * kLanes);
+    }
+
+    float* lane[kLanes];
+    for (int k = 0; k < lanes; ++k) {
+        lane[k] = block.channel(first + k);
+    }
+    const size_t stride = block.stride();
+    const bool interleaved = block.layout() == AudioBlock::Interleaved;
+    const bool contiguous = lanes == kLanes && interleaved;
+    const bool pair = lanes == 2 && interleaved;
+    const int frames = block.frameCount();
+
+    float partial[kLanes] = {};
+    for (int i = 0; i < frames; ++i) {
+        const size_t offset = static_cast<size_t>(i) * stride;
+
+        Vec4 x;
+        if (contiguous) {
+            x = vLoad(lane[0] + offset);
+        } else if (pair) {
+            x = vLoad2(lane[0] + offset);
+        } else {
+            for (int k = 0; k < lanes; ++k) {
+                partial[k] = lane[k][offset];
+            }
+            x = vLoad(partial);
+        }
+
+        for (int s = 0; s < sectionCount; ++s) {
+            const Vec4 y = vAdd(vMul(b0[s], x), z1[s]);
+            z1[s] = vAdd(vSub(vMul(b1[s], x), vMul(a1[s], y)), z2[s]);
+            z2[s] = vSub(vMul(b2[s], x), vMul(a2[s], y));
+            x = y;
+        }
+
+        if (contiguous) {
+            vStore(lane[0] + offset, x);
+        } else if (pair) {
+            vStore2(lane[0] + offset, x);
+        } else {
+            vStore(partial, x);
+            for (int k = 0; k < lanes; ++k) {
+                lane[k][offset] = partial[k];
+            }
+        }
+    }
+
+    for (int s = 0; s < sectionCount; ++s) {
+        vStore(state + (2 * bands[s]) * kLanes, z1[s]);
+        vStore(state + (2 * bands[s] + 1) * kLanes, z2[s]);
+    }
+}
+
+} // namespace
+
+// ==================== AudioEffect ====================
+
+void AudioEffect::apply(QAudioBuffer& buffer)
+{
+    const AudioBlock block = AudioBlock::fromBuffer(buffer);
+    beginBlock();
+    if (m_enabled && block.isValid()) {
+        process(block);
+    }
+}
+
 EqualizerEffect::EqualizerEffect()
     : AudioEffect("Equalizer")
 {
-    // Initialize all bands to 0 dB (no change)
-    for (int i = 0; i < BAND_COUNT; ++i) {
-        m_bands[i] = 0.0f;
-    }
+    // All bands start at 0 dB (no change)
 }
 
 EqualizerEffect::~EqualizerEffect()
@@ -19,20 +218,47 @@ EqualizerEffect::~EqualizerEffect()
     qDebug() << "EqualizerEffect destroyed";
 }
 
-void EqualizerEffect::apply(QAudioBuffer& buffer)
+void EqualizerEffect::process(const AudioBlock& block)
 {
-    if (!m_enabled || buffer.format().sampleFormat() != QAudioFormat::Float) {
+    if (!m_enabled) {
         return;
     }
 
-    float* data = buffer.data<float>();
-    int sampleCount = buffer.sampleCount();
+    // Never allocates here; a block wider than prepared for passes through
+    const int sampleRate = block.sampleRate();
+    const int channels = block.channelCount();
+    if (m_state.size() < equalizerStateSize(channels)) {
+        return;
+    }
 
-    // Apply each band filter
-    for (int band = 0; band < BAND_COUNT; ++band) {
-        if (std::abs(m_bands[band]) > 0.01f) {
-            applyBandFilter(data, sampleCount, band, m_bands[band]);
+    bool rebuild = false;
+    if (sampleRate != m_sampleRate || channels != m_channels) {
+        m_sampleRate = sampleRate;
+        m_channels = channels;
+        std::fill(m_state.begin(), m_state.end(), 0.0f);
+        m_activeBands = 0;
+        for (auto& gain : m_bands) {
+            gain.setRampLength(rampFrames(sampleRate));
         }
+        rebuild = true;
+    }
+
+    // While any gain ramps, every block gets coefficients for where the
+    // ramp will be at its end
+    for (auto& gain : m_bands) {
+        rebuild |= gain.update();
+    }
+    if (rebuild) {
+        updateSections(block.frameCount());
+    }
+    if (m_sectionCount == 0) {
+        return;
+    }
+
+    for (int first = 0; first < channels; first += kLanes) {
+        float* state = m_state.data() + static_cast<size_t>(first / kLanes) * kStatePerGroup;
+        processLanes(block, first, std::min(kLanes, channels - first), m_sections, m_sectionBands,
+                     m_sectionCount, state);
     }
 }
 
@@ -40,81 +266,117 @@ AudioEffect* EqualizerEffect::clone() const
 {
     EqualizerEffect* eq = new EqualizerEffect();
     for (int i = 0; i < BAND_COUNT; ++i) {
-        eq->m_bands[i] = m_bands[i];
+        eq->m_bands[i].set(m_bands[i].target());
     }
     eq->setEnabled(isEnabled());
     return eq;
 }
 
+void EqualizerEffect::clearState()
+{
+    for (auto& gain : m_bands) {
+        gain.snap();
+    }
+    m_sampleRate = 0;   // rebuilds the cascade with empty state
+}
+
+void EqualizerEffect::prepare(int sampleRate, int channels)
+{
+    Q_UNUSED(sampleRate);
+    if (m_state.size() < equalizerStateSize(channels)) {
+        m_state.resize(equalizerStateSize(channels), 0.0f);
+    }
+}
+
 void EqualizerEffect::setBand(int band, float gain)
 {
     if (band >= 0 && band < BAND_COUNT) {
-        m_bands[band] = std::clamp(gain, -12.0f, 12.0f);
+        m_bands[band].set(std::clamp(gain, -12.0f, 12.0f));
     }
 }
 
 float EqualizerEffect::getBand(int band) const
 {
     if (band >= 0 && band < BAND_COUNT) {
-        return m_bands[band];
+        return m_bands[band].target();
     }
     return 0.0f;
 }
 
 void EqualizerEffect::setPreset(const QString& presetName)
 {
-    // Reset all bands
-    for (int i = 0; i < BAND_COUNT; ++i) {
-        m_bands[i] = 0.0f;
-    }
+    // Bands a preset does not name stay flat
+    float gains[BAND_COUNT] = {};
 
     if (presetName == "Rock") {
-        m_bands[0] = 5.0f;   // 32 Hz
-        m_bands[1] = 3.0f;   // 64 Hz
-        m_bands[2] = -2.0f;  // 125 Hz
-        m_bands[3] = -3.0f;  // 250 Hz
-        m_bands[4] = -1.0f;  // 500 Hz
-        m_bands[5] = 2.0f;   // 1 kHz
-        m_bands[6] = 4.0f;   // 2 kHz
-        m_bands[7] = 5.0f;   // 4 kHz
-        m_bands[8] = 5.0f;   // 8 kHz
-        m_bands[9] = 5.0f;   // 16 kHz
+        gains[0] = 5.0f;   // 32 Hz
+        gains[1] = 3.0f;   // 64 Hz
+        gains[2] = -2.0f;  // 125 Hz
+        gains[3] = -3.0f;  // 250 Hz
+        gains[4] = -1.0f;  // 500 Hz
+        gains[5] = 2.0f;   // 1 kHz
+        gains[6] = 4.0f;   // 2 kHz
+        gains[7] = 5.0f;   // 4 kHz
+        gains[8] = 5.0f;   // 8 kHz
+        gains[9] = 5.0f;   // 16 kHz
     }
     else if (presetName == "Jazz") {
-        m_bands[0] = 4.0f;
-        m_bands[1] = 3.0f;
-        m_bands[2] = 1.0f;
-        m_bands[3] = 2.0f;
-        m_bands[4] = -2.0f;
-        m_bands[5] = -2.0f;
-        m_bands[6] = 0.0f;
-        m_bands[7] = 2.0f;
-        m_bands[8] = 3.0f;
-        m_bands[9] = 4.0f;
+        gains[0] = 4.0f;
+        gains[1] = 3.0f;
+        gains[2] = 1.0f;
+        gains[3] = 2.0f;
+        gains[4] = -2.0f;
+        gains[5] = -2.0f;
+        gains[6] = 0.0f;
+        gains[7] = 2.0f;
+        gains[8] = 3.0f;
+        gains[9] = 4.0f;
     }
     else if (presetName == "Classical") {
-        m_bands[0] = 4.0f;
-        m_bands[1] = 3.0f;
-        m_bands[2] = 2.0f;
-        m_bands[3] = 1.0f;
-        m_bands[4] = -1.0f;
-        m_bands[5] = -1.0f;
-        m_bands[6] = 0.0f;
-        m_bands[7] = 1.0f;
-        m_bands[8] = 3.0f;
-        m_bands[9] = 4.0f;
+        gains[0] = 4.0f;
+        gains[1] = 3.0f;
+        gains[2] = 2.0f;
+        gains[3] = 1.0f;
+        gains[4] = -1.0f;
+        gains[5] = -1.0f;
+        gains[6] = 0.0f;
+        gains[7] = 1.0f;
+        gains[8] = 3.0f;
+        gains[9] = 4.0f;
+    }
+
+    for (int i = 0; i < BAND_COUNT; ++i) {
+        m_bands[i].set(gains[i]);
     }
 }
 
-void EqualizerEffect::applyBandFilter(float* samples, int sampleCount, int band, float gain)
+void EqualizerEffect::updateSections(int frames)
 {
-    // Simplified gain application (in a real implementation, use proper filters)
-    float linearGain = std::pow(10.0f, gain / 20.0f);
+    // Bands at or near Nyquist (16 kHz at 32 kHz) are left out; so are flat
+    // ones, which only leave once they have finished ramping to 0 dB
+    int activeBands = 0;
+    m_sectionCount = 0;
+    for (int band = 0; band < BAND_COUNT; ++band) {
+        const float gain = m_bands[band].skip(frames);
+        if ((std::abs(gain) < kFlatGain && !m_bands[band].isRamping())
+            || BAND_FREQUENCIES[band] >= 0.45f * m_sampleRate) {
+            continue;
+        }
 
-    for (int i = 0; i < sampleCount; ++i) {
-        samples[i] *= linearGain;
-        samples[i] = std::clamp(samples[i], -1.0f, 1.0f);
+        m_sections[m_sectionCount] = equalizerSection(band, gain, m_sampleRate);
+        m_sectionBands[m_sectionCount] = band;
+        ++m_sectionCount;
+        activeBands |= 1 << band;
+
+        // A band joining the cascade starts near 0 dB, so empty memory fits
+        if (!(m_activeBands & (1 << band))) {
+            for (size_t group = 0; group < m_state.size(); group += kStatePerGroup) {
+                float* state = m_state.data() + group + 2 * band * kLanes;
+                std::fill(state, state + 2 * kLanes, 0.0f);
+            }
+        }
     }
+    m_activeBands = activeBands;
 }
 
 // ==================== ReverbEffect ====================
@@ -126,7 +388,6 @@ ReverbEffect::ReverbEffect()
     , m_wetDryMix(0.3f)
     , m_delayBufferPos(0)
 {
-    m_delayBuffer.resize(48000);  // 1 second at 48kHz
 }
 
 ReverbEffect::~ReverbEffect()
@@ -134,53 +395,113 @@ ReverbEffect::~ReverbEffect()
     qDebug() << "ReverbEffect destroyed";
 }
 
-void ReverbEffect::apply(QAudioBuffer& buffer)
+void ReverbEffect::process(const AudioBlock& block)
 {
-    if (!m_enabled || buffer.format().sampleFormat() != QAudioFormat::Float) {
+    if (!m_enabled) {
         return;
     }
 
-    float* data = buffer.data<float>();
-    int sampleCount = buffer.sampleCount();
-    int delaySize = static_cast<int>(m_delayBuffer.size());
+    // Never allocates here; a block wider than prepared for stays dry
+    const int channels = block.channelCount();
+    if (static_cast<int>(m_delayLines.size()) < channels) {
+        return;
+    }
 
-    for (int i = 0; i < sampleCount; ++i) {
-        float dry = data[i];
-        float wet = m_delayBuffer[m_delayBufferPos];
+    if (block.sampleRate() != m_sampleRate) {
+        m_sampleRate = block.sampleRate();
+        m_delaySize = std::min(m_sampleRate, kMaxDelayFrames);
+        for (auto& line : m_delayLines) {
+            std::fill(line.begin(), line.begin() + m_delaySize, 0.0f);
+        }
+        m_delayBufferPos = 0;
+        m_roomSize.setRampLength(rampFrames(m_sampleRate));
+        m_damping.setRampLength(rampFrames(m_sampleRate));
+        m_wetDryMix.setRampLength(rampFrames(m_sampleRate));
+    }
 
-        // Mix wet and dry signals
-        data[i] = dry * (1.0f - m_wetDryMix) + wet * m_wetDryMix;
+    m_roomSize.update();
+    m_damping.update();
+    m_wetDryMix.update();
+
+    const int delaySize = m_delaySize;
+    const int frames = block.frameCount();
+    const size_t stride = block.stride();
+    const int lfe = block.lfeChannel();
+    int pos = m_delayBufferPos;
+
+    // Frame by frame so every channel sees the same ramped parameters
+    for (int i = 0; i < frames; ++i) {
+        const float mix = m_wetDryMix.next();
+        const float feedback = m_damping.next() * m_roomSize.next();
+        const size_t offset = static_cast<size_t>(i) * stride;
+
+        for (int c = 0; c < channels; ++c) {
+            if (c == lfe) {
+                continue;
+            }
+
+            float& sample = block.channel(c)[offset];
+            float& delayed = m_delayLines[c][pos];
+            const float dry = sample;
+            const float wet = delayed;
+
+            // Mix wet and dry signals
+            sample = dry * (1.0f - mix) + wet * mix;
+
+            // Update delay line
+            delayed = dry + wet * feedback;
+        }
 
-        // Update delay buffer
-        m_delayBuffer[m_delayBufferPos] = dry + wet * m_damping * m_roomSize;
+        if (++pos == delaySize) {
+            pos = 0;
+        }
+    }
 
-        m_delayBufferPos = (m_delayBufferPos + 1) % delaySize;
+    m_delayBufferPos = pos;
+}
+
+void ReverbEffect::clearState()
+{
+    for (auto& line : m_delayLines) {
+        std::fill(line.begin(), line.begin() + m_delaySize, 0.0f);
+    }
+    m_delayBufferPos = 0;
+    m_roomSize.snap();
+    m_damping.snap();
+    m_wetDryMix.snap();
+}
+
+void ReverbEffect::prepare(int sampleRate, int channels)
+{
+    Q_UNUSED(sampleRate);
+    if (static_cast<int>(m_delayLines.size()) < channels) {
+        m_delayLines.resize(channels, std::vector<float>(kMaxDelayFrames, 0.0f));
     }
 }
 
 AudioEffect* ReverbEffect::clone() const
 {
     ReverbEffect* reverb = new ReverbEffect();
-    reverb->m_roomSize = m_roomSize;
-    reverb->m_damping = m_damping;
-    reverb->m_wetDryMix = m_wetDryMix;
+    reverb->m_roomSize.set(m_roomSize.target());
+    reverb->m_damping.set(m_damping.target());
+    reverb->m_wetDryMix.set(m_wetDryMix.target());
     reverb->setEnabled(isEnabled());
     return reverb;
 }
 
 void ReverbEffect::setRoomSize(float size)
 {
-    m_roomSize = std::clamp(size, 0.0f, 1.0f);
+    m_roomSize.set(std::clamp(size, 0.0f, 1.0f));
 }
 
 void ReverbEffect::setDamping(float damping)
 {
-    m_damping = std::clamp(damping, 0.0f, 1.0f);
+    m_damping.set(std::clamp(damping, 0.0f, 1.0f));
 }
 
 void ReverbEffect::setWetDryMix(float mix)
 {
-    m_wetDryMix = std::clamp(mix, 0.0f, 1.0f);
+    m_wetDryMix.set(std::clamp(mix, 0.0f, 1.0f));
 }
 
 // ==================== BassBoostEffect ====================
@@ -196,39 +517,93 @@ BassBoostEffect::~BassBoostEffect()
     qDebug() << "BassBoostEffect destroyed";
 }
 
-void BassBoostEffect::apply(QAudioBuffer& buffer)
+void BassBoostEffect::process(const AudioBlock& block)
 {
-    if (!m_enabled || buffer.format().sampleFormat() != QAudioFormat::Float) {
+    if (!m_enabled) {
         return;
     }
 
-    float* data = buffer.data<float>();
-    int sampleCount = buffer.sampleCount();
+    // Never allocates here; a block wider than prepared for passes through
+    const int channels = block.channelCount();
+    if (m_state.size() < 2 * static_cast<size_t>(channels)) {
+        return;
+    }
 
-    // Simple bass boost (in reality, use a low-pass filter)
-    for (int i = 0; i < sampleCount; ++i) {
-        data[i] *= m_boostLevel;
-        data[i] = std::clamp(data[i], -1.0f, 1.0f);
+    if (block.sampleRate() != m_sampleRate) {
+        m_sampleRate = block.sampleRate();
+        m_boostLevel.setRampLength(rampFrames(m_sampleRate));
+        m_dirty = true;
+    }
+    if (channels != m_channels) {
+        m_channels = channels;
+        std::fill(m_state.begin(), m_state.end(), 0.0f);
+    }
+
+    // The shelf follows a level ramp block by block
+    if (m_boostLevel.update() || m_dirty) {
+        const float level = m_boostLevel.skip(block.frameCount());
+        m_shelf = designBiquad(LowShelf, kBassFrequency, 20.0f * std::log10(level), m_sampleRate);
+        m_dirty = false;
+    }
+
+    const BiquadCoefficients& f = m_shelf;
+    const int frames = block.frameCount();
+    const size_t stride = block.stride();
+
+    for (int c = 0; c < channels; ++c) {
+        float* data = block.channel(c);
+        float z1 = m_state[2 * c];
+        float z2 = m_state[2 * c + 1];
+
+        for (int i = 0; i < frames; ++i) {
+            float& sample = data[i * stride];
+            const float x = sample;
+            const float y = f.b0 * x + z1;
+            z1 = f.b1 * x - f.a1 * y + z2;
+            z2 = f.b2 * x - f.a2 * y;
+            sample = y;
+        }
+
+        m_state[2 * c] = z1;
+        m_state[2 * c + 1] = z2;
+    }
+}
+
+void BassBoostEffect::clearState()
+{
+    std::fill(m_state.begin(), m_state.end(), 0.0f);
+    m_boostLevel.snap();
+    m_dirty = true;
+}
+
+void BassBoostEffect::prepare(int sampleRate, int channels)
+{
+    Q_UNUSED(sampleRate);
+    if (m_state.size() < 2 * static_cast<size_t>(channels)) {
+        m_state.resize(2 * static_cast<size_t>(channels), 0.0f);
     }
 }
 
 AudioEffect* BassBoostEffect::clone() const
 {
     BassBoostEffect* bass = new BassBoostEffect();
-    bass->m_boostLevel = m_boostLevel;
+    bass->m_boostLevel.set(m_boostLevel.target());
     bass->setEnabled(isEnabled());
     return bass;
 }
 
 void BassBoostEffect::setBoostLevel(float level)
 {
-    m_boostLevel = std::clamp(level, 0.5f, 2.0f);
+    m_boostLevel.set(std::clamp(level, 0.5f, 2.0f));
 }
 
 // ==================== EffectChain ====================
 
 void EffectChain::addEffect(std::unique_ptr<AudioEffect> effect)
 {
+    if (effect && m_sampleRate > 0) {
+        effect->prepare(m_sampleRate, m_channels);
+    }
     m_effects.push_back(std::move(effect));
 }
 
@@ -246,9 +621,32 @@ void EffectChain::clearEffects()
 
 void EffectChain::processBuffer(QAudioBuffer& buffer)
 {
+    const AudioBlock block = AudioBlock::fromBuffer(buffer);
+    if (block.isValid()) {
+        processBlock(block);
+    }
+}
+
+void EffectChain::processBlock(const AudioBlock& block)
+{
+    for (auto& effect : m_effects) {
+        if (!effect) {
+            continue;
+        }
+        effect->beginBlock();
+        if (effect->isEnabled()) {
+            effect->process(block);
+        }
+    }
+}
+
+void EffectChain::prepare(int sampleRate, int channels)
+{
+    m_sampleRate = sampleRate;
+    m_channels = channels;
     for (auto& effect : m_effects) {
-        if (effect && effect->isEnabled()) {
-            effect->apply(buffer);
+        if (effect) {
+            effect->prepare(sampleRate, channels);
         }
     }
 }
@@ -3,85 +3,172 @@
 
 #include <QString>
 #include <QAudioBuffer>
+#include <atomic>
 #include <memory>
+#include <vector>
+#include "AudioBlock.h"
+#include "AudioParameter.h"
+
+// Normalised transposed direct form II biquad coefficients (a0 == 1)
+struct BiquadCoefficients {
+    float b0, b1, b2, a1, a2;
+};
 
 // Abstract base class (Concept #11)
+// Effects process an AudioBlock in place, interleaved or planar, and keep
+// their filter state per channel. Parameter setters only store the target
+// of a SmoothedParameter, so the UI may call them while the audio thread
+// processes; changes are ramped in rather than applied in one step.
+// reset() works the same way: it only posts a request, and the audio
+// thread clears the effect's state at the start of its next block.
 class AudioEffect {
 public:
     AudioEffect(const QString& name) : m_name(name), m_enabled(true) {}
     virtual ~AudioEffect() = default;  // Virtual destructor (Concept #10)
 
     // Pure virtual functions (Concept #11)
-    virtual void apply(QAudioBuffer& buffer) = 0;
+    virtual void process(const AudioBlock& block) = 0;
     virtual AudioEffect* clone() const = 0;
 
+    // Float buffers are processed as an interleaved block
+    virtual void apply(QAudioBuffer& buffer);
+
+    // Called outside the audio callback, before blocks of this format are
+    // processed: allocate here whatever process() needs
+    virtual void prepare(int sampleRate, int channels) { Q_UNUSED(sampleRate); Q_UNUSED(channels); }
+
     // Virtual functions (Concept #10)
     virtual QString effectName() const { return m_name; }
-    virtual void reset() { m_enabled = true; }
 
-    bool isEnabled() const { return m_enabled; }
-    void setEnabled(bool enabled) { m_enabled = enabled; }
+    // Any thread: re-enables the effect and asks for its state to be cleared
+    void reset()
+    {
+        m_enabled.store(true, std::memory_order_relaxed);
+        m_resetPending.store(true, std::memory_order_release);
+    }
+
+    // Audio thread, at each block boundary: applies a pending reset()
+    void beginBlock()
+    {
+        if (m_resetPending.exchange(false, std::memory_order_acquire))
+            clearState();
+    }
+
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
 
 protected:
+    // Audio thread only: drop filter memory and snap ramps to their targets
+    virtual void clearState() {}
+
     QString m_name;
-    bool m_enabled;
+    std::atomic<bool> m_enabled;
+
+private:
+    std::atomic<bool> m_resetPending{false};
 };
 
 // Equalizer Effect
+// Ten cascaded biquads (RBJ cookbook): a low shelf at 32 Hz, peaking
+// filters an octave wide up to 8 kHz and a high shelf at 16 kHz.
+// Coefficients are recomputed only while a gain is ramping or when the
+// sample rate changes, flat bands are left out of the cascade, and every
+// block goes through the remaining sections in one pass, four channels per
+// SIMD vector.
 class EqualizerEffect : public AudioEffect {
 public:
     EqualizerEffect();
     ~EqualizerEffect() override;
 
-    void apply(QAudioBuffer& buffer) override;
+    void process(const AudioBlock& block) override;
     AudioEffect* clone() const override;
+    void prepare(int sampleRate, int channels) override;
 
     void setBand(int band, float gain);
     float getBand(int band) const;
     void setPreset(const QString& presetName);
 
     static constexpr int BAND_COUNT = 10;
+    static constexpr float BAND_FREQUENCIES[BAND_COUNT] = {
+        32.0f, 64.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f
+    };
+
+protected:
+    void clearState() override;
 
 private:
-    float m_bands[BAND_COUNT];
+    SmoothedParameter m_bands[BAND_COUNT];   // dB
+
+    void updateSections(int frames);
+
+    BiquadCoefficients m_sections[BAND_COUNT];
+    int m_sectionBands[BAND_COUNT];
+    int m_sectionCount = 0;
+    int m_activeBands = 0;          // bitmask of the bands in m_sections
+    int m_sampleRate = 0;
+    int m_channels = 0;
 
-    void applyBandFilter(float* samples, int sampleCount, int band, float gain);
+    // z1, z2 per band and channel, channels padded to whole vectors; sized
+    // by prepare(), never on the audio thread
+    std::vector<float> m_state;
 };
 
 // Reverb Effect
+// One feedback delay line per channel; the LFE channel is left dry.
+// prepare() sizes the lines for the highest supported rate, so a rate
+// change on the audio thread only clears them.
 class ReverbEffect : public AudioEffect {
 public:
     ReverbEffect();
     ~ReverbEffect() override;
 
-    void apply(QAudioBuffer& buffer) override;
+    void process(const AudioBlock& block) override;
     AudioEffect* clone() const override;
+    void prepare(int sampleRate, int channels) override;
 
     void setRoomSize(float size);  // 0.0 to 1.0
     void setDamping(float damping);  // 0.0 to 1.0
     void setWetDryMix(float mix);  // 0.0 to 1.0
 
+protected:
+    void clearState() override;
+
 private:
-    float m_roomSize;
-    float m_damping;
-    float m_wetDryMix;
-    std::vector<float> m_delayBuffer;
+    SmoothedParameter m_roomSize;
+    SmoothedParameter m_damping;
+    SmoothedParameter m_wetDryMix;
+    std::vector<std::vector<float>> m_delayLines;  // kMaxDelayFrames per channel
     int m_delayBufferPos;
+    int m_delaySize = 0;            // one second at the current rate
+    int m_sampleRate = 0;
+
+    static constexpr int kMaxDelayFrames = 192000;
 };
 
 // Bass Boost Effect
+// Low shelf at 100 Hz; the boost level is the linear shelf gain.
 class BassBoostEffect : public AudioEffect {
 public:
     BassBoostEffect();
     ~BassBoostEffect() override;
 
-    void apply(QAudioBuffer& buffer) override;
+    void process(const AudioBlock& block) override;
     AudioEffect* clone() const override;
+    void prepare(int sampleRate, int channels) override;
+
+    void setBoostLevel(float level);  // 0.5 to 2.0
 
-    void setBoostLevel(float level);  // 0.0 to 2.0
+protected:
+    void clearState() override;
 
 private:
-    float m_boostLevel;
+    SmoothedParameter m_boostLevel;
+
+    BiquadCoefficients m_shelf{};
+    int m_sampleRate = 0;
+    int m_channels = 0;
+    bool m_dirty = true;
+    std::vector<float> m_state;  // z1, z2 per channel, sized by prepare()
 };
 
 // Effect Manager using polymorphism
@@ -92,12 +179,18 @@ public:
     void clearEffects();
 
     void processBuffer(QAudioBuffer& buffer);
+    void processBlock(const AudioBlock& block);
+
+    // Prepares every effect, and effects added later, for this format
+    void prepare(int sampleRate, int channels);
 
     int effectCount() const { return static_cast<int>(m_effects.size()); }
     AudioEffect* getEffect(int index);
 
 private:
     std::vector<std::unique_ptr<AudioEffect>> m_effects;  // STL Container
+    int m_sampleRate = 0;
+    int m_channels = 0;
 };
 
 #endif // AUDIOEFFECT_H
@@ -0,0 +1,88 @@
+#ifndef AUDIOPARAMETER_H
+#define AUDIOPARAMETER_H
+
+#include <atomic>
+
+// A processing parameter handed from the UI to the audio thread.
+// set() may be called from any thread at any time; it only stores the
+// target in an atomic, so the audio thread never waits for a lock. The audio
+// thread picks the target up once per block with update() and moves towards
+// it in a linear ramp over rampLength frames, either a sample at a time
+// (next()) or a block at a time (skip()) for parameters that feed filter
+// coefficients. Everything but set() and target() is audio-thread only.
+class SmoothedParameter
+{
+public:
+    explicit SmoothedParameter(float value = 0.0f)
+        : m_target(value)
+        , m_rampTarget(value)
+        , m_current(value)
+    {
+    }
+
+    SmoothedParameter(const SmoothedParameter&) = delete;
+    SmoothedParameter& operator=(const SmoothedParameter&) = delete;
+
+    void set(float value) { m_target.store(value, std::memory_order_relaxed); }
+    float target() const { return m_target.load(std::memory_order_relaxed); }
+
+    void setRampLength(int frames) { m_rampLength = frames; }
+
+    // Start of a block; true while a ramp is in progress
+    bool update()
+    {
+        const float target = m_target.load(std::memory_order_relaxed);
+        if (target != m_rampTarget) {
+            m_rampTarget = target;
+            if (m_rampLength > 0) {
+                m_remaining = m_rampLength;
+                m_step = (target - m_current) / m_rampLength;
+            } else {
+                m_current = target;
+                m_remaining = 0;
+            }
+        }
+        return m_remaining > 0;
+    }
+
+    bool isRamping() const { return m_remaining > 0; }
+    float current() const { return m_current; }
+
+    float next()
+    {
+        if (m_remaining > 0 && --m_remaining > 0)
+            m_current += m_step;
+        else
+            m_current = m_rampTarget;
+        return m_current;
+    }
+
+    float skip(int frames)
+    {
+        if (frames < m_remaining) {
+            m_remaining -= frames;
+            m_current += m_step * frames;
+        } else {
+            m_remaining = 0;
+            m_current = m_rampTarget;
+        }
+        return m_current;
+    }
+
+    // Jumps to the target, e.g. when playback restarts
+    void snap()
+    {
+        m_rampTarget = m_current = m_target.load(std::memory_order_relaxed);
+        m_remaining = 0;
+    }
+
+private:
+    std::atomic<float> m_target;
+    float m_rampTarget;
+    float m_current;
+    float m_step = 0.0f;
+    int m_remaining = 0;
+    int m_rampLength = 0;
+};
+
+#endif // AUDIOPARAMETER_H
@@ -0,0 +1,801 @@
+#include "AudioPipeline.h"
+#include "AudioEffect.h"
+#include "AudioBlock.h"
+#include "AudioParameter.h"
+#include "CircularBuffer.h"
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QAudioDevice>
+#include <QAudioFormat>
+#include <QAudioSink>
+#include <QDebug>
+#include <QIODevice>
+#include <QMediaDevices>
+#include <QMutex>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+
+constexpr float kMinRate = 0.25f;
+constexpr float kMaxRate = 2.0f;
+constexpr int kPositionIntervalMs = 100;
+constexpr int kRetryMs = 20;
+constexpr int kRealtimePriority = 10;
+constexpr int kRampMs = 30;
+
+} // namespace
+
+struct AudioPipeline::Shared {
+    // Decoder output: float samples at the device's rate and channel count.
+    // Written by the owning thread only while both stages are stopped.
+    QAudioFormat format;
+
+    // Interleaved samples, whole frames only. The decoder stage is the only
+    // producer and the render stage the only consumer; the owning thread
+    // resets it only while both stages are stopped.
+    SpscRingBuffer<float> queue;
+
+    std::atomic<int> generation{0};
+    std::atomic<bool> decodeFinished{false};   // everything decoded is queued
+    std::atomic<bool> flushRequested{false};   // render stage drops the queue
+    std::atomic<qint64> seekBase{0};           // ms at the first queued frame
+    std::atomic<qint64> framesPlayed{0};       // source frames rendered since
+
+    SmoothedParameter gain{1.0f};
+    SmoothedParameter balance{0.0f};
+    std::atomic<float> rate{1.0f};
+    std::atomic<int> fadeFrames{0};
+
+    // Held for structural edits; effect parameters need no lock
+    QMutex effectsMutex;
+    EffectChain effects;
+};
+
+// ==================== Decoder Stage ====================
+
+// Lives on the decoder thread. QAudioDecoder only decodes the next buffer
+// once the previous one has been read, so leaving buffers unread while the
+// queue is full holds the decoder back. Nothing is queued while a flush is
+// pending, so the render stage drops only samples from before it.
+class DecoderStage : public QObject
+{
+public:
+    DecoderStage(AudioPipeline::Shared* shared, AudioPipeline* pipeline)
+        : m_shared(shared)
+        , m_pipeline(pipeline)
+    {
+    }
+
+    void start(const QUrl& source, qint64 position, int generation);
+    void stop();
+
+private:
+    void pump();
+    bool takeBuffer(const QAudioBuffer& buffer);
+    bool pushPending();
+
+    AudioPipeline::Shared* m_shared;
+    AudioPipeline* m_pipeline;
+    QAudioDecoder* m_decoder = nullptr;
+    QTimer* m_retry = nullptr;
+
+    // Samples of the last buffer read that did not fit into the queue
+    std::vector<float> m_pending;
+    size_t m_pendingOffset = 0;
+
+    qint64 m_skipSamples = 0;
+    int m_generation = 0;
+    bool m_finished = false;
+    bool m_loaded = false;
+};
+
+void DecoderStage::start(const QUrl& source, qint64 position, int generation)
+{
+    if (!m_decoder) {
+        m_decoder = new QAudioDecoder(this);
+        m_retry = new QTimer(this);
+        m_retry->setSingleShot(true);
+        m_retry->setInterval(kRetryMs);
+
+        connect(m_retry, &QTimer::timeout, this, [this]() { pump(); });
+        connect(m_decoder, &QAudioDecoder::bufferReady, this, [this]() { pump(); });
+        connect(m_decoder, &QAudioDecoder::finished, this, [this]() {
+            m_finished = true;
+            pump();
+        });
+        connect(m_decoder, &QAudioDecoder::durationChanged, this, [this](qint64 duration) {
+            AudioPipeline* pipeline = m_pipeline;
+            const int generation = m_generation;
+            QMetaObject::invokeMethod(pipeline, [pipeline, generation, duration]() {
+                pipeline->onDurationChanged(generation, duration);
+            }, Qt::QueuedConnection);
+        });
+        connect(m_decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error),
+                this, [this](QAudioDecoder::Error) {
+            AudioPipeline* pipeline = m_pipeline;
+            const int generation = m_generation;
+            const QString message = m_decoder->errorString();
+            QMetaObject::invokeMethod(pipeline, [pipeline, generation, message]() {
+                pipeline->onDecoderError(generation, message);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    stop();
+
+    const QAudioFormat& format = m_shared->format;
+    m_skipSamples = position * format.sampleRate() / 1000 * format.channelCount();
+    m_generation = generation;
+    m_loaded = false;
+
+    m_decoder->setAudioFormat(format);
+    m_decoder->setSource(source);
+    m_decoder->start();
+}
+
+void DecoderStage::stop()
+{
+    if (m_decoder) {
+        m_decoder->stop();
+        m_retry->stop();
+    }
+    m_pending.clear();
+    m_pendingOffset = 0;
+    m_finished = false;
+}
+
+void DecoderStage::pump()
+{
+    if (!m_decoder)
+        return;
+
+    if (m_shared->flushRequested.load(std::memory_order_acquire)) {
+        m_retry->start();
+        return;
+    }
+
+    for (;;) {
+        if (m_pendingOffset < m_pending.size() && !pushPending()) {
+            m_retry->start();
+            return;
+        }
+        if (!m_decoder->bufferAvailable())
+            break;
+        if (!takeBuffer(m_decoder->read()))
+            return;
+    }
+
+    if (m_finished)
+        m_shared->decodeFinished = true;
+}
+
+bool DecoderStage::takeBuffer(const QAudioBuffer& buffer)
+{
+    m_pending.clear();
+    m_pendingOffset = 0;
+
+    if (!buffer.isValid())
+        return true;
+
+    const QAudioFormat& format = m_shared->format;
+    const QAudioFormat bufferFormat = buffer.format();
+    if (bufferFormat.sampleRate() != format.sampleRate()
+        || bufferFormat.channelCount() != format.channelCount()) {
+        qWarning() << "Decoder ignored the requested output format:" << bufferFormat;
+        m_decoder->stop();
+
+        AudioPipeline* pipeline = m_pipeline;
+        const int generation = m_generation;
+        QMetaObject::invokeMethod(pipeline, [pipeline, generation]() {
+            pipeline->onDecoderError(generation, "Unsupported decoder output format");
+        }, Qt::QueuedConnection);
+        return false;
+    }
+
+    const int count = buffer.sampleCount();
+    m_pending.resize(static_cast<size_t>(count));
+
+    if (bufferFormat.sampleFormat() == QAudioFormat::Float) {
+        std::memcpy(m_pending.data(), buffer.constData<float>(), count * sizeof(float));
+    } else {
+        const char* bytes = buffer.constData<char>();
+        const int bytesPerSample = bufferFormat.bytesPerSample();
+        for (int i = 0; i < count; ++i)
+            m_pending[i] = bufferFormat.normalizedSampleValue(bytes + i * bytesPerSample);
+    }
+
+    // Samples before a seek target are decoded and dropped
+    if (m_skipSamples > 0) {
+        const qint64 skip = std::min<qint64>(m_skipSamples, count);
+        m_pendingOffset = static_cast<size_t>(skip);
+        m_skipSamples -= skip;
+    }
+
+    if (!m_loaded) {
+        m_loaded = true;
+        AudioPipeline* pipeline = m_pipeline;
+        const int generation = m_generation;
+        QMetaObject::invokeMethod(pipeline, [pipeline, generation]() {
+            pipeline->onMediaLoaded(generation);
+        }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+bool DecoderStage::pushPending()
+{
+    const size_t channels = static_cast<size_t>(m_shared->format.channelCount());
+    SpscRingBuffer<float>& queue = m_shared->queue;
+
+    // Only what fits, so the queue never counts an overrun here
+    size_t count = std::min(queue.writeAvailable(), m_pending.size() - m_pendingOffset);
+    count -= count % channels;
+    queue.pushN(m_pending.data() + m_pendingOffset, count);
+
+    m_pendingOffset += count;
+    return m_pendingOffset == m_pending.size();
+}
+
+// ==================== Render Stage ====================
+
+// Lives on the audio thread and is the sink's pull device. Each block takes
+// the input frames the playback rate calls for out of the queue (silence if
+// the decoder has fallen behind), interpolates them to kBlockFrames output
+// frames, runs the effect chain and applies gain, balance and fade. The sink
+// reads the block in whatever sizes it likes; the next one is only rendered
+// once it has all been read.
+class RenderStage : public QIODevice
+{
+public:
+    RenderStage(AudioPipeline::Shared* shared, AudioPipeline* pipeline)
+        : m_shared(shared)
+        , m_pipeline(pipeline)
+    {
+    }
+
+    void startSink(const QAudioDevice& device);
+    void stopSink();
+    void suspendSink();
+    void resumeSink();
+
+    bool isSequential() const override { return true; }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    void renderBlock();
+    void reset();
+    void prepareThread();
+
+    AudioPipeline::Shared* m_shared;
+    AudioPipeline* m_pipeline;
+    QAudioSink* m_sink = nullptr;
+    QAudioFormat m_sinkFormat;
+    int m_channels = 0;
+    int m_sampleRate = 0;
+
+    std::vector<float> m_input;         // two carried frames, then this block's
+    std::vector<float> m_block;         // interleaved, handed to the effect chain
+    QByteArray m_output;                // m_block in the sink's format
+    int m_lfeChannel = -1;
+    qint64 m_outputOffset = 0;
+
+    double m_phase = 0.0;               // output position past the first carried frame
+    int m_fadeLength = 0;
+    int m_fadePosition = 0;
+    bool m_endReported = false;
+    bool m_primed = false;              // a full block was read since start or flush
+    bool m_threadPrepared = false;
+};
+
+void RenderStage::startSink(const QAudioDevice& device)
+{
+    stopSink();
+    prepareThread();
+
+    const QAudioFormat& format = m_shared->format;
+    m_channels = format.channelCount();
+    m_sampleRate = format.sampleRate();
+
+    m_sinkFormat = format;
+    if (!device.isFormatSupported(m_sinkFormat))
+        m_sinkFormat.setSampleFormat(QAudioFormat::Int16);
+
+    const int blockFrames = AudioPipeline::kBlockFrames;
+    const int maxInputFrames = static_cast<int>(std::ceil(kMaxRate * blockFrames)) + 2;
+
+    m_block.assign(static_cast<size_t>(blockFrames) * m_channels, 0.0f);
+    m_lfeChannel = AudioBlock::lfeChannelOf(format);
+    m_output = QByteArray(blockFrames * m_sinkFormat.bytesPerFrame(), 0);
+    m_outputOffset = m_output.size();
+    m_input.reserve(static_cast<size_t>(maxInputFrames) * m_channels);
+    m_shared->gain.setRampLength(m_sampleRate * kRampMs / 1000);
+    m_shared->balance.setRampLength(m_sampleRate * kRampMs / 1000);
+    m_shared->gain.snap();
+    m_shared->balance.snap();
+    m_fadeLength = 0;
+    m_fadePosition = 0;
+    reset();
+
+    open(QIODevice::ReadOnly);
+    m_sink = new QAudioSink(device, m_sinkFormat, this);
+    m_sink->setBufferSize(AudioPipeline::kSinkBlocks * m_output.size());
+    m_sink->start(this);
+
+    if (m_sink->error() != QAudio::NoError)
+        qWarning() << "Audio sink failed to start:" << m_sink->error();
+    else
+        qDebug() << "Audio sink started:" << m_sinkFormat << "block" << blockFrames << "frames";
+}
+
+void RenderStage::stopSink()
+{
+    if (m_sink) {
+        m_sink->stop();
+        delete m_sink;
+        m_sink = nullptr;
+        qDebug() << "Audio sink stopped," << m_shared->queue.underruns() << "queue underruns";
+    }
+    if (isOpen())
+        close();
+}
+
+void RenderStage::suspendSink()
+{
+    if (m_sink)
+        m_sink->suspend();
+}
+
+void RenderStage::resumeSink()
+{
+    if (m_sink)
+        m_sink->resume();
+}
+
+void RenderStage::prepareThread()
+{
+    if (m_threadPrepared)
+        return;
+    m_threadPrepared = true;
+
+#if defined(__SSE__) || defined(_M_X64)
+    // Filter tails decay into denormals, which x86 handles in microcode;
+    // flush them to zero (FTZ | DAZ) for everything run on this thread
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+
+#ifdef Q_OS_LINUX
+    // TimeCriticalPriority means nothing under SCHED_OTHER; ask for FIFO
+    // scheduling, which needs CAP_SYS_NICE or an rtprio limit
+    sched_param param{};
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO) + kRealtimePriority;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+        qDebug() << "Audio thread running with SCHED_FIFO";
+        return;
+    }
+    qDebug() << "Real-time scheduling unavailable, audio thread keeps normal policy";
+#endif
+}
+
+void RenderStage::reset()
+{
+    m_input.assign(2 * static_cast<size_t>(m_channels), 0.0f);
+    m_phase = 0.0;
+    m_endReported = false;
+    m_primed = false;
+    m_shared->framesPlayed = 0;
+}
+
+qint64 RenderStage::readData(char* data, qint64 maxSize)
+{
+    qint64 written = 0;
+    while (written < maxSize) {
+        if (m_outputOffset == m_output.size()) {
+            renderBlock();
+            m_outputOffset = 0;
+        }
+
+        const qint64 count = std::min<qint64>(maxSize - written, m_output.size() - m_outputOffset);
+        std::memcpy(data + written, m_output.constData() + m_outputOffset, count);
+        written += count;
+        m_outputOffset += count;
+    }
+    return written;
+}
+
+qint64 RenderStage::writeData(const char* data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+void RenderStage::renderBlock()
+{
+    AudioPipeline::Shared& shared = *m_shared;
+    const int blockFrames = AudioPipeline::kBlockFrames;
+    const size_t channels = static_cast<size_t>(m_channels);
+
+    // Dropping the queue is the consumer's job; the decoder resumes once
+    // the flag is clear
+    if (shared.flushRequested.load(std::memory_order_acquire)) {
+        reset();
+        shared.queue.discard(shared.queue.readAvailable());
+        shared.flushRequested.store(false, std::memory_order_release);
+    }
+
+    const int fade = shared.fadeFrames.exchange(0);
+    if (fade > 0) {
+        m_fadeLength = fade;
+        m_fadePosition = 0;
+    }
+
+    // Output frame j lies m_phase + j * rate input frames past the first
+    // carried frame; the block moves the input on by advance frames
+    const double rate = shared.rate.load(std::memory_order_relaxed);
+    const int advance = static_cast<int>(m_phase + rate * blockFrames);
+    const size_t wanted = static_cast<size_t>(advance) * channels;
+
+    m_input.resize(2 * channels + wanted);
+    float* input = m_input.data();
+
+    // A short read counts as an underrun, except at the end of the source
+    // and while the sink primes after a start or flush, until the decoder
+    // has delivered one full block
+    const bool finished = shared.decodeFinished;
+    size_t request = wanted;
+    if (finished || !m_primed)
+        request = std::min(wanted, shared.queue.readAvailable());
+    const size_t got = shared.queue.popN(input + 2 * channels, request);
+    if (got == wanted)
+        m_primed = true;
+    std::fill(m_input.begin() + 2 * channels + got, m_input.end(), 0.0f);
+    shared.framesPlayed += static_cast<qint64>(got / channels);
+
+    float* samples = m_block.data();
+    for (int frame = 0; frame < blockFrames; ++frame) {
+        const double position = m_phase + frame * rate;
+        const size_t index = static_cast<size_t>(position);
+        const float fraction = static_cast<float>(position - index);
+        const float* a = input + index * channels;
+        const float* b = a + channels;
+        float* out = samples + frame * channels;
+        for (size_t c = 0; c < channels; ++c)
+            out[c] = a[c] + (b[c] - a[c]) * fraction;
+    }
+
+    std::copy(m_input.begin() + advance * channels, m_input.begin() + (advance + 2) * channels,
+              m_input.begin());
+    m_input.resize(2 * channels);
+    m_phase += rate * blockFrames - advance;
+
+    // Rather than wait out a structural edit of the chain, the block goes
+    // through unprocessed
+    if (shared.effectsMutex.tryLock()) {
+        AudioBlock block = AudioBlock::interleaved(samples, blockFrames, m_channels, m_sampleRate);
+        block.setLfeChannel(m_lfeChannel);
+        shared.effects.processBlock(block);
+        shared.effectsMutex.unlock();
+    }
+
+    // Gain and balance ramp sample by sample towards their targets
+    shared.gain.update();
+    shared.balance.update();
+    for (int frame = 0; frame < blockFrames; ++frame) {
+        float gain = shared.gain.next();
+        const float balance = shared.balance.next();
+        if (m_fadePosition < m_fadeLength)
+            gain *= static_cast<float>(m_fadePosition++) / m_fadeLength;
+
+        const float left = gain * std::min(1.0f, 1.0f - balance);
+        const float right = gain * std::min(1.0f, 1.0f + balance);
+
+        float* out = samples + frame * channels;
+        for (size_t c = 0; c < channels; ++c) {
+            const float channelGain = channels < 2 || c > 1 ? gain : c == 0 ? left : right;
+            out[c] = std::clamp(out[c] * channelGain, -1.0f, 1.0f);
+        }
+    }
+
+    const size_t sampleCount = static_cast<size_t>(blockFrames) * channels;
+    if (m_sinkFormat.sampleFormat() == QAudioFormat::Float) {
+        std::memcpy(m_output.data(), samples, sampleCount * sizeof(float));
+    } else {
+        qint16* out = reinterpret_cast<qint16*>(m_output.data());
+        for (size_t i = 0; i < sampleCount; ++i)
+            out[i] = static_cast<qint16>(std::lrint(samples[i] * 32767.0f));
+    }
+
+    if (got == 0 && finished && !m_endReported) {
+        m_endReported = true;
+        AudioPipeline* pipeline = m_pipeline;
+        const int generation = shared.generation;
+        QMetaObject::invokeMethod(pipeline, [pipeline, generation]() {
+            pipeline->onEndOfMedia(generation);
+        }, Qt::QueuedConnection);
+    }
+}
+
+// ==================== Constructor & Destructor ====================
+
+AudioPipeline::AudioPipeline(QObject* parent)
+    : QObject(parent)
+    , m_shared(std::make_unique<Shared>())
+    , m_decodeThread(new QThread(this))
+    , m_audioThread(new QThread(this))
+    , m_decoder(new DecoderStage(m_shared.get(), this))
+    , m_render(new RenderStage(m_shared.get(), this))
+    , m_positionTimer(new QTimer(this))
+{
+    m_decodeThread->setObjectName("AudioDecoder");
+    m_audioThread->setObjectName("AudioRender");
+
+    m_decoder->moveToThread(m_decodeThread);
+    m_render->moveToThread(m_audioThread);
+    connect(m_decodeThread, &QThread::finished, m_decoder, &QObject::deleteLater);
+    connect(m_audioThread, &QThread::finished, m_render, &QObject::deleteLater);
+
+    m_decodeThread->start();
+    m_audioThread->start(QThread::TimeCriticalPriority);
+
+    m_positionTimer->setInterval(kPositionIntervalMs);
+    connect(m_positionTimer, &QTimer::timeout, this, [this]() {
+        emit positionChanged(position());
+    });
+}
+
+AudioPipeline::~AudioPipeline()
+{
+    stopStages();
+
+    m_decodeThread->quit();
+    m_audioThread->quit();
+    m_decodeThread->wait();
+    m_audioThread->wait();
+}
+
+// ==================== Playback Control ====================
+
+void AudioPipeline::setSource(const QUrl& source)
+{
+    stopStages();
+    setState(Stopped);
+
+    m_source = source;
+    m_shared->generation = ++m_generation;
+    m_shared->seekBase = 0;
+    m_shared->framesPlayed = 0;
+
+    if (m_duration != 0) {
+        m_duration = 0;
+        emit durationChanged(m_duration);
+    }
+
+    QAudioFormat format = QMediaDevices::defaultAudioOutput().preferredFormat();
+    format.setSampleFormat(QAudioFormat::Float);
+    if (!format.isValid()) {
+        qWarning() << "No usable audio output device";
+        emit errorOccurred("No audio output device");
+        return;
+    }
+
+    m_shared->format = format;
+    editEffects([&format](EffectChain& chain) {
+        chain.prepare(format.sampleRate(), format.channelCount());
+    });
+    const size_t capacity = static_cast<size_t>(format.sampleRate()) * kQueueMs / 1000;
+    m_shared->queue.reset(capacity * format.channelCount());
+
+    if (!m_source.isEmpty())
+        startDecoder(0);
+}
+
+void AudioPipeline::play()
+{
+    if (m_source.isEmpty() || !m_shared->format.isValid() || m_state == Playing)
+        return;
+
+    // After stop() or the end of the media playback starts over
+    if (!m_decoding)
+        startDecoder(0);
+
+    RenderStage* render = m_render;
+    if (m_sinkStarted) {
+        QMetaObject::invokeMethod(render, [render]() { render->resumeSink(); }, Qt::QueuedConnection);
+    } else {
+        const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+        QMetaObject::invokeMethod(render, [render, device]() { render->startSink(device); },
+                                  Qt::QueuedConnection);
+        m_sinkStarted = true;
+    }
+
+    m_positionTimer->start();
+    setState(Playing);
+}
+
+void AudioPipeline::pause()
+{
+    if (m_state != Playing)
+        return;
+
+    RenderStage* render = m_render;
+    QMetaObject::invokeMethod(render, [render]() { render->suspendSink(); }, Qt::QueuedConnection);
+
+    m_positionTimer->stop();
+    setState(Paused);
+    emit positionChanged(position());
+}
+
+void AudioPipeline::stop()
+{
+    stopStages();
+    m_shared->seekBase = 0;
+    m_shared->framesPlayed = 0;
+
+    setState(Stopped);
+    emit positionChanged(0);
+}
+
+void AudioPipeline::seek(qint64 position)
+{
+    if (m_source.isEmpty() || !m_shared->format.isValid())
+        return;
+
+    position = qMax<qint64>(0, position);
+    if (m_duration > 0)
+        position = qMin(position, m_duration);
+
+    startDecoder(position);
+    emit positionChanged(position);
+}
+
+qint64 AudioPipeline::position() const
+{
+    const Shared& shared = *m_shared;
+    const int sampleRate = shared.format.sampleRate();
+    if (sampleRate <= 0)
+        return shared.seekBase;
+
+    const qint64 position = shared.seekBase + shared.framesPlayed * 1000 / sampleRate;
+    return m_duration > 0 ? qMin(position, m_duration) : position;
+}
+
+// ==================== Parameters ====================
+
+void AudioPipeline::setGain(float gain)
+{
+    m_shared->gain.set(std::max(0.0f, gain));
+}
+
+void AudioPipeline::setBalance(float balance)
+{
+    m_shared->balance.set(std::clamp(balance, -1.0f, 1.0f));
+}
+
+void AudioPipeline::setPlaybackRate(float rate)
+{
+    m_shared->rate = std::clamp(rate, kMinRate, kMaxRate);
+}
+
+void AudioPipeline::startFadeIn(int milliseconds)
+{
+    const int sampleRate = m_shared->format.sampleRate();
+    if (sampleRate > 0 && milliseconds > 0)
+        m_shared->fadeFrames = static_cast<int>(qint64(milliseconds) * sampleRate / 1000);
+}
+
+void AudioPipeline::editEffects(const std::function<void(EffectChain&)>& edit)
+{
+    QMutexLocker locker(&m_shared->effectsMutex);
+    edit(m_shared->effects);
+}
+
+// ==================== Private Methods ====================
+
+void AudioPipeline::setState(State state)
+{
+    if (m_state == state)
+        return;
+
+    m_state = state;
+    emit stateChanged(m_state);
+}
+
+void AudioPipeline::startDecoder(qint64 position)
+{
+    // The old decoder must have stopped queueing before the queue is
+    // dropped. Cleared first so the render stage cannot take the empty
+    // queue for the end of the new source.
+    DecoderStage* decoder = m_decoder;
+    QMetaObject::invokeMethod(decoder, [decoder]() { decoder->stop(); },
+                              Qt::BlockingQueuedConnection);
+    m_shared->decodeFinished = false;
+
+    // A running sink drops the queue itself at its next block; otherwise
+    // there is no consumer and it can be cleared here
+    if (m_sinkStarted) {
+        m_shared->flushRequested = true;
+    } else {
+        m_shared->flushRequested = false;
+        m_shared->queue.clear();
+    }
+
+    m_shared->seekBase = position;
+    m_shared->framesPlayed = 0;
+    m_decoding = true;
+
+    const QUrl source = m_source;
+    const int generation = m_generation;
+    QMetaObject::invokeMethod(decoder, [decoder, source, position, generation]() {
+        decoder->start(source, position, generation);
+    }, Qt::QueuedConnection);
+}
+
+void AudioPipeline::stopStages()
+{
+    m_positionTimer->stop();
+
+    RenderStage* render = m_render;
+    DecoderStage* decoder = m_decoder;
+    QMetaObject::invokeMethod(render, [render]() { render->stopSink(); },
+                              Qt::BlockingQueuedConnection);
+    QMetaObject::invokeMethod(decoder, [decoder]() { decoder->stop(); },
+                              Qt::BlockingQueuedConnection);
+
+    m_sinkStarted = false;
+    m_decoding = false;
+}
+
+void AudioPipeline::onDurationChanged(int generation, qint64 duration)
+{
+    if (generation != m_generation || duration <= 0 || duration == m_duration)
+        return;
+
+    m_duration = duration;
+    emit durationChanged(m_duration);
+}
+
+void AudioPipeline::onMediaLoaded(int generation)
+{
+    if (generation == m_generation)
+        emit mediaLoaded();
+}
+
+void AudioPipeline::onEndOfMedia(int generation)
+{
+    if (generation != m_generation || m_state == Stopped)
+        return;
+
+    stopStages();
+    setState(Stopped);
+    emit positionChanged(position());
+    emit endOfMedia();
+}
+
+void AudioPipeline::onDecoderError(int generation, const QString& errorString)
+{
+    if (generation != m_generation)
+        return;
+
+    qWarning() << "Audio decoder error:" << errorString;
+    stopStages();
+    setState(Stopped);
+    emit errorOccurred(errorString);
+}
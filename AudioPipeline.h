@@ -0,0 +1,116 @@
+#ifndef AUDIOPIPELINE_H
+#define AUDIOPIPELINE_H
+
+#include <QObject>
+#include <QUrl>
+#include <functional>
+#include <memory>
+
+class QThread;
+class QTimer;
+class EffectChain;
+class DecoderStage;
+class RenderStage;
+
+// Playback path for local files: decode -> EffectChain -> QAudioSink.
+//
+// A QAudioDecoder on the decoder thread converts the source to float
+// samples at the output device's rate and channel count and queues up to
+// kQueueMs of them ahead of playback in a lock-free ring. The sink pulls from the render stage
+// on a real-time priority audio thread, which cuts the queue into fixed
+// blocks of kBlockFrames and runs varispeed, the effect chain, gain, balance
+// and fade over each block. A parameter change therefore reaches the output
+// within one block plus the sink's buffer, however far ahead the decoder is.
+//
+// QAudioDecoder cannot seek, so seek() restarts decoding and drops samples
+// up to the target; decoding runs far faster than real time, so only long
+// jumps are noticeable.
+//
+// All public functions are called from the thread that owns the pipeline.
+class AudioPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Stopped,
+        Playing,
+        Paused
+    };
+    Q_ENUM(State)
+
+    static constexpr int kBlockFrames = 512;
+    static constexpr int kSinkBlocks = 4;
+    static constexpr int kQueueMs = 1000;
+
+    explicit AudioPipeline(QObject* parent = nullptr);
+    ~AudioPipeline() override;
+
+    // Starts decoding at once; play() starts the output
+    void setSource(const QUrl& source);
+    QUrl source() const { return m_source; }
+
+    void play();
+    void pause();
+    void stop();
+    void seek(qint64 position);
+
+    State state() const { return m_state; }
+    qint64 position() const;
+    qint64 duration() const { return m_duration; }
+
+    // Picked up by the audio thread at the next block; gain and balance
+    // are ramped in over a few milliseconds
+    void setGain(float gain);              // linear, may exceed 1
+    void setBalance(float balance);        // -1 (left) to 1 (right)
+    void setPlaybackRate(float rate);      // varispeed, pitch follows
+    void startFadeIn(int milliseconds);
+
+    // Runs edit with the effect chain locked, for adding or removing
+    // effects. Effect parameters are set through the effects directly and
+    // need no lock. The audio thread never waits here; a block rendered
+    // during an edit skips the chain.
+    void editEffects(const std::function<void(EffectChain&)>& edit);
+
+signals:
+    void stateChanged(AudioPipeline::State state);
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void mediaLoaded();
+    void endOfMedia();
+    void errorOccurred(const QString& errorString);
+
+private:
+    friend class DecoderStage;
+    friend class RenderStage;
+
+    // State handed between the threads; defined in AudioPipeline.cpp
+    struct Shared;
+
+    void setState(State state);
+    void startDecoder(qint64 position);
+    void stopStages();
+
+    // Posted by the stages; stale generations are ignored
+    void onDurationChanged(int generation, qint64 duration);
+    void onMediaLoaded(int generation);
+    void onEndOfMedia(int generation);
+    void onDecoderError(int generation, const QString& errorString);
+
+    std::unique_ptr<Shared> m_shared;
+
+    QThread* m_decodeThread;
+    QThread* m_audioThread;
+    DecoderStage* m_decoder;
+    RenderStage* m_render;
+    QTimer* m_positionTimer;
+
+    QUrl m_source;
+    State m_state = Stopped;
+    qint64 m_duration = 0;
+    int m_generation = 0;
+    bool m_decoding = false;
+    bool m_sinkStarted = false;
+};
+
+#endif // AUDIOPIPELINE_H
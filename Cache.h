@@ -1,9 +1,15 @@
 #ifndef CACHE_H
 #define CACHE_H
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
 
 // LRU Cache template class (Concept #13)
 template<typename KeyType, typename ValueType>
@@ -78,4 +84,222 @@ private:
     std::map<KeyType, typename std::list<std::pair<KeyType, ValueType>>::iterator> m_cacheMap;
 };
 
+// Default cost of a cached value: one unit, so the capacity counts entries
+template<typename ValueType>
+struct UnitWeigher {
+    size_t operator()(const ValueType&) const { return 1; }
+};
+
+// Thread-safe LRU cache for variable-size values shared between threads.
+// Keys are hashed onto shards, each with its own mutex, LRU list and index,
+// so threads working on different keys rarely contend. The capacity is a
+// budget in Weigher units (e.g. bytes) split evenly over the shards; a
+// shard over budget evicts from its cold end. Pick fewer shards for few,
+// heavy values: one entry may take at most a quarter of its shard.
+//
+// Values are stored as shared_ptr<const ValueType>: get() returns the
+// pointer without copying the value, and an entry evicted while someone
+// still holds it stays alive until they let go. get(), contains() and
+// remove() accept any key type that Hash and KeyEqual accept, so a
+// transparent hasher allows lookups without building a KeyType.
+template<typename KeyType, typename ValueType,
+         typename Weigher = UnitWeigher<ValueType>,
+         typename Hash = std::hash<KeyType>,
+         typename KeyEqual = std::equal_to<>>
+class ConcurrentLRUCache {
+public:
+    using ValuePtr = std::shared_ptr<const ValueType>;
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+        size_t weight = 0;
+    };
+
+    explicit ConcurrentLRUCache(size_t capacity, size_t shardCount = 16,
+                                Weigher weigher = Weigher(), Hash hash = Hash(), KeyEqual equal = KeyEqual())
+        : m_capacity(capacity)
+        , m_shardCount(std::max<size_t>(1, shardCount))
+        , m_shards(new Shard[m_shardCount])
+        , m_weigher(std::move(weigher))
+        , m_hash(std::move(hash))
+        , m_equal(std::move(equal))
+    {
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            m_shards[i].capacity = std::max<size_t>(1, capacity / m_shardCount);
+        }
+        m_maxEntryWeight = std::max<size_t>(1, m_shards[0].capacity / 4);
+    }
+
+    ConcurrentLRUCache(const ConcurrentLRUCache&) = delete;
+    ConcurrentLRUCache& operator=(const ConcurrentLRUCache&) = delete;
+
+    ValuePtr put(const KeyType& key, ValueType value) {
+        return put(key, std::make_shared<const ValueType>(std::move(value)));
+    }
+
+    // Replaces any entry for key. A value heavier than a quarter of a shard
+    // is not cached (it would flush most of its neighbours); it is still
+    // returned. A null value is ignored.
+    ValuePtr put(const KeyType& key, ValuePtr value) {
+        if (!value)
+            return nullptr;
+
+        const size_t hash = m_hash(key);
+        const size_t weight = m_weigher(*value);
+        Shard& shard = shardFor(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto existing = findLocked(shard, hash, key);
+        if (existing != shard.entries.end())
+            eraseLocked(shard, existing);
+
+        if (weight > m_maxEntryWeight)
+            return value;
+
+        shard.entries.push_front(Entry{key, value, hash, weight});
+        shard.index.emplace(hash, shard.entries.begin());
+        shard.weight += weight;
+        ++shard.insertions;
+
+        while (shard.weight > shard.capacity) {
+            eraseLocked(shard, std::prev(shard.entries.end()));
+            ++shard.evictions;
+        }
+        return value;
+    }
+
+    // Null on a miss; a hit becomes the most recently used entry
+    template<typename LookupKey>
+    ValuePtr get(const LookupKey& key) {
+        const size_t hash = m_hash(key);
+        Shard& shard = shardFor(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = findLocked(shard, hash, key);
+        if (it == shard.entries.end()) {
+            ++shard.misses;
+            return nullptr;
+        }
+
+        shard.entries.splice(shard.entries.begin(), shard.entries, it);
+        ++shard.hits;
+        return it->value;
+    }
+
+    template<typename LookupKey>
+    bool contains(const LookupKey& key) const {
+        const size_t hash = m_hash(key);
+        Shard& shard = shardFor(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return findLocked(shard, hash, key) != shard.entries.end();
+    }
+
+    template<typename LookupKey>
+    bool remove(const LookupKey& key) {
+        const size_t hash = m_hash(key);
+        Shard& shard = shardFor(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = findLocked(shard, hash, key);
+        if (it == shard.entries.end())
+            return false;
+
+        eraseLocked(shard, it);
+        return true;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+            m_shards[i].entries.clear();
+            m_shards[i].index.clear();
+            m_shards[i].weight = 0;
+        }
+    }
+
+    // Sums over all shards; each shard is consistent, the total is a snapshot
+    Stats stats() const {
+        Stats total;
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            const Shard& shard = m_shards[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total.hits += shard.hits;
+            total.misses += shard.misses;
+            total.insertions += shard.insertions;
+            total.evictions += shard.evictions;
+            total.entries += shard.entries.size();
+            total.weight += shard.weight;
+        }
+        return total;
+    }
+
+    size_t size() const { return stats().entries; }
+    size_t weight() const { return stats().weight; }
+    size_t capacity() const { return m_capacity; }
+
+private:
+    struct Entry {
+        KeyType key;
+        ValuePtr value;
+        size_t hash;
+        size_t weight;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    // Own cache line each, so neighbouring shard locks do not false-share
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        EntryList entries;                                              // most recent first
+        std::unordered_multimap<size_t, typename EntryList::iterator> index;   // by key hash
+        size_t weight = 0;
+        size_t capacity = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t insertions = 0;
+        uint64_t evictions = 0;
+    };
+
+    Shard& shardFor(size_t hash) const {
+        // std::hash is the identity for integers; mix before picking a shard
+        const uint64_t mixed = uint64_t(hash) * 0x9E3779B97F4A7C15ull;
+        return m_shards[(mixed >> 32) % m_shardCount];
+    }
+
+    template<typename LookupKey>
+    typename EntryList::iterator findLocked(Shard& shard, size_t hash, const LookupKey& key) const {
+        auto range = shard.index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (m_equal(it->second->key, key))
+                return it->second;
+        }
+        return shard.entries.end();
+    }
+
+    void eraseLocked(Shard& shard, typename EntryList::iterator entry) {
+        auto range = shard.index.equal_range(entry->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == entry) {
+                shard.index.erase(it);
+                break;
+            }
+        }
+        shard.weight -= entry->weight;
+        shard.entries.erase(entry);
+    }
+
+    size_t m_capacity;
+    size_t m_shardCount;
+    std::unique_ptr<Shard[]> m_shards;
+    size_t m_maxEntryWeight;
+    Weigher m_weigher;
+    Hash m_hash;
+    KeyEqual m_equal;
+};
+
 #endif // CACHE_H
@@ -3,6 +3,11 @@
 
 #include <vector>
 #include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 // Class template (Concept #13)
 template<typename T>
@@ -91,4 +96,169 @@ private:
     size_t m_tail;
 };
 
+// Wait-free ring buffer for exactly one producer thread and one consumer
+// thread, e.g. a decoder feeding an audio callback. Capacity is rounded up
+// to a power of two so positions wrap with a mask; head and tail are free
+// running counters on separate cache lines, each side keeping a cached copy
+// of the other's. Nothing is overwritten and nothing throws: pushN() stores
+// what fits and counts an overrun if that was not everything, popN() takes
+// what is there and counts an underrun if that was short. writeSpans() /
+// readSpans() expose the free or filled region as at most two contiguous
+// pieces for callers that fill or drain it in place, followed by
+// commitWrite() / commitRead().
+template<typename T>
+class SpscRingBuffer {
+    static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer moves items with memcpy");
+
+public:
+    struct Span {
+        T* data = nullptr;
+        size_t size = 0;
+    };
+
+    // The region in order: first, then second (empty unless it wraps)
+    struct Spans {
+        Span first;
+        Span second;
+
+        size_t size() const { return first.size + second.size; }
+    };
+
+    explicit SpscRingBuffer(size_t minimumCapacity = 1) { reset(minimumCapacity); }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // Only while neither side is using the buffer
+    void reset(size_t minimumCapacity) {
+        size_t capacity = 1;
+        while (capacity < minimumCapacity) {
+            capacity <<= 1;
+        }
+        m_buffer.assign(capacity, T());
+        m_mask = capacity - 1;
+        clear();
+    }
+
+    void clear() {
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_cachedHead = 0;
+        m_cachedTail = 0;
+        m_overruns.store(0, std::memory_order_relaxed);
+        m_underruns.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Snapshot from any thread
+    size_t size() const {
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        return m_head.load(std::memory_order_acquire) - tail;
+    }
+
+    uint64_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return m_underruns.load(std::memory_order_relaxed); }
+
+    // ==================== Producer ====================
+
+    size_t writeAvailable() { return freeSpace(capacity()); }
+
+    Spans writeSpans() {
+        return spansAt(m_head.load(std::memory_order_relaxed), freeSpace(capacity()));
+    }
+
+    void commitWrite(size_t count) {
+        m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    size_t pushN(const T* items, size_t count) {
+        const size_t n = std::min(count, freeSpace(count));
+        const Spans spans = spansAt(m_head.load(std::memory_order_relaxed), n);
+        std::memcpy(spans.first.data, items, spans.first.size * sizeof(T));
+        std::memcpy(spans.second.data, items + spans.first.size, spans.second.size * sizeof(T));
+        commitWrite(n);
+
+        if (n < count) {
+            m_overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // ==================== Consumer ====================
+
+    size_t readAvailable() { return filledSpace(capacity()); }
+
+    Spans readSpans() {
+        return spansAt(m_tail.load(std::memory_order_relaxed), filledSpace(capacity()));
+    }
+
+    void commitRead(size_t count) {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    size_t popN(T* items, size_t count) {
+        const size_t n = std::min(count, filledSpace(count));
+        const Spans spans = spansAt(m_tail.load(std::memory_order_relaxed), n);
+        std::memcpy(items, spans.first.data, spans.first.size * sizeof(T));
+        std::memcpy(items + spans.first.size, spans.second.data, spans.second.size * sizeof(T));
+        commitRead(n);
+
+        if (n < count) {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    size_t discard(size_t count) {
+        const size_t n = std::min(count, filledSpace(count));
+        commitRead(n);
+        return n;
+    }
+
+private:
+    static constexpr size_t kCacheLine = 64;
+
+    // The other side's counter is only reloaded when the cached one says
+    // there is not enough room (or data)
+    size_t freeSpace(size_t wanted) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t free = capacity() - (head - m_cachedTail);
+        if (free < wanted) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            free = capacity() - (head - m_cachedTail);
+        }
+        return free;
+    }
+
+    size_t filledSpace(size_t wanted) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t filled = m_cachedHead - tail;
+        if (filled < wanted) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            filled = m_cachedHead - tail;
+        }
+        return filled;
+    }
+
+    Spans spansAt(size_t position, size_t count) {
+        const size_t start = position & m_mask;
+        const size_t first = std::min(count, capacity() - start);
+        return {{m_buffer.data() + start, first}, {m_buffer.data(), count - first}};
+    }
+
+    std::vector<T> m_buffer;
+    size_t m_mask = 0;
+
+    // Written by the producer
+    alignas(kCacheLine) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    std::atomic<uint64_t> m_overruns{0};
+
+    // Written by the consumer
+    alignas(kCacheLine) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+    std::atomic<uint64_t> m_underruns{0};
+};
+
 #endif // CIRCULARBUFFER_H
@@ -1,18 +1,42 @@
 // ===== LibraryModel.cpp (Complete Rewrite) =====
 
 #include "LibraryModel.h"
-#include "AudioException.h"
+#include "AlbumArtProvider.h"
+#include "LibraryScanner.h"
+#include "RowDiff.h"
+#include "ScanJournal.h"
 #include <algorithm>
 #include <QDebug>
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QSet>
+#include <QTimer>
+#include <QVariantMap>
 
 LibraryModel::LibraryModel(QObject* parent)
     : QAbstractListModel(parent)
-    , m_currentFilter("All Tracks")
+    , m_sortIndex(m_allTracks)
+    , m_queryExecutor(new QueryExecutor(this))
+    , m_scanner(new LibraryScanner(this))
+    , m_searchTimer(new QTimer(this))
 {
+    // Keystrokes queued behind a slow frame collapse into the latest query
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(0);
+    connect(m_searchTimer, &QTimer::timeout, this, &LibraryModel::applySearch);
+    connect(m_queryExecutor, &QueryExecutor::resultReady, this, &LibraryModel::onQueryResult);
+
+    m_scanner->setJournalFile(ScanJournal::defaultLocation("library.journal"));
+    m_scanner->setWatchEnabled(true);
+
+    connect(m_scanner, &LibraryScanner::tracksScanned, this, &LibraryModel::onTracksScanned);
+    connect(m_scanner, &LibraryScanner::tracksUnchanged, this, &LibraryModel::onTracksUnchanged);
+    connect(m_scanner, &LibraryScanner::tracksRemoved, this, &LibraryModel::onTracksRemoved);
+    connect(m_scanner, &LibraryScanner::scanFinished, this, &LibraryModel::onScanFinished);
+    connect(m_scanner, &LibraryScanner::liveChangesApplied, this, &LibraryModel::onLiveChangesApplied);
+    connect(m_scanner, &LibraryScanner::progressChanged, this, &LibraryModel::scanProgressChanged);
+    connect(m_scanner, &LibraryScanner::errorOccurred, this, &LibraryModel::errorOccurred);
+
     qDebug() << "LibraryModel created";
 }
 
@@ -35,7 +59,7 @@ QVariant LibraryModel::data(const QModelIndex& index, int role) const
     if (row < 0 || row >= static_cast<int>(m_displayedTracks.size()))
         return QVariant();
 
-    const Track& track = m_displayedTracks[row];
+    const Track& track = m_allTracks[m_displayedTracks[row]];
 
     switch (role) {
     case PathRole:
@@ -55,7 +79,8 @@ QVariant LibraryModel::data(const QModelIndex& index, int role) const
     case PlayCountRole:
         return track.playCount();
     case AlbumArtRole:
-        return QString();
+        // Resolved and downscaled off the GUI thread by AlbumArtProvider
+        return AlbumArtProvider::urlFor(track.path());
     default:
         return QVariant();
     }
@@ -80,11 +105,9 @@ QHash<int, QByteArray> LibraryModel::roleNames() const
 
 void LibraryModel::refresh()
 {
-    beginResetModel();
     updateDisplayedTracks();
-    endResetModel();
 
-    computeStats();
+    // Stats are kept current by the store; this only re-notifies bindings
     emit statsChanged();
 
     qDebug() << "Library refreshed. Displayed tracks:" << m_displayedTracks.size();
@@ -92,35 +115,42 @@ void LibraryModel::refresh()
 
 void LibraryModel::search(const QString& query)
 {
-    m_searchQuery = query.trimmed();
+    // Applied on the next event loop pass; a newer query replaces a pending one
+    m_pendingQuery = query.trimmed();
+    m_searchTimer->start();
+}
+
+void LibraryModel::applySearch()
+{
+    if (m_pendingQuery == m_searchQuery)
+        return;
+
+    m_searchQuery = m_pendingQuery;
 
-    beginResetModel();
     updateDisplayedTracks();
-    endResetModel();
 
-    qDebug() << "Search results for:" << query << "- Found:" << m_displayedTracks.size();
+    qDebug() << "Searching for:" << m_searchQuery;
 }
 
 void LibraryModel::setFilter(const QString& filter)
 {
-    if (m_currentFilter == filter)
+    if (m_filter.name() == filter)
         return;
 
-    m_currentFilter = filter;
+    // Parsed once here; the query runs the compiled plan
+    m_filter = TrackFilter(filter);
+    if (!m_filter.isValid())
+        qWarning() << "Filter ignored:" << m_filter.errorString();
 
-    beginResetModel();
     updateDisplayedTracks();
-    endResetModel();
 
-    qDebug() << "Filter set to:" << filter << "- Displayed:" << m_displayedTracks.size();
+    qDebug() << "Filter set to:" << filter;
 }
 
 void LibraryModel::scanDirectory(const QString& path)
 {
     qDebug() << "Scanning directory:" << path;
 
-    QStringList audioExtensions = {"*.mp3", "*.flac", "*.ogg", "*.wav", "*.m4a", "*.aac"};
-
     QDir dir(path);
     if (!dir.exists()) {
         qWarning() << "Directory does not exist:" << path;
@@ -128,91 +158,84 @@ void LibraryModel::scanDirectory(const QString& path)
         return;
     }
 
-    // Clear existing tracks
-    beginResetModel();
-    m_allTracks.clear();
-    m_displayedTracks.clear();
-    endResetModel();
-
-    QDirIterator it(path, audioExtensions, QDir::Files, QDirIterator::Subdirectories);
-
-    int count = 0;
-    int totalFound = 0;
-
-    // First pass: count total files
-    QDirIterator countIt(path, audioExtensions, QDir::Files, QDirIterator::Subdirectories);
-    while (countIt.hasNext() && totalFound < m_scanItemLimit) {
-        countIt.next();
-        totalFound++;
+    // Rescanning the same root keeps the library and applies only the differences
+    const QString root = QDir::cleanPath(path);
+    if (root != m_scanRoot) {
+        beginResetModel();
+        clearTrackStore();
+        m_displayedTracks.clear();
+        m_unfetchedTracks.clear();
+        m_unfetchedOffset = 0;
+        endResetModel();
+        m_scanRoot = root;
     }
 
-    qDebug() << "Found" << totalFound << "audio files to scan";
+    // Tracks arrive in batches through onTracksScanned()/onTracksUnchanged()
+    m_scanner->scanDirectory(root);
+}
 
-    // Second pass: load tracks
-    while (it.hasNext()) {
-        QString filePath = it.next();
+void LibraryModel::sortBy(const QString& field)
+{
+    if (field.isEmpty())
+        return;
 
-        try {
-            Track track(filePath);
-            m_allTracks.push_back(track);
-            count++;
+    // Unknown names fall back to title order; play count sorts most played first
+    TrackSortIndex::SortKey key;
+    TrackSortIndex::fieldFromName(field, &key.field);
+    key.descending = key.field == TrackSortIndex::PlayCount;
 
-            // Emit progress
-            if (count % 10 == 0) {
-                emit scanProgressChanged(count, totalFound);
-            }
-        }
-        catch (const AudioException& e) {
-            qWarning() << "Failed to load track:" << filePath << "-" << e.what();
-        }
-        catch (const std::exception& e) {
-            qWarning() << "Failed to load track:" << filePath << "-" << e.what();
-        }
+    applySortSpec({key});
 
-        if (count >= m_scanItemLimit) {
-            qWarning() << "Reached" << m_scanItemLimit << "track limit. Stopping scan.";
-            break;
+    qDebug() << "Sorting by:" << field;
+}
+
+void LibraryModel::setSortSpec(const QVariantList& spec)
+{
+    // Entries are field names or {"field": name, "descending": bool} maps
+    TrackSortIndex::SortSpec parsed;
+    for (const QVariant& entry : spec) {
+        const QVariantMap map = entry.toMap();
+        const QString name = map.isEmpty() ? entry.toString() : map.value("field").toString();
+
+        TrackSortIndex::SortKey key;
+        if (!TrackSortIndex::fieldFromName(name, &key.field)) {
+            qWarning() << "Ignoring unknown sort field:" << name;
+            continue;
         }
+        key.descending = map.value("descending", false).toBool();
+        parsed.push_back(key);
     }
 
-    // Update displayed list
-    beginResetModel();
-    updateDisplayedTracks();
-    endResetModel();
-
-    computeStats();
-    emit statsChanged();
-    emit scanProgressChanged(count, totalFound);
+    applySortSpec(parsed);
 
-    qDebug() << "Scan complete. Loaded" << count << "tracks";
+    qDebug() << "Sort spec set:" << spec;
 }
 
-void LibraryModel::sortBy(const QString& field)
+void LibraryModel::applySortSpec(const TrackSortIndex::SortSpec& spec)
 {
-    if (field.isEmpty())
-        return;
-
-    m_lastSortField = field;
-
-    beginResetModel();
-    sortDisplayedTracks(field);
-    endResetModel();
-
-    qDebug() << "Sorted by:" << field << "- Tracks:" << m_displayedTracks.size();
+    m_sortSpec = spec;
+    updateDisplayedTracks();
 }
 
 void LibraryModel::clearLibrary()
 {
+    m_scanner->cancel();
+    m_scanner->stopWatching();
+
     beginResetModel();
-    m_allTracks.clear();
+    clearTrackStore();
     m_displayedTracks.clear();
+    m_unfetchedTracks.clear();
+    m_unfetchedOffset = 0;
     endResetModel();
 
+    m_scanRoot.clear();
+    m_searchTimer->stop();
     m_searchQuery.clear();
-    m_currentFilter = "All Tracks";
-    m_lastSortField.clear();
+    m_pendingQuery.clear();
+    m_filter = TrackFilter();
+    m_sortSpec.clear();
 
-    computeStats();
     emit statsChanged();
 
     qDebug() << "Library cleared";
@@ -220,190 +243,465 @@ void LibraryModel::clearLibrary()
 
 QString LibraryModel::getTrackPath(int index) const
 {
-    if (index >= 0 && index < static_cast<int>(m_displayedTracks.size())) {
-        return m_displayedTracks[index].path();
+    // Any result position, fetched or not
+    const int fetched = static_cast<int>(m_displayedTracks.size());
+    if (index >= 0 && index < fetched) {
+        return m_allTracks[m_displayedTracks[index]].path();
+    }
+    if (index >= fetched && size_t(index - fetched) < unfetchedCount()) {
+        return m_allTracks[m_unfetchedTracks[m_unfetchedOffset + index - fetched]].path();
     }
     return QString();
 }
 
-// ==================== Private Helper Methods ====================
+QStringList LibraryModel::displayedTrackPaths() const
+{
+    QStringList paths;
+    paths.reserve(static_cast<int>(m_displayedTracks.size() + unfetchedCount()));
+    for (int slot : resultTracks()) {
+        paths.append(m_allTracks[slot].path());
+    }
+    return paths;
+}
 
-void LibraryModel::updateDisplayedTracks()
+// ==================== Paging ====================
+
+bool LibraryModel::canFetchMore(const QModelIndex& parent) const
 {
-    m_displayedTracks.clear();
+    return !parent.isValid() && unfetchedCount() > 0;
+}
 
-    const bool hasQuery = !m_searchQuery.isEmpty();
-    const QString lowerQuery = m_searchQuery.toLower();
-
-    for (const Track& track : m_allTracks) {
-        // Apply search filter
-        if (hasQuery) {
-            bool matches = false;
-
-            if (track.title().toLower().contains(lowerQuery))
-                matches = true;
-            else if (track.artist().toLower().contains(lowerQuery))
-                matches = true;
-            else if (track.album().toLower().contains(lowerQuery))
-                matches = true;
-            else if (track.genre().toLower().contains(lowerQuery))
-                matches = true;
-
-            if (!matches)
-                continue;
-        }
+void LibraryModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid() || unfetchedCount() == 0)
+        return;
 
-        // Apply category filter
-        if (!trackMatchesFilter(track))
-            continue;
+    const size_t count = std::min(unfetchedCount(), size_t(kFetchPageSize));
+    const int first = static_cast<int>(m_displayedTracks.size());
+    const auto from = m_unfetchedTracks.begin() + m_unfetchedOffset;
 
-        m_displayedTracks.push_back(track);
+    beginInsertRows(QModelIndex(), first, first + static_cast<int>(count) - 1);
+    m_displayedTracks.insert(m_displayedTracks.end(), from, from + count);
+    m_unfetchedOffset += count;
+    endInsertRows();
+
+    if (unfetchedCount() == 0) {
+        m_unfetchedTracks.clear();
+        m_unfetchedOffset = 0;
     }
+}
+
+std::vector<int> LibraryModel::resultTracks() const
+{
+    std::vector<int> result = m_displayedTracks;
+    result.insert(result.end(), m_unfetchedTracks.begin() + m_unfetchedOffset, m_unfetchedTracks.end());
+    return result;
+}
 
-    // Apply last sort if any
-    if (!m_lastSortField.isEmpty()) {
-        sortDisplayedTracks(m_lastSortField);
+// ==================== Scanner Callbacks ====================
+
+void LibraryModel::onTracksScanned(const QVector<Track>& tracks)
+{
+    std::vector<int> added;
+    QSet<int> modified;
+    for (const Track& track : tracks) {
+        bool isNew = false;
+        const int slot = storeTrack(track, &isNew);
+        if (isNew) {
+            added.push_back(slot);
+        } else {
+            modified.insert(slot);
+            m_displayDirty = true;   // may no longer match the filter or sort
+        }
     }
 
-    qDebug() << "Displayed tracks updated. Count:" << m_displayedTracks.size();
+    // A replaced track may sort elsewhere now (unless it is new in this batch)
+    const QSet<int> addedSet(added.cbegin(), added.cend());
+    std::vector<int> replaced;
+    for (int slot : modified) {
+        if (!addedSet.contains(slot))
+            replaced.push_back(slot);
+    }
+    m_sortIndex.remove(replaced);
+    m_sortIndex.insert(replaced);
+    m_sortIndex.insert(added);
+
+    // Rows read straight from the store, so a modified track only needs a repaint
+    if (!modified.isEmpty()) {
+        for (int row = 0; row < static_cast<int>(m_displayedTracks.size()); ++row) {
+            if (modified.contains(m_displayedTracks[row]))
+                emit dataChanged(index(row, 0), index(row, 0));
+        }
+    }
+
+    appendDisplayed(added);
+    emit statsChanged();
 }
 
-void LibraryModel::computeStats()
+void LibraryModel::onTracksUnchanged(const QVector<Track>& tracks)
 {
-    m_totalTracks = static_cast<int>(m_allTracks.size());
-    m_totalDuration = 0;
+    // Journal hits are only news when this model has not seen them yet
+    std::vector<int> added;
+    for (const Track& track : tracks) {
+        if (!m_pathIndex.contains(track.path()))
+            added.push_back(storeTrack(track));
+    }
+    m_sortIndex.insert(added);
+    appendDisplayed(added);
 
-    QSet<QString> artists;
-    QSet<QString> albums;
+    if (!added.empty())
+        emit statsChanged();
+}
+
+void LibraryModel::onTracksRemoved(const QStringList& paths)
+{
+    QSet<int> released;
+    for (const QString& path : paths) {
+        const int slot = m_pathIndex.value(path, -1);
+        if (slot >= 0 && releaseTrack(path))
+            released.insert(slot);
+    }
+
+    if (released.isEmpty())
+        return;
 
-    for (const Track& track : m_allTracks) {
-        // Collect unique artists and albums
-        QString artist = track.artist();
-        QString album = track.album();
+    m_sortIndex.remove(std::vector<int>(released.cbegin(), released.cend()));
 
-        if (!artist.isEmpty() && artist != "Unknown Artist")
-            artists.insert(artist);
+    // Drop their rows now: a freed slot may be reused by the next batch
+    for (int row = static_cast<int>(m_displayedTracks.size()) - 1; row >= 0; --row) {
+        if (!released.contains(m_displayedTracks[row]))
+            continue;
 
-        if (!album.isEmpty() && album != "Unknown Album")
-            albums.insert(album);
+        const int last = row;
+        while (row > 0 && released.contains(m_displayedTracks[row - 1]))
+            --row;
 
-        m_totalDuration += static_cast<qint64>(track.duration());
+        beginRemoveRows(QModelIndex(), row, last);
+        m_displayedTracks.erase(m_displayedTracks.begin() + row, m_displayedTracks.begin() + last + 1);
+        endRemoveRows();
     }
 
-    m_totalArtists = artists.size();
-    m_totalAlbums = albums.size();
+    // Unfetched positions have no rows to announce
+    m_unfetchedTracks.erase(std::remove_if(m_unfetchedTracks.begin() + m_unfetchedOffset, m_unfetchedTracks.end(),
+                                           [&released](int slot) { return released.contains(slot); }),
+                            m_unfetchedTracks.end());
 
-    qDebug() << "Stats - Tracks:" << m_totalTracks
-             << "Artists:" << m_totalArtists
-             << "Albums:" << m_totalAlbums
-             << "Duration:" << m_totalDuration << "ms";
+    emit statsChanged();
 }
 
-bool LibraryModel::trackMatchesFilter(const Track& track) const
+void LibraryModel::onScanFinished(int processed, bool cancelled)
 {
-    // "All Tracks" shows everything
-    if (m_currentFilter.isEmpty() || m_currentFilter == "All Tracks")
-        return true;
+    settleDisplayedTracks();
+
+    qDebug() << "Scan" << (cancelled ? "cancelled." : "complete.")
+             << "Processed" << processed << "files, library has" << m_pathIndex.size() << "tracks";
+    qDebug() << "Stats - Tracks:" << totalTracks()
+             << "Artists:" << totalArtists()
+             << "Albums:" << totalAlbums()
+             << "Duration:" << totalDuration() << "ms";
+}
 
-    // Filter by category
-    if (m_currentFilter == "Artists") {
-        // When viewing by artists, show all tracks (grouping handled by view)
-        return true;
-    }
+void LibraryModel::onLiveChangesApplied(int processed)
+{
+    settleDisplayedTracks();
+    qDebug() << "Live update applied. Parsed" << processed << "files, library has" << m_pathIndex.size() << "tracks";
+}
 
-    if (m_currentFilter == "Albums") {
-        // When viewing by albums, show all tracks (grouping handled by view)
-        return true;
+// ==================== Private Helper Methods ====================
+
+void LibraryModel::settleDisplayedTracks()
+{
+    // Batches were appended in arrival order; restore the requested sort
+    if (m_displayDirty || !m_sortSpec.empty()) {
+        updateDisplayedTracks();
+        m_displayDirty = false;
     }
 
-    if (m_currentFilter == "Genres") {
-        // When viewing by genres, show all tracks (grouping handled by view)
-        return true;
+    emit statsChanged();
+}
+
+int LibraryModel::storeTrack(const Track& track, bool* isNew)
+{
+    releaseSnapshot();
+
+    auto it = m_pathIndex.constFind(track.path());
+    if (it != m_pathIndex.cend()) {
+        m_filterIndex.remove(it.value(), m_allTracks[it.value()]);
+        m_stats.remove(m_allTracks[it.value()]);
+        m_allTracks[it.value()] = track;
+        m_searchIndex.add(it.value(), track);
+        m_filterIndex.add(it.value(), track);
+        m_stats.add(track);
+        ++m_storeVersion;
+        if (isNew)
+            *isNew = false;
+        return it.value();
     }
 
-    // Filter by favorites (example: play count >= 5)
-    if (m_currentFilter == "Favorites") {
-        return track.playCount() >= 5;
+    int slot;
+    if (!m_freeSlots.empty()) {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_allTracks[slot] = track;
+    } else {
+        slot = static_cast<int>(m_allTracks.size());
+        m_allTracks.push_back(track);
     }
 
-    // Filter by recently played (example: played in last 7 days)
-    if (m_currentFilter == "Recently Played") {
-        QDateTime lastPlayed = track.lastPlayed();
-        if (lastPlayed.isValid()) {
-            qint64 daysAgo = lastPlayed.daysTo(QDateTime::currentDateTime());
-            return daysAgo <= 7;
-        }
+    m_pathIndex.insert(track.path(), slot);
+    m_searchIndex.add(slot, track);
+    m_filterIndex.add(slot, track);
+    m_stats.add(track);
+    ++m_storeVersion;
+    if (isNew)
+        *isNew = true;
+    return slot;
+}
+
+bool LibraryModel::releaseTrack(const QString& path)
+{
+    auto it = m_pathIndex.find(path);
+    if (it == m_pathIndex.end())
         return false;
-    }
 
-    // Custom filter matching artist/album/genre name
-    if (m_currentFilter.startsWith("artist:", Qt::CaseInsensitive)) {
-        QString artistName = m_currentFilter.mid(7).trimmed();
-        return track.artist().compare(artistName, Qt::CaseInsensitive) == 0;
-    }
+    releaseSnapshot();
 
-    if (m_currentFilter.startsWith("album:", Qt::CaseInsensitive)) {
-        QString albumName = m_currentFilter.mid(6).trimmed();
-        return track.album().compare(albumName, Qt::CaseInsensitive) == 0;
+    // Slots stay put so indices held elsewhere remain valid; an empty path marks them free
+    m_filterIndex.remove(it.value(), m_allTracks[it.value()]);
+    m_stats.remove(m_allTracks[it.value()]);
+    m_allTracks[it.value()] = Track();
+    m_searchIndex.remove(it.value());
+    ++m_storeVersion;
+    m_freeSlots.push_back(it.value());
+    m_pathIndex.erase(it);
+    return true;
+}
+
+void LibraryModel::clearTrackStore()
+{
+    m_allTracks.clear();
+    m_pathIndex.clear();
+    m_freeSlots.clear();
+    m_searchIndex.clear();
+    m_filterIndex.clear();
+    m_stats.clear();
+    m_sortIndex.clear();
+    ++m_storeVersion;
+    m_displayDirty = false;
+
+    // In-flight results and cached matches refer to the old slots
+    m_queryExecutor->cancel();
+    releaseSnapshot();
+    m_searchMatches.reset();
+}
+
+void LibraryModel::appendDisplayed(const std::vector<int>& batch)
+{
+    // Append the matching part of a batch without resetting the view
+    const QString query = SearchIndex::normalize(m_searchQuery);
+    std::vector<int> matching;
+    for (int slot : batch) {
+        if (m_searchIndex.matches(slot, query) && m_filter.matches(m_allTracks[slot]))
+            matching.push_back(slot);
     }
 
-    if (m_currentFilter.startsWith("genre:", Qt::CaseInsensitive)) {
-        QString genreName = m_currentFilter.mid(6).trimmed();
-        return track.genre().compare(genreName, Qt::CaseInsensitive) == 0;
+    if (matching.empty())
+        return;
+
+    // Rows are only added up to the first page; the rest queue up for fetchMore()
+    size_t room = 0;
+    if (unfetchedCount() == 0 && m_displayedTracks.size() < size_t(kFetchPageSize))
+        room = std::min(matching.size(), size_t(kFetchPageSize) - m_displayedTracks.size());
+
+    m_unfetchedTracks.insert(m_unfetchedTracks.end(), matching.begin() + room, matching.end());
+
+    if (room == 0)
+        return;
+
+    const int first = static_cast<int>(m_displayedTracks.size());
+    const int last = first + static_cast<int>(room) - 1;
+
+    beginInsertRows(QModelIndex(), first, last);
+    m_displayedTracks.insert(m_displayedTracks.end(), matching.begin(), matching.begin() + room);
+    endInsertRows();
+}
+
+void LibraryModel::updateDisplayedTracks()
+{
+    LibraryQuery query;
+    query.search = SearchIndex::normalize(m_searchQuery);
+    query.filter = m_filter;
+    query.sort = m_sortSpec;
+
+    std::shared_ptr<const QuerySnapshot> snapshot = querySnapshot();
+
+    // Anything matching a longer query also matched the one it contains,
+    // so "beat" -> "beatl" only re-checks the previous hits
+    if (m_searchMatches && m_matchesVersion == snapshot->version
+        && !m_matchedQuery.isEmpty() && query.search.contains(m_matchedQuery)) {
+        query.candidates = m_searchMatches;
     }
 
-    // Unknown filter: accept all
-    return true;
+    m_queryExecutor->submit(std::move(snapshot), query);
 }
 
-void LibraryModel::sortDisplayedTracks(const QString& field)
+std::shared_ptr<const QuerySnapshot> LibraryModel::querySnapshot()
 {
-    if (field.isEmpty())
-        return;
+    const bool current = m_snapshot && m_snapshot->version == m_storeVersion;
 
-    if (field == "Title") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.title().toLower() < b.title().toLower();
-                  });
+    bool missingRanks = false;
+    for (const TrackSortIndex::SortKey& key : m_sortSpec) {
+        if (!current || m_snapshot->ranks[key.field].size() != m_allTracks.size())
+            missingRanks = true;
     }
-    else if (field == "Artist") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.artist().toLower() < b.artist().toLower();
-                  });
+
+    if (current && !missingRanks)
+        return m_snapshot;
+
+    // Same store, new sort field: keep the copied tracks and ranks already taken
+    auto snapshot = current ? std::make_shared<QuerySnapshot>(*m_snapshot)
+                            : std::make_shared<QuerySnapshot>();
+    if (!current) {
+        snapshot->version = m_storeVersion;
+        snapshot->tracks = m_allTracks;
+        snapshot->searchIndex = m_searchIndex;
+        snapshot->filterIndex = m_filterIndex;
     }
-    else if (field == "Album") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.album().toLower() < b.album().toLower();
-                  });
+
+    for (const TrackSortIndex::SortKey& key : m_sortSpec) {
+        std::vector<int>& ranks = snapshot->ranks[key.field];
+        if (ranks.size() != m_allTracks.size())
+            ranks = m_sortIndex.denseRanks(key.field);
     }
-    else if (field == "Duration") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.duration() < b.duration();
-                  });
+
+    m_snapshot = snapshot;
+    return m_snapshot;
+}
+
+void LibraryModel::releaseSnapshot()
+{
+    // The snapshot shares the index hashes; holding on to it while the store
+    // changes would deep-copy them on the next write. Queries still running
+    // keep their own reference.
+    m_snapshot.reset();
+}
+
+void LibraryModel::onQueryResult(const QueryResult& result)
+{
+    m_searchMatches = result.matches;
+    m_matchesVersion = result.snapshot->version;
+    m_matchedQuery = result.search;
+
+    const QuerySnapshot& snapshot = *result.snapshot;
+    const auto unchangedSince = [this, &snapshot](int slot) {
+        return snapshot.version == m_storeVersion
+            || (slot < static_cast<int>(snapshot.tracks.size())
+                && !m_allTracks[slot].path().isEmpty()
+                && m_allTracks[slot].path() == snapshot.tracks[slot].path());
+    };
+
+    // Rows of tracks released while the query ran are dropped; tracks that
+    // arrived meanwhile were appended by appendDisplayed() and stay at the end
+    std::vector<int> next;
+    next.reserve(result.rows.size());
+    for (int slot : result.rows) {
+        if (unchangedSince(slot))
+            next.push_back(slot);
     }
-    else if (field == "Year") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.year() < b.year();
-                  });
+    if (snapshot.version != m_storeVersion) {
+        for (int slot : resultTracks()) {
+            if (!unchangedSince(slot))
+                next.push_back(slot);
+        }
     }
-    else if (field == "PlayCount") {
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.playCount() > b.playCount(); // Descending order
-                  });
+
+    syncDisplayedTracks(std::move(next));
+
+    qDebug() << "Displayed tracks updated. Count:" << m_displayedTracks.size() + unfetchedCount();
+}
+
+void LibraryModel::syncDisplayedTracks(std::vector<int> next)
+{
+    // Rows are identified by slot; freed slots never stay on screen (see
+    // onTracksRemoved), so a slot always means the same track.
+    //
+    // Only as many rows as were fetched (at least a page) are diffed; the
+    // rest of next waits for fetchMore().
+    const size_t fetched = std::min(next.size(), std::max(m_displayedTracks.size(), size_t(kFetchPageSize)));
+    m_unfetchedTracks.assign(next.begin() + fetched, next.end());
+    m_unfetchedOffset = 0;
+    next.resize(fetched);
+
+    // Forwards the edit script to the model's change notifications
+    class Notifier : public RowDiff::Listener
+    {
+    public:
+        explicit Notifier(LibraryModel& model) : m_model(model) {}
+
+        void beginReset() override { m_model.beginResetModel(); }
+        void endReset() override { m_model.endResetModel(); }
+        void beginRemove(int first, int last) override { m_model.beginRemoveRows(QModelIndex(), first, last); }
+        void endRemove() override { m_model.endRemoveRows(); }
+        void beginMove(int from, int destination) override
+        {
+            m_model.beginMoveRows(QModelIndex(), from, from, QModelIndex(), destination);
+        }
+        void endMove() override { m_model.endMoveRows(); }
+        void beginInsert(int first, int last) override { m_model.beginInsertRows(QModelIndex(), first, last); }
+        void endInsert() override { m_model.endInsertRows(); }
+        void beginLayoutChange() override { emit m_model.layoutAboutToBeChanged(); }
+        void endLayoutChange(const std::vector<int>& newRows) override
+        {
+            const int count = static_cast<int>(newRows.size());
+            const QModelIndexList persistent = m_model.persistentIndexList();
+            for (const QModelIndex& oldIndex : persistent) {
+                if (oldIndex.row() < count)
+                    m_model.changePersistentIndex(oldIndex, m_model.index(newRows[oldIndex.row()], 0));
+            }
+            emit m_model.layoutChanged();
+        }
+
+    private:
+        LibraryModel& m_model;
+    };
+
+    Notifier notifier(*this);
+    RowDiff(kMaxRowOperations, kMaxRowMoves).apply(m_displayedTracks, std::move(next), m_allTracks.size(), notifier);
+}
+
+QVariantList LibraryModel::genreHistogram() const
+{
+    // Most common first
+    const QHash<StringPool::Symbol, int>& counts = m_stats.genreHistogram();
+    std::vector<std::pair<int, StringPool::Symbol>> genres;
+    genres.reserve(counts.size());
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        genres.emplace_back(it.value(), it.key());
     }
-    else {
-        // Default to title sort
-        std::sort(m_displayedTracks.begin(), m_displayedTracks.end(),
-                  [](const Track& a, const Track& b) {
-                      return a.title().toLower() < b.title().toLower();
-                  });
+    std::sort(genres.begin(), genres.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    const StringPool& pool = StringPool::instance();
+    QVariantList histogram;
+    for (const auto& genre : genres) {
+        QVariantMap entry;
+        entry["genre"] = pool.string(genre.second);
+        entry["count"] = genre.first;
+        histogram.append(entry);
     }
+    return histogram;
+}
+
+QVariantList LibraryModel::yearHistogram() const
+{
+    QVariantList histogram;
+    const QMap<int, int>& counts = m_stats.yearHistogram();
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        QVariantMap entry;
+        entry["year"] = it.key();
+        entry["count"] = it.value();
+        histogram.append(entry);
+    }
+    return histogram;
 }
 
 bool LibraryModel::saveAsM3UPlaylist(const QString& filePath)
@@ -421,8 +719,11 @@ bool LibraryModel::saveAsM3UPlaylist(const QString& filePath)
     // Write M3U header
     out << "#EXTM3U\n";
 
-    // Write each track
-    for (const Track& track : m_displayedTracks) {
+    // Write each track, including rows the view has not fetched
+    const std::vector<int> result = resultTracks();
+    for (int slot : result) {
+        const Track& track = m_allTracks[slot];
+
         // Format: #EXTINF:duration_in_seconds,Artist - Title
         qint64 durationSeconds = track.duration() / 1000;
         out << "#EXTINF:" << durationSeconds << ","
@@ -432,6 +733,6 @@ bool LibraryModel::saveAsM3UPlaylist(const QString& filePath)
 
     file.close();
 
-    qDebug() << "Saved" << m_displayedTracks.size() << "tracks to playlist:" << filePath;
+    qDebug() << "Saved" << result.size() << "tracks to playlist:" << filePath;
     return true;
 }
@@ -4,11 +4,21 @@
 #define LIBRARYMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QObject>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+#include <memory>
 #include <vector>
 #include <set>
+#include "LibraryQuery.h"
+#include "LibraryStats.h"
 #include "Track.h"
 
+class LibraryScanner;
+class QTimer;
+
 class LibraryModel : public QAbstractListModel {
     Q_OBJECT
 
@@ -40,54 +50,129 @@ public:
     QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
     QHash<int, QByteArray> roleNames() const override;
 
+    // Rows are handed out a page at a time as the view scrolls; the full
+    // result stays in m_displayedTracks + m_unfetchedTracks
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
     // Property getters
-    int totalTracks() const { return m_totalTracks; }
-    int totalArtists() const { return m_totalArtists; }
-    int totalAlbums() const { return m_totalAlbums; }
-    qint64 totalDuration() const { return m_totalDuration; }
+    int totalTracks() const { return m_stats.trackCount(); }
+    int totalArtists() const { return m_stats.artistCount(); }
+    int totalAlbums() const { return m_stats.albumCount(); }
+    qint64 totalDuration() const { return m_stats.totalDuration(); }
 
     // Methods callable from QML
     Q_INVOKABLE void refresh();
     Q_INVOKABLE void search(const QString& query);
+    // Sidebar name or filter expression, e.g. "genre:jazz year:1955..1965" (see TrackFilter)
     Q_INVOKABLE void setFilter(const QString& filter);
     Q_INVOKABLE void scanDirectory(const QString& path);
     Q_INVOKABLE void sortBy(const QString& field);
+
+    // Ordered (field, direction) keys, e.g.
+    // ["Artist", {"field": "Year", "descending": true}, "Album", "TrackNumber"]
+    Q_INVOKABLE void setSortSpec(const QVariantList& spec);
     Q_INVOKABLE void clearLibrary();
     Q_INVOKABLE QString getTrackPath(int index) const;
+
+    // Paths of the whole current result in display order, fetched or not
+    Q_INVOKABLE QStringList displayedTrackPaths() const;
     Q_INVOKABLE bool saveAsM3UPlaylist(const QString& filePath);
 
+    // [{genre, count}] most common first; [{year, count}] by year, 0 = unknown
+    Q_INVOKABLE QVariantList genreHistogram() const;
+    Q_INVOKABLE QVariantList yearHistogram() const;
+
 
 signals:
     void statsChanged();
     void scanProgressChanged(int current, int total);
     void errorOccurred(const QString& message);
 
+private slots:
+    // Scanner callbacks
+    void onTracksScanned(const QVector<Track>& tracks);
+    void onTracksUnchanged(const QVector<Track>& tracks);
+    void onTracksRemoved(const QStringList& paths);
+    void onScanFinished(int processed, bool cancelled);
+    void onLiveChangesApplied(int processed);
+    void applySearch();
+    void onQueryResult(const QueryResult& result);
+
 private:
+    // Track store: insert-or-replace by path; returns the track's slot
+    int storeTrack(const Track& track, bool* isNew = nullptr);
+    bool releaseTrack(const QString& path);
+    void clearTrackStore();
+    void appendDisplayed(const std::vector<int>& batch);
+    void settleDisplayedTracks();
+    std::vector<int> resultTracks() const;
+    size_t unfetchedCount() const { return m_unfetchedTracks.size() - m_unfetchedOffset; }
+
     // Helper methods
+    // Submits the current search/filter/sort to m_queryExecutor; the rows
+    // are swapped in by onQueryResult() once the query has finished
     void updateDisplayedTracks();
-    void computeStats();
-    bool trackMatchesFilter(const Track& track) const;
-    void sortDisplayedTracks(const QString& field);
+    std::shared_ptr<const QuerySnapshot> querySnapshot();
+    void releaseSnapshot();
+    void syncDisplayedTracks(std::vector<int> next);
+    void applySortSpec(const TrackSortIndex::SortSpec& spec);
 
-    // All tracks discovered on scan
+    // All tracks discovered on scan; removed tracks leave a free slot behind
     std::vector<Track> m_allTracks;
+    QHash<QString, int> m_pathIndex;
+    std::vector<int> m_freeSlots;
+
+    // Full-text index over m_allTracks, keyed by slot
+    SearchIndex m_searchIndex;
 
-    // Current subset displayed (after search/filter/sort)
-    std::vector<Track> m_displayedTracks;
+    // Artist/album/genre/year postings for filter expressions
+    FilterIndex m_filterIndex;
+
+    // Collation keys and cached per-field orders over m_allTracks
+    TrackSortIndex m_sortIndex;
+
+    // Bumped on every store change; a snapshot of an older version is rebuilt.
+    // m_snapshot is only kept while the store is unchanged
+    quint64 m_storeVersion = 0;
+    std::shared_ptr<const QuerySnapshot> m_snapshot;
+
+    // Background search/filter/sort; only the latest query's result lands
+    QueryExecutor* m_queryExecutor;
+
+    // Search hits of the last finished query, for narrowing the next one;
+    // only valid against a snapshot of m_matchesVersion
+    std::shared_ptr<const std::vector<int>> m_searchMatches;
+    quint64 m_matchesVersion = 0;
+    QString m_matchedQuery;
+
+    // Current subset displayed (after search/filter/sort), as slots into m_allTracks:
+    // the rows fetched so far, then the rest of the result from m_unfetchedOffset on
+    std::vector<int> m_displayedTracks;
+    std::vector<int> m_unfetchedTracks;
+    size_t m_unfetchedOffset = 0;
 
     // Filter and search state
-    QString m_currentFilter;
+    TrackFilter m_filter;
     QString m_searchQuery;
-    QString m_lastSortField;
+    QString m_pendingQuery;
+    TrackSortIndex::SortSpec m_sortSpec;
+    QString m_scanRoot;
+    bool m_displayDirty = false;
+
+    // Statistics, maintained by storeTrack()/releaseTrack()
+    LibraryStats m_stats;
+
+    // Background scanner feeding m_allTracks in batches
+    LibraryScanner* m_scanner;
+    QTimer* m_searchTimer;
 
-    // Statistics
-    int m_totalTracks = 0;
-    int m_totalArtists = 0;
-    int m_totalAlbums = 0;
-    qint64 m_totalDuration = 0;
+    // Rows materialised per fetchMore()
+    static constexpr int kFetchPageSize = 256;
 
-    // Scan limit to prevent hanging on large directories
-    static constexpr int m_scanItemLimit = 10000;
+    // Beyond these a diff falls back to a reset / a single layout change
+    static constexpr int kMaxRowOperations = 256;
+    static constexpr int kMaxRowMoves = 16;
 };
 
 #endif // LIBRARYMODEL_H
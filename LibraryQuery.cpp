@@ -0,0 +1,112 @@
+#include "LibraryQuery.h"
+#include <QDebug>
+#include <QThread>
+#include <algorithm>
+
+// ==================== QueryExecutor ====================
+
+QueryExecutor::QueryExecutor(QObject* parent)
+    : QObject(parent)
+{
+    // One query runs at a time; its sort fans out over the remaining threads
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+QueryExecutor::~QueryExecutor()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+quint64 QueryExecutor::submit(std::shared_ptr<const QuerySnapshot> snapshot, const LibraryQuery& query)
+{
+    cancel();
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_cancelled = cancelled;
+    const quint64 token = m_generation;
+
+    m_pool.start([this, snapshot, query, cancelled, token]() {
+        QueryResult result;
+        result.token = token;
+        result.snapshot = snapshot;
+        if (!run(*snapshot, query, result, &m_pool, cancelled.get()))
+            return;
+
+        QMetaObject::invokeMethod(this, [this, result]() {
+            // A newer submit() or cancel() since then makes this stale
+            if (result.token != m_generation || !m_cancelled)
+                return;
+
+            m_cancelled.reset();
+            emit resultReady(result);
+        }, Qt::QueuedConnection);
+    });
+
+    return token;
+}
+
+void QueryExecutor::cancel()
+{
+    if (m_cancelled) {
+        m_cancelled->store(true);
+        m_cancelled.reset();
+    }
+    ++m_generation;
+}
+
+bool QueryExecutor::run(const QuerySnapshot& snapshot, const LibraryQuery& query, QueryResult& result,
+                        QThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+    const auto isCancelled = [cancelled]() { return cancelled && cancelled->load(std::memory_order_relaxed); };
+
+    // Search: narrow the previous hits when the text only grew
+    std::vector<int> matches;
+    if (query.candidates) {
+        matches.reserve(query.candidates->size());
+        for (int slot : *query.candidates) {
+            if (snapshot.searchIndex.matches(slot, query.search))
+                matches.push_back(slot);
+        }
+    } else {
+        matches = snapshot.searchIndex.search(query.search);
+    }
+
+    if (isCancelled())
+        return false;
+
+    // Filter: indexed terms first, the rest only over what they leave
+    std::vector<int> rows = query.filter.select(snapshot.tracks, snapshot.filterIndex, matches);
+
+    if (isCancelled())
+        return false;
+
+    // Sort on integer ranks; rows are in slot order, so ties stay by slot
+    const int keyCount = static_cast<int>(query.sort.size());
+    const int rowCount = static_cast<int>(rows.size());
+    if (keyCount > 0 && rowCount > 1) {
+        std::vector<int> keys(size_t(rowCount) * keyCount);
+        for (int k = 0; k < keyCount; ++k) {
+            const std::vector<int>& ranks = snapshot.ranks[query.sort[k].field];
+            const int sign = query.sort[k].descending ? -1 : 1;
+            for (int row = 0; row < rowCount; ++row) {
+                keys[size_t(row) * keyCount + k] = sign * ranks[rows[row]];
+            }
+        }
+
+        const std::vector<int> order = TrackSortIndex::parallelStableSort(keys, keyCount, rowCount, pool, cancelled);
+        if (order.empty() || isCancelled())
+            return false;
+
+        std::vector<int> sorted(rowCount);
+        for (int row = 0; row < rowCount; ++row) {
+            sorted[row] = rows[order[row]];
+        }
+        rows = std::move(sorted);
+    }
+
+    result.search = query.search;
+    result.matches = std::make_shared<const std::vector<int>>(std::move(matches));
+    result.rows = std::move(rows);
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef LIBRARYQUERY_H
+#define LIBRARYQUERY_H
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "SearchIndex.h"
+#include "Track.h"
+#include "TrackFilter.h"
+#include "TrackSortIndex.h"
+
+// Immutable copy of the track store that background queries run against.
+// Built on the GUI thread when a query needs it and the store has changed
+// since the last one; QStrings and the index postings are implicitly
+// shared, so a copy costs one pass over the slots. The model lets go of it
+// before the store changes, so only a query still running on it pays for
+// the indexes detaching.
+struct QuerySnapshot {
+    quint64 version = 0;                 // store version it was taken at
+    std::vector<Track> tracks;           // by slot; free slots have an empty path
+    SearchIndex searchIndex;
+    FilterIndex filterIndex;
+
+    // Dense sort ranks by slot, only for fields a query has asked for
+    std::vector<int> ranks[TrackSortIndex::FieldCount];
+};
+
+// What to show: search text, filter expression and sort order
+struct LibraryQuery {
+    QString search;                      // normalised with SearchIndex::normalize()
+    TrackFilter filter;
+    TrackSortIndex::SortSpec sort;
+
+    // Matches of a query the search text contains, taken from the same
+    // snapshot; only these are re-checked instead of searching the index
+    std::shared_ptr<const std::vector<int>> candidates;
+};
+
+struct QueryResult {
+    quint64 token = 0;
+    std::shared_ptr<const QuerySnapshot> snapshot;
+    QString search;
+    std::shared_ptr<const std::vector<int>> matches;   // search hits, ascending slots
+    std::vector<int> rows;                             // filtered and sorted slots
+};
+
+// Runs library queries on a private thread pool.
+// submit() returns a token and supersedes everything submitted before it:
+// older jobs are told to stop at their next stage boundary and their
+// results are dropped, so resultReady() is only ever emitted, on the
+// executor's thread, for the latest query.
+class QueryExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QueryExecutor(QObject* parent = nullptr);
+    ~QueryExecutor() override;
+
+    quint64 submit(std::shared_ptr<const QuerySnapshot> snapshot, const LibraryQuery& query);
+    void cancel();
+
+    bool isBusy() const { return m_cancelled != nullptr; }
+    quint64 currentToken() const { return m_generation; }
+
+    // The query itself; returns false if cancelled part way
+    static bool run(const QuerySnapshot& snapshot, const LibraryQuery& query, QueryResult& result,
+                    QThreadPool* pool, const std::atomic<bool>* cancelled);
+
+signals:
+    void resultReady(const QueryResult& result);
+
+private:
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+    quint64 m_generation = 0;
+};
+
+#endif // LIBRARYQUERY_H
@@ -0,0 +1,431 @@
+#include "LibraryScanner.h"
+#include "AudioException.h"
+#include "LibraryWatcher.h"
+#include "ScanJournal.h"
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// Shared state of one scan; owned jointly by the scanner and its workers
+struct ScanJob {
+    QString root;
+    QStringList files;
+    bool truncated = false;
+
+    // Watcher-driven: only the listed files, no removal detection
+    bool partial = false;
+
+    // Read-only while workers run
+    const ScanJournal* journal = nullptr;
+
+    std::atomic<int> cursor{0};
+    std::atomic<int> processed{0};
+    std::atomic<int> activeWorkers{0};
+    std::atomic<bool> cancelled{false};
+
+    QMutex batchMutex;
+    QVector<Track> batch;
+    QVector<Track> unchanged;
+    std::vector<ScanJournal::Entry> journalUpdates;
+};
+
+LibraryScanner::LibraryScanner(QObject* parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+}
+
+LibraryScanner::~LibraryScanner()
+{
+    cancel();
+    m_pool.waitForDone();
+}
+
+QStringList LibraryScanner::audioFileFilters()
+{
+    return {"*.mp3", "*.flac", "*.ogg", "*.wav", "*.m4a", "*.aac"};
+}
+
+// ==================== Public Methods ====================
+
+void LibraryScanner::setJournalFile(const QString& filePath)
+{
+    cancel();
+    m_pool.waitForDone();
+
+    m_journal = std::make_unique<ScanJournal>(filePath);
+    m_journalLoaded = false;
+}
+
+void LibraryScanner::setWatchEnabled(bool enabled)
+{
+    if (enabled == (m_watcher != nullptr))
+        return;
+
+    if (!enabled) {
+        delete m_watcher;
+        m_watcher = nullptr;
+        m_pendingChanged.clear();
+        m_pendingRemoved.clear();
+        m_pendingRemovedDirs.clear();
+        return;
+    }
+
+    m_watcher = new LibraryWatcher(this);
+    connect(m_watcher, &LibraryWatcher::changesReady, this, &LibraryScanner::onWatcherChanges);
+    connect(m_watcher, &LibraryWatcher::rescanRequired, this, &LibraryScanner::scanDirectory);
+}
+
+void LibraryScanner::stopWatching()
+{
+    if (m_watcher)
+        m_watcher->setRoots(QStringList());
+
+    m_pendingChanged.clear();
+    m_pendingRemoved.clear();
+    m_pendingRemovedDirs.clear();
+}
+
+void LibraryScanner::scanDirectory(const QString& path)
+{
+    cancel();
+
+    // Workers of a cancelled scan may still be reading the journal
+    m_pool.waitForDone();
+
+    QDir dir(path);
+    if (!dir.exists()) {
+        qWarning() << "Directory does not exist:" << path;
+        emit errorOccurred("Directory does not exist: " + path);
+        return;
+    }
+
+    if (m_journal && !m_journalLoaded) {
+        m_journal->load();
+        m_journalLoaded = true;
+    }
+
+    auto job = std::make_shared<ScanJob>();
+    job->root = QDir::cleanPath(path);
+    job->journal = m_journal.get();
+    m_job = job;
+
+    // The full walk below supersedes anything the watcher had queued
+    m_pendingChanged.clear();
+    m_pendingRemoved.clear();
+    m_pendingRemovedDirs.clear();
+    if (m_watcher)
+        m_watcher->setRoots({job->root});
+
+    const int maxFiles = m_maxFiles;
+
+    // Single directory walk; the file list doubles as the progress total
+    m_pool.start([this, job, maxFiles]() {
+        QDirIterator it(job->root, audioFileFilters(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext() && !job->cancelled.load(std::memory_order_relaxed)) {
+            job->files.append(it.next());
+
+            if (maxFiles > 0 && job->files.size() >= maxFiles) {
+                qWarning() << "Reached" << maxFiles << "track limit. Stopping scan.";
+                job->truncated = true;
+                break;
+            }
+        }
+
+        QMetaObject::invokeMethod(this, [this, job]() {
+            if (job != m_job)
+                return;
+
+            qDebug() << "Found" << job->files.size() << "audio files to scan";
+            emit scanStarted(static_cast<int>(job->files.size()));
+            startWorkers(job);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void LibraryScanner::cancel()
+{
+    if (!m_job)
+        return;
+
+    std::shared_ptr<ScanJob> job = std::move(m_job);
+    job->cancelled.store(true, std::memory_order_relaxed);
+
+    if (job->partial)
+        emit liveChangesApplied(job->processed.load());
+    else
+        emit scanFinished(job->processed.load(), true);
+}
+
+// ==================== Live Changes ====================
+
+void LibraryScanner::onWatcherChanges(const QStringList& changedFiles, const QStringList& removedFiles,
+                                      const QStringList& removedDirectories)
+{
+    if (!m_job) {
+        applyLiveChanges(changedFiles, removedFiles, removedDirectories);
+        return;
+    }
+
+    // Merge with last-event-wins semantics and apply once the scan is done
+    for (const QString& path : removedFiles) {
+        m_pendingChanged.remove(path);
+        m_pendingRemoved.insert(path);
+    }
+    for (const QString& path : removedDirectories) {
+        m_pendingRemovedDirs.insert(path);
+    }
+    for (const QString& path : changedFiles) {
+        m_pendingRemoved.remove(path);
+        m_pendingChanged.insert(path);
+    }
+}
+
+void LibraryScanner::applyPendingChanges()
+{
+    // A slot connected to scanFinished() or liveChangesApplied() may already
+    // have started a new scan
+    if (m_job)
+        return;
+
+    if (m_pendingChanged.isEmpty() && m_pendingRemoved.isEmpty() && m_pendingRemovedDirs.isEmpty())
+        return;
+
+    const QStringList changed(m_pendingChanged.cbegin(), m_pendingChanged.cend());
+    const QStringList removed(m_pendingRemoved.cbegin(), m_pendingRemoved.cend());
+    const QStringList removedDirs(m_pendingRemovedDirs.cbegin(), m_pendingRemovedDirs.cend());
+
+    m_pendingChanged.clear();
+    m_pendingRemoved.clear();
+    m_pendingRemovedDirs.clear();
+
+    applyLiveChanges(changed, removed, removedDirs);
+}
+
+void LibraryScanner::applyLiveChanges(const QStringList& changedFiles, const QStringList& removedFiles,
+                                      const QStringList& removedDirectories)
+{
+    // Workers of a cancelled scan may still be reading the journal
+    m_pool.waitForDone();
+
+    // Removals first; a file deleted and recreated shows up as changed only
+    QStringList removed = removedFiles;
+    if (m_journal) {
+        if (!m_journalLoaded) {
+            m_journal->load();
+            m_journalLoaded = true;
+        }
+
+        // Only the journal knows which tracks lived below a vanished directory
+        for (const QString& directory : removedDirectories) {
+            removed.append(m_journal->pathsUnder(directory));
+        }
+        for (const QString& path : removed) {
+            m_journal->remove(path);
+        }
+        m_journal->save();
+    }
+
+    if (!removed.isEmpty())
+        emit tracksRemoved(removed);
+
+    if (changedFiles.isEmpty()) {
+        emit liveChangesApplied(0);
+        return;
+    }
+
+    auto job = std::make_shared<ScanJob>();
+    job->root = m_watcher ? m_watcher->roots().value(0) : QString();
+    job->files = changedFiles;
+    job->partial = true;
+    job->journal = m_journal.get();
+    m_job = job;
+
+    startWorkers(job);
+}
+
+// ==================== Workers ====================
+
+void LibraryScanner::startWorkers(const std::shared_ptr<ScanJob>& job)
+{
+    const int fileCount = static_cast<int>(job->files.size());
+    if (fileCount == 0) {
+        deliverFinished(job);
+        return;
+    }
+
+    const int chunks = (fileCount + kChunkSize - 1) / kChunkSize;
+    const int workers = std::min(m_pool.maxThreadCount(), chunks);
+
+    job->activeWorkers.store(workers);
+    for (int i = 0; i < workers; ++i) {
+        m_pool.start([this, job]() { runWorker(job); });
+    }
+}
+
+void LibraryScanner::runWorker(const std::shared_ptr<ScanJob>& job)
+{
+    const int fileCount = static_cast<int>(job->files.size());
+    QVector<Track> fresh;
+    QVector<Track> unchanged;
+    std::vector<ScanJournal::Entry> updates;
+
+    while (!job->cancelled.load(std::memory_order_relaxed)) {
+        const int begin = job->cursor.fetch_add(kChunkSize);
+        if (begin >= fileCount)
+            break;
+
+        const int end = std::min(begin + kChunkSize, fileCount);
+        for (int i = begin; i < end; ++i) {
+            const QString& filePath = job->files.at(i);
+            try {
+                if (!job->journal) {
+                    if (!job->partial || QFileInfo::exists(filePath))
+                        fresh.append(Track(filePath));
+                    continue;
+                }
+
+                const FileState state = ScanJournal::fileState(filePath);
+
+                // A watched file can be gone again by the time it is parsed
+                if (job->partial && !state.exists())
+                    continue;
+                const ScanJournal::Entry* entry = job->journal->find(filePath);
+                if (entry && entry->state == state) {
+                    unchanged.append(entry->track);
+                    continue;
+                }
+
+                Track track(filePath);
+                fresh.append(track);
+                updates.push_back(ScanJournal::Entry{state, track});
+            }
+            catch (const AudioException& e) {
+                qWarning() << "Failed to load track:" << filePath << "-" << e.what();
+            }
+            catch (const std::exception& e) {
+                qWarning() << "Failed to load track:" << filePath << "-" << e.what();
+            }
+        }
+
+        {
+            QMutexLocker locker(&job->batchMutex);
+            job->batch.append(fresh);
+            job->unchanged.append(unchanged);
+            job->journalUpdates.insert(job->journalUpdates.end(),
+                                       std::make_move_iterator(updates.begin()),
+                                       std::make_move_iterator(updates.end()));
+        }
+        fresh.clear();
+        unchanged.clear();
+        updates.clear();
+        flushBatch(job, false);
+
+        const int before = job->processed.fetch_add(end - begin);
+        const int after = before + (end - begin);
+        if (!job->partial && before / kProgressInterval != after / kProgressInterval) {
+            QMetaObject::invokeMethod(this, [this, job, after]() {
+                deliverProgress(job, after);
+            }, Qt::QueuedConnection);
+        }
+    }
+
+    // Last worker out publishes the tail of the results
+    if (job->activeWorkers.fetch_sub(1) == 1) {
+        flushBatch(job, true);
+        QMetaObject::invokeMethod(this, [this, job]() {
+            deliverFinished(job);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void LibraryScanner::flushBatch(const std::shared_ptr<ScanJob>& job, bool force)
+{
+    QVector<Track> fresh;
+    QVector<Track> unchanged;
+    {
+        QMutexLocker locker(&job->batchMutex);
+        const int pending = static_cast<int>(job->batch.size() + job->unchanged.size());
+        if (pending == 0 || (!force && pending < kBatchSize))
+            return;
+        fresh.swap(job->batch);
+        unchanged.swap(job->unchanged);
+    }
+
+    QMetaObject::invokeMethod(this, [this, job, fresh, unchanged]() {
+        deliverBatch(job, fresh, unchanged);
+    }, Qt::QueuedConnection);
+}
+
+// ==================== Delivery (scanner thread) ====================
+
+void LibraryScanner::deliverBatch(const std::shared_ptr<ScanJob>& job, const QVector<Track>& fresh,
+                                  const QVector<Track>& unchanged)
+{
+    if (job != m_job)
+        return;
+
+    if (!unchanged.isEmpty())
+        emit tracksUnchanged(unchanged);
+    if (!fresh.isEmpty())
+        emit tracksScanned(fresh);
+}
+
+void LibraryScanner::deliverProgress(const std::shared_ptr<ScanJob>& job, int current)
+{
+    if (job != m_job)
+        return;
+
+    emit progressChanged(current, static_cast<int>(job->files.size()));
+}
+
+void LibraryScanner::deliverFinished(const std::shared_ptr<ScanJob>& job)
+{
+    if (job != m_job)
+        return;
+
+    m_job.reset();
+
+    // All workers are done; the journal can be written again
+    if (m_journal) {
+        for (const ScanJournal::Entry& entry : job->journalUpdates)
+            m_journal->update(entry.track.path(), entry.state, entry.track);
+
+        // A truncated walk cannot tell deleted files from unvisited ones
+        if (!job->truncated && !job->partial) {
+            const QSet<QString> seen(job->files.cbegin(), job->files.cend());
+            QStringList removed;
+            for (const QString& path : m_journal->pathsUnder(job->root)) {
+                if (!seen.contains(path)) {
+                    m_journal->remove(path);
+                    removed.append(path);
+                }
+            }
+            if (!removed.isEmpty())
+                emit tracksRemoved(removed);
+        }
+
+        m_journal->save();
+        qDebug() << (job->partial ? "Live update:" : "Incremental scan:") << job->journalUpdates.size() << "parsed,"
+                 << (job->processed.load() - static_cast<int>(job->journalUpdates.size())) << "unchanged";
+    }
+
+    const int processed = job->processed.load();
+    if (job->partial) {
+        emit liveChangesApplied(processed);
+    } else {
+        emit progressChanged(processed, static_cast<int>(job->files.size()));
+        emit scanFinished(processed, false);
+        qDebug() << "Scan complete. Processed" << processed << "files";
+    }
+
+    applyPendingChanges();
+}
@@ -0,0 +1,108 @@
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+#include <memory>
+#include "Track.h"
+
+class LibraryWatcher;
+class ScanJournal;
+struct ScanJob;
+
+// Background library scanner.
+// Walks the requested roots exactly once, then fans metadata extraction out
+// over a private thread pool sized to the core count. Workers pull small
+// chunks from a shared cursor so fast and slow files balance out across
+// threads. Finished tracks are delivered on the scanner's thread in batches.
+//
+// With a journal attached the scan is incremental: files whose size, mtime
+// and inode match the journal are reported through tracksUnchanged() from
+// cached metadata, only new or modified files are parsed, and journalled
+// files that have disappeared are reported through tracksRemoved().
+//
+// With watching enabled the last scanned root stays under a LibraryWatcher
+// and debounced filesystem changes are applied as small partial scans that
+// emit the same track signals, ending in liveChangesApplied() rather than
+// scanFinished(), so a full rescan is only needed after the kernel drops
+// events.
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryScanner(QObject* parent = nullptr);
+    ~LibraryScanner() override;
+
+    static QStringList audioFileFilters();
+
+    // Starts an asynchronous scan. Any scan already in flight is cancelled.
+    void scanDirectory(const QString& path);
+    void cancel();
+
+    bool isRunning() const { return m_job != nullptr; }
+
+    // Enables incremental scans backed by the given journal file
+    void setJournalFile(const QString& filePath);
+
+    // Keeps the scanned root in sync with the filesystem between scans
+    void setWatchEnabled(bool enabled);
+    bool isWatchEnabled() const { return m_watcher != nullptr; }
+    void stopWatching();
+
+    // Upper bound on files processed per scan (0 = unlimited)
+    void setMaxFiles(int maxFiles) { m_maxFiles = maxFiles; }
+    int maxFiles() const { return m_maxFiles; }
+
+signals:
+    void scanStarted(int totalFiles);
+    void tracksScanned(const QVector<Track>& tracks);        // new or modified files
+    void tracksUnchanged(const QVector<Track>& tracks);      // journal hits
+    void tracksRemoved(const QStringList& paths);
+    void progressChanged(int current, int total);
+    void scanFinished(int processed, bool cancelled);        // scanDirectory() only
+    void liveChangesApplied(int processed);                  // one watcher batch
+    void errorOccurred(const QString& message);
+
+private slots:
+    void onWatcherChanges(const QStringList& changedFiles, const QStringList& removedFiles,
+                          const QStringList& removedDirectories);
+
+private:
+    void applyLiveChanges(const QStringList& changedFiles, const QStringList& removedFiles,
+                          const QStringList& removedDirectories);
+    void applyPendingChanges();
+
+    void startWorkers(const std::shared_ptr<ScanJob>& job);
+    void runWorker(const std::shared_ptr<ScanJob>& job);
+    void flushBatch(const std::shared_ptr<ScanJob>& job, bool force);
+
+    // Called on the scanner's thread; drop anything from a superseded job
+    void deliverBatch(const std::shared_ptr<ScanJob>& job, const QVector<Track>& fresh,
+                      const QVector<Track>& unchanged);
+    void deliverProgress(const std::shared_ptr<ScanJob>& job, int current);
+    void deliverFinished(const std::shared_ptr<ScanJob>& job);
+
+    QThreadPool m_pool;
+    std::shared_ptr<ScanJob> m_job;
+    std::unique_ptr<ScanJournal> m_journal;
+    bool m_journalLoaded = false;
+    int m_maxFiles = 0;
+
+    LibraryWatcher* m_watcher = nullptr;
+
+    // Watcher batches that arrived while a scan was running
+    QSet<QString> m_pendingChanged;
+    QSet<QString> m_pendingRemoved;
+    QSet<QString> m_pendingRemovedDirs;
+
+    static constexpr int kChunkSize = 16;
+    static constexpr int kBatchSize = 256;
+    static constexpr int kProgressInterval = 64;
+};
+
+#endif // LIBRARYSCANNER_H
@@ -0,0 +1,466 @@
+#include "LibrarySnapshot.h"
+#include <QByteArray>
+#include <QDebug>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+
+// ==================== On-disk Layout ====================
+
+struct LibrarySnapshot::Header {
+    struct Section {
+        quint64 offset;
+        quint64 size;
+    };
+
+    quint32 magic;
+    quint16 version;
+    quint16 recordSize;
+    quint32 trackCount;
+    quint32 reserved;
+    qint64 totalDurationMs;
+    Section tracks;
+    Section strings;
+    Section indices[3];
+    Section paths;
+    quint32 checksum;       // over every field above
+    quint32 padding;
+};
+
+struct LibrarySnapshot::TrackRecord {
+    quint32 path;
+    quint32 title;
+    quint32 artist;
+    quint32 album;
+    quint32 genre;
+    qint32 year;
+    qint32 trackNumber;
+    qint32 playCount;
+    qint64 durationMs;
+    qint64 lastPlayedMs;    // 0 = never
+};
+
+struct LibrarySnapshot::GroupRecord {
+    quint32 key;
+    quint32 first;          // into the section's postings
+    quint32 count;
+};
+
+struct LibrarySnapshot::PathRecord {
+    quint32 hash;
+    quint32 row;
+};
+
+namespace {
+
+constexpr quint32 kMagic = 0x4E53584C;      // "LXSN"
+constexpr quint16 kVersion = 2;
+constexpr quint64 kAlignment = 8;
+
+quint64 aligned(quint64 offset)
+{
+    return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+quint16 headerChecksum(const void* header, size_t length)
+{
+    return qChecksum(QByteArrayView(static_cast<const char*>(header), static_cast<qsizetype>(length)));
+}
+
+// FNV-1a over the UTF-16 code units; unlike qHash() it is not seeded per process
+quint32 pathHash(QStringView path)
+{
+    quint32 hash = 2166136261u;
+    for (QChar c : path) {
+        hash ^= c.unicode();
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <typename T>
+void append(QByteArray& out, const T& value)
+{
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void pad(QByteArray& out)
+{
+    out.append(static_cast<qsizetype>(aligned(out.size()) - out.size()), '\0');
+}
+
+// Deduplicating string pool builder
+class PoolWriter
+{
+public:
+    quint32 add(const QString& value)
+    {
+        auto it = m_offsets.constFind(value);
+        if (it != m_offsets.cend())
+            return it.value();
+
+        const quint32 offset = static_cast<quint32>(m_data.size());
+        append(m_data, static_cast<quint32>(value.size()));
+        m_data.append(reinterpret_cast<const char*>(value.utf16()), value.size() * 2);
+        m_data.append(static_cast<qsizetype>((4 - m_data.size() % 4) % 4), '\0');
+
+        m_offsets.insert(value, offset);
+        return offset;
+    }
+
+    const QByteArray& data() const { return m_data; }
+
+private:
+    QByteArray m_data;
+    QHash<QString, quint32> m_offsets;
+};
+
+} // namespace
+
+LibrarySnapshot::~LibrarySnapshot()
+{
+    close();
+}
+
+// ==================== Writing ====================
+
+bool LibrarySnapshot::isSnapshot(const QString& filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    quint32 magic = 0;
+    return file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) == sizeof(magic) && magic == kMagic;
+}
+
+bool LibrarySnapshot::write(const QString& filePath, const std::vector<Track>& tracks)
+{
+    static_assert(sizeof(Header) % kAlignment == 0, "header must keep sections aligned");
+    static_assert(sizeof(TrackRecord) == 48, "track record layout changed");
+    static_assert(sizeof(GroupRecord) == 12, "group record layout changed");
+    static_assert(sizeof(PathRecord) == 8, "path record layout changed");
+
+    PoolWriter pool;
+    QByteArray records;
+    records.reserve(static_cast<qsizetype>(tracks.size() * sizeof(TrackRecord)));
+
+    // Groups keyed like MusicLibrary's std::map indices, so the loader can append in order
+    std::map<QString, std::vector<quint32>> groups[3];
+    std::vector<PathRecord> paths;
+    paths.reserve(tracks.size());
+    qint64 totalDuration = 0;
+
+    for (size_t row = 0; row < tracks.size(); ++row) {
+        const Track& track = tracks[row];
+
+        TrackRecord record;
+        record.path = pool.add(track.path());
+        record.title = pool.add(track.title());
+        record.artist = pool.add(track.artist());
+        record.album = pool.add(track.album());
+        record.genre = pool.add(track.genre());
+        record.year = track.year();
+        record.trackNumber = track.trackNumber();
+        record.playCount = track.playCount();
+        record.durationMs = track.duration();
+        record.lastPlayedMs = track.lastPlayed().isValid() ? track.lastPlayed().toMSecsSinceEpoch() : 0;
+        append(records, record);
+
+        groups[int(Index::Artist)][track.artist()].push_back(static_cast<quint32>(row));
+        groups[int(Index::Album)][track.album()].push_back(static_cast<quint32>(row));
+        groups[int(Index::Genre)][track.genre()].push_back(static_cast<quint32>(row));
+        paths.push_back(PathRecord{pathHash(track.path()), static_cast<quint32>(row)});
+        totalDuration += track.duration();
+    }
+
+    std::sort(paths.begin(), paths.end(), [](const PathRecord& a, const PathRecord& b) {
+        return a.hash != b.hash ? a.hash < b.hash : a.row < b.row;
+    });
+    const QByteArray pathTable(reinterpret_cast<const char*>(paths.data()),
+                               static_cast<qsizetype>(paths.size() * sizeof(PathRecord)));
+
+    // Index section: quint32 group count, padding, GroupRecord[], postings[]
+    QByteArray indices[3];
+    for (int i = 0; i < 3; ++i) {
+        QByteArray& section = indices[i];
+        append(section, static_cast<quint32>(groups[i].size()));
+        append(section, quint32(0));
+
+        QByteArray postings;
+        postings.reserve(static_cast<qsizetype>(tracks.size() * sizeof(quint32)));
+        for (const auto& [key, rows] : groups[i]) {
+            const GroupRecord group{pool.add(key), static_cast<quint32>(postings.size() / sizeof(quint32)),
+                                    static_cast<quint32>(rows.size())};
+            append(section, group);
+            postings.append(reinterpret_cast<const char*>(rows.data()),
+                            static_cast<qsizetype>(rows.size() * sizeof(quint32)));
+        }
+        pad(section);
+        section.append(postings);
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.recordSize = sizeof(TrackRecord);
+    header.trackCount = static_cast<quint32>(tracks.size());
+    header.totalDurationMs = totalDuration;
+
+    quint64 offset = sizeof(Header);
+    header.tracks = {offset, static_cast<quint64>(records.size())};
+    offset = aligned(offset + records.size());
+    header.strings = {offset, static_cast<quint64>(pool.data().size())};
+    offset = aligned(offset + pool.data().size());
+    for (int i = 0; i < 3; ++i) {
+        header.indices[i] = {offset, static_cast<quint64>(indices[i].size())};
+        offset = aligned(offset + indices[i].size());
+    }
+    header.paths = {offset, static_cast<quint64>(pathTable.size())};
+    offset = aligned(offset + pathTable.size());
+    header.checksum = headerChecksum(&header, offsetof(Header, checksum));
+
+    QByteArray out;
+    out.reserve(static_cast<qsizetype>(offset));
+    append(out, header);
+    out.append(records);
+    pad(out);
+    out.append(pool.data());
+    pad(out);
+    for (const QByteArray& section : indices) {
+        out.append(section);
+        pad(out);
+    }
+    out.append(pathTable);
+    pad(out);
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit()) {
+        qWarning() << "Cannot write library snapshot to" << filePath;
+        return false;
+    }
+
+    qDebug() << "Wrote library snapshot:" << tracks.size() << "tracks," << out.size() << "bytes";
+    return true;
+}
+
+// ==================== Reading ====================
+
+bool LibrarySnapshot::open(const QString& filePath)
+{
+    close();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail("Cannot open " + filePath);
+
+    m_size = m_file.size();
+    if (m_size < static_cast<qint64>(sizeof(Header)))
+        return fail("File too small for a snapshot header");
+
+    m_data = m_file.map(0, m_size);
+    if (!m_data)
+        return fail("Cannot map " + filePath);
+
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    if (header->magic != kMagic)
+        return fail("Not a library snapshot");
+    if (header->version != kVersion || header->recordSize != sizeof(TrackRecord))
+        return fail(QString("Unsupported snapshot version %1").arg(header->version));
+    if (header->checksum != headerChecksum(header, offsetof(Header, checksum)))
+        return fail("Snapshot header is corrupt");
+
+    const auto inBounds = [this](const Header::Section& section) {
+        return section.offset % kAlignment == 0 && section.offset <= quint64(m_size)
+               && section.size <= quint64(m_size) - section.offset;
+    };
+
+    if (!inBounds(header->tracks) || !inBounds(header->strings))
+        return fail("Snapshot section out of bounds");
+    if (header->tracks.size != quint64(header->trackCount) * sizeof(TrackRecord))
+        return fail("Track table size mismatch");
+    if (!inBounds(header->paths) || header->paths.size != quint64(header->trackCount) * sizeof(PathRecord))
+        return fail("Path table size mismatch");
+
+    // Group ranges are checked here so lookups can trust them; rows are checked by callers
+    for (const Header::Section& section : header->indices) {
+        if (!inBounds(section) || section.size < 8)
+            return fail("Snapshot index out of bounds");
+
+        quint32 groups = 0;
+        std::memcpy(&groups, m_data + section.offset, sizeof(groups));
+        const quint64 postingsOffset = aligned(8 + quint64(groups) * sizeof(GroupRecord));
+        if (postingsOffset + quint64(header->trackCount) * sizeof(quint32) > section.size)
+            return fail("Snapshot index is truncated");
+
+        const auto* records = reinterpret_cast<const GroupRecord*>(m_data + section.offset + 8);
+        for (quint32 g = 0; g < groups; ++g) {
+            if (quint64(records[g].first) + records[g].count > header->trackCount)
+                return fail("Snapshot index group out of range");
+        }
+    }
+
+    return true;
+}
+
+void LibrarySnapshot::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_file.close();
+
+    m_data = nullptr;
+    m_size = 0;
+    m_strings.clear();
+}
+
+bool LibrarySnapshot::fail(const QString& message)
+{
+    m_error = message;
+    qWarning() << "Library snapshot:" << message;
+    close();
+    return false;
+}
+
+int LibrarySnapshot::trackCount() const
+{
+    return m_data ? static_cast<int>(reinterpret_cast<const Header*>(m_data)->trackCount) : 0;
+}
+
+qint64 LibrarySnapshot::totalDuration() const
+{
+    return m_data ? reinterpret_cast<const Header*>(m_data)->totalDurationMs : 0;
+}
+
+QStringView LibrarySnapshot::stringView(quint32 offset) const
+{
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    const quint64 poolSize = header->strings.size;
+
+    quint32 length = 0;
+    if (offset % 4 != 0 || quint64(offset) + sizeof(length) > poolSize)
+        return QStringView();
+
+    const uchar* entry = m_data + header->strings.offset + offset;
+    std::memcpy(&length, entry, sizeof(length));
+    if (quint64(offset) + sizeof(length) + quint64(length) * 2 > poolSize)
+        return QStringView();
+
+    return QStringView(reinterpret_cast<const QChar*>(entry + sizeof(length)), static_cast<qsizetype>(length));
+}
+
+QString LibrarySnapshot::string(quint32 offset) const
+{
+    auto it = m_strings.constFind(offset);
+    if (it != m_strings.cend())
+        return it.value();
+
+    const QString value = stringView(offset).toString();
+    m_strings.insert(offset, value);
+    return value;
+}
+
+const LibrarySnapshot::TrackRecord& LibrarySnapshot::record(int row) const
+{
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    return reinterpret_cast<const TrackRecord*>(m_data + header->tracks.offset)[row];
+}
+
+Track LibrarySnapshot::track(int row) const
+{
+    if (row < 0 || row >= trackCount())
+        return Track();
+
+    const TrackRecord& record = this->record(row);
+
+    Track track(string(record.path), string(record.title), string(record.artist));
+    track.setAlbum(string(record.album));
+    track.setGenre(string(record.genre));
+    track.setYear(record.year);
+    track.setTrackNumber(record.trackNumber);
+    track.setDuration(record.durationMs);
+    track.setPlayCount(record.playCount);
+    if (record.lastPlayedMs != 0)
+        track.setLastPlayed(QDateTime::fromMSecsSinceEpoch(record.lastPlayedMs));
+    return track;
+}
+
+int LibrarySnapshot::findTrack(const QString& path) const
+{
+    if (!m_data)
+        return -1;
+
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    const auto* first = reinterpret_cast<const PathRecord*>(m_data + header->paths.offset);
+    const auto* last = first + header->trackCount;
+    const quint32 hash = pathHash(path);
+
+    auto it = std::lower_bound(first, last, hash,
+                               [](const PathRecord& entry, quint32 value) { return entry.hash < value; });
+    for (; it != last && it->hash == hash; ++it) {
+        if (it->row < header->trackCount && stringView(record(int(it->row)).path) == QStringView(path))
+            return static_cast<int>(it->row);
+    }
+    return -1;
+}
+
+const uchar* LibrarySnapshot::indexSection(Index index, quint32* groupCount) const
+{
+    const Header* header = reinterpret_cast<const Header*>(m_data);
+    const uchar* section = m_data + header->indices[int(index)].offset;
+    std::memcpy(groupCount, section, sizeof(quint32));
+    return section;
+}
+
+int LibrarySnapshot::groupCount(Index index) const
+{
+    if (!m_data)
+        return 0;
+
+    quint32 groups = 0;
+    indexSection(index, &groups);
+    return static_cast<int>(groups);
+}
+
+LibrarySnapshot::Group LibrarySnapshot::group(Index index, int i) const
+{
+    Group result;
+    if (!m_data)
+        return result;
+
+    quint32 groups = 0;
+    const uchar* section = indexSection(index, &groups);
+    if (i < 0 || quint32(i) >= groups)
+        return result;
+
+    const GroupRecord& record = reinterpret_cast<const GroupRecord*>(section + 8)[i];
+    const auto* postings = reinterpret_cast<const quint32*>(
+        section + aligned(8 + quint64(groups) * sizeof(GroupRecord)));
+
+    result.key = string(record.key);
+    result.rows = postings + record.first;
+    result.count = static_cast<int>(record.count);
+    return result;
+}
+
+int LibrarySnapshot::findGroup(Index index, const QString& key) const
+{
+    if (!m_data)
+        return -1;
+
+    // Keys were written in QString order, which QStringView compares the same way
+    quint32 groups = 0;
+    const auto* first = reinterpret_cast<const GroupRecord*>(indexSection(index, &groups) + 8);
+    const auto* last = first + groups;
+    const QStringView needle(key);
+
+    auto it = std::lower_bound(first, last, needle, [this](const GroupRecord& entry, QStringView value) {
+        return stringView(entry.key) < value;
+    });
+    if (it == last || stringView(it->key) != needle)
+        return -1;
+    return static_cast<int>(it - first);
+}
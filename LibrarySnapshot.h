@@ -0,0 +1,83 @@
+#ifndef LIBRARYSNAPSHOT_H
+#define LIBRARYSNAPSHOT_H
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QStringView>
+#include <vector>
+#include "Track.h"
+
+// Memory-mappable library snapshot.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//   Header       magic, version, record size, track count, total duration,
+//                section table, header checksum
+//   Tracks       fixed-width TrackRecord per track; strings are pool offsets
+//   Strings      deduplicated pool of (quint32 length, UTF-16 data) entries
+//   Indices      artist, album and genre groups sorted by key, each pointing
+//                at a run of track rows in a shared postings array
+//   Paths        (hash, row) pairs sorted by a stable hash of the track path
+//
+// Opening maps the file and validates the header and section bounds; nothing
+// is deserialised up front. Lookups by path and by group key binary-search
+// the mapped tables. Each pooled string is decoded at most once, so tracks
+// sharing an artist also share the QString data.
+class LibrarySnapshot
+{
+public:
+    enum class Index { Artist, Album, Genre };
+
+    struct Group {
+        QString key;
+        const quint32* rows = nullptr;
+        int count = 0;
+    };
+
+    LibrarySnapshot() = default;
+    ~LibrarySnapshot();
+
+    LibrarySnapshot(const LibrarySnapshot&) = delete;
+    LibrarySnapshot& operator=(const LibrarySnapshot&) = delete;
+
+    // Cheap magic check, used to pick between this and the legacy format
+    static bool isSnapshot(const QString& filePath);
+    static bool write(const QString& filePath, const std::vector<Track>& tracks);
+
+    bool open(const QString& filePath);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    QString errorString() const { return m_error; }
+
+    int trackCount() const;
+    qint64 totalDuration() const;
+
+    Track track(int row) const;
+    int findTrack(const QString& path) const;       // row, or -1
+
+    int groupCount(Index index) const;
+    Group group(Index index, int i) const;
+    int findGroup(Index index, const QString& key) const;   // group, or -1
+
+private:
+    struct Header;
+    struct TrackRecord;
+    struct GroupRecord;
+    struct PathRecord;
+
+    bool fail(const QString& message);
+    QString string(quint32 offset) const;
+    QStringView stringView(quint32 offset) const;
+    const TrackRecord& record(int row) const;
+    const uchar* indexSection(Index index, quint32* groupCount) const;
+
+    QFile m_file;
+    const uchar* m_data = nullptr;
+    qint64 m_size = 0;
+    QString m_error;
+
+    // Decoded strings by pool offset
+    mutable QHash<quint32, QString> m_strings;
+};
+
+#endif // LIBRARYSNAPSHOT_H
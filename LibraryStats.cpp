@@ -0,0 +1,67 @@
+#include "LibraryStats.h"
+
+template <typename Map, typename Key>
+void LibraryStats::adjust(Map& counts, const Key& key, int delta)
+{
+    auto it = counts.find(key);
+    if (it == counts.end()) {
+        if (delta > 0)
+            counts.insert(key, delta);
+        return;
+    }
+
+    it.value() += delta;
+    if (it.value() <= 0)
+        counts.erase(it);
+}
+
+bool LibraryStats::isPlaceholder(StringPool::Symbol symbol, StringPool::Symbol unknown)
+{
+    return symbol == StringPool::EmptySymbol || symbol == unknown;
+}
+
+void LibraryStats::add(const Track& track)
+{
+    ++m_trackCount;
+    m_totalDuration += static_cast<qint64>(track.duration());
+
+    if (!isPlaceholder(track.artistId(), Track::unknownArtist()))
+        adjust(m_artists, track.artistId(), 1);
+    if (!isPlaceholder(track.albumId(), Track::unknownAlbum()))
+        adjust(m_albums, track.albumId(), 1);
+    adjust(m_genres, track.genreId(), 1);
+    adjust(m_years, track.year(), 1);
+}
+
+void LibraryStats::remove(const Track& track)
+{
+    --m_trackCount;
+    m_totalDuration -= static_cast<qint64>(track.duration());
+
+    if (!isPlaceholder(track.artistId(), Track::unknownArtist()))
+        adjust(m_artists, track.artistId(), -1);
+    if (!isPlaceholder(track.albumId(), Track::unknownAlbum()))
+        adjust(m_albums, track.albumId(), -1);
+    adjust(m_genres, track.genreId(), -1);
+    adjust(m_years, track.year(), -1);
+}
+
+void LibraryStats::clear()
+{
+    m_artists.clear();
+    m_albums.clear();
+    m_genres.clear();
+    m_years.clear();
+    m_trackCount = 0;
+    m_totalDuration = 0;
+}
+
+int LibraryStats::genreCount() const
+{
+    int count = m_genres.size();
+    if (m_genres.contains(StringPool::EmptySymbol))
+        --count;
+    if (m_genres.contains(Track::unknownGenre()))
+        --count;
+    return count;
+}
@@ -0,0 +1,46 @@
+#ifndef LIBRARYSTATS_H
+#define LIBRARYSTATS_H
+
+#include <QHash>
+#include <QMap>
+#include "Track.h"
+
+// Running aggregates over a track collection, updated per track rather than
+// recomputed: the track count and total duration are plain sums, and every
+// distinct artist, album, genre and year carries a reference count so it
+// drops out when its last track goes. The genre and year counts double as
+// histograms. The owner calls remove() with the track as it was stored.
+class LibraryStats
+{
+public:
+    void add(const Track& track);
+    void remove(const Track& track);
+    void clear();
+
+    int trackCount() const { return m_trackCount; }
+    qint64 totalDuration() const { return m_totalDuration; }
+
+    // Distinct values, not counting empty or "Unknown ..." placeholders
+    int artistCount() const { return m_artists.size(); }
+    int albumCount() const { return m_albums.size(); }
+    int genreCount() const;
+
+    // Tracks per genre symbol (placeholders included) / per year (0 when unknown)
+    const QHash<StringPool::Symbol, int>& genreHistogram() const { return m_genres; }
+    const QMap<int, int>& yearHistogram() const { return m_years; }
+
+private:
+    template <typename Map, typename Key>
+    static void adjust(Map& counts, const Key& key, int delta);
+    static bool isPlaceholder(StringPool::Symbol symbol, StringPool::Symbol unknown);
+
+    QHash<StringPool::Symbol, int> m_artists;
+    QHash<StringPool::Symbol, int> m_albums;
+    QHash<StringPool::Symbol, int> m_genres;
+    QMap<int, int> m_years;
+
+    int m_trackCount = 0;
+    qint64 m_totalDuration = 0;
+};
+
+#endif // LIBRARYSTATS_H
@@ -117,6 +117,8 @@ Rectangle {
                         Layout.preferredWidth: 40
                         Layout.preferredHeight: 40
                         source: model.albumArt || "qrc:/assests/default.jpg"
+                        sourceSize: Qt.size(64, 64)
+                        asynchronous: true
                         fillMode: Image.PreserveAspectCrop
                     }
 
@@ -0,0 +1,382 @@
+#include "LibraryWatcher.h"
+#include "LibraryScanner.h"
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <iterator>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// IN_CREATE on plain files is ignored on purpose: a copy is only picked up
+// once the writer closes it (IN_CLOSE_WRITE) or it is renamed into place
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                                | IN_MOVED_TO | IN_DELETE_SELF | IN_ONLYDIR | IN_EXCL_UNLINK;
+#endif
+
+bool isBelow(const QString& path, const QString& directory)
+{
+    return path.size() > directory.size() && path.startsWith(directory)
+           && path.at(directory.size()) == QLatin1Char('/');
+}
+
+} // namespace
+
+LibraryWatcher::LibraryWatcher(QObject* parent)
+    : QObject(parent)
+    , m_debounce(new QTimer(this))
+{
+    m_debounce->setSingleShot(true);
+    m_debounce->setInterval(1500);
+    connect(m_debounce, &QTimer::timeout, this, &LibraryWatcher::flush);
+
+#ifdef Q_OS_LINUX
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+        m_notifier = new QSocketNotifier(m_inotifyFd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &LibraryWatcher::readEvents);
+    } else {
+        qWarning() << "inotify unavailable, falling back to QFileSystemWatcher:" << strerror(errno);
+    }
+#endif
+
+    if (m_inotifyFd < 0) {
+        m_fallback = new QFileSystemWatcher(this);
+        connect(m_fallback, &QFileSystemWatcher::directoryChanged,
+                this, &LibraryWatcher::onDirectoryChanged);
+    }
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+    clearWatches();
+
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        delete m_notifier;
+        ::close(m_inotifyFd);
+    }
+#endif
+}
+
+// ==================== Roots ====================
+
+void LibraryWatcher::setRoots(const QStringList& roots)
+{
+    QStringList cleaned;
+    for (const QString& root : roots) {
+        cleaned.append(QDir::cleanPath(root));
+    }
+
+    if (cleaned == m_roots)
+        return;
+
+    clearWatches();
+    m_changed.clear();
+    m_removed.clear();
+    m_removedDirectories.clear();
+    m_pendingSince.invalidate();
+    m_debounce->stop();
+
+    m_roots = cleaned;
+    for (const QString& root : m_roots) {
+        addDirectoryTree(root, false);
+    }
+
+    qDebug() << "Watching" << m_roots << "-" << (m_watchDescriptors.size() + m_listings.size())
+             << "directories";
+}
+
+void LibraryWatcher::clearWatches()
+{
+#ifdef Q_OS_LINUX
+    for (auto it = m_watchPaths.cbegin(); it != m_watchPaths.cend(); ++it) {
+        inotify_rm_watch(m_inotifyFd, it.key());
+    }
+#endif
+    m_watchPaths.clear();
+    m_watchDescriptors.clear();
+
+    if (m_fallback) {
+        const QStringList directories = m_fallback->directories();
+        if (!directories.isEmpty())
+            m_fallback->removePaths(directories);
+    }
+    m_listings.clear();
+}
+
+void LibraryWatcher::addDirectoryTree(const QString& directory, bool reportFiles)
+{
+    addDirectory(directory);
+
+    QDirIterator dirs(directory, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (dirs.hasNext()) {
+        addDirectory(dirs.next());
+    }
+
+    // Files may land in a new directory before its watch exists
+    if (reportFiles) {
+        QDirIterator files(directory, LibraryScanner::audioFileFilters(), QDir::Files,
+                           QDirIterator::Subdirectories);
+        while (files.hasNext()) {
+            noteChanged(files.next());
+        }
+    }
+}
+
+void LibraryWatcher::addDirectory(const QString& directory)
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        if (m_watchDescriptors.contains(directory))
+            return;
+
+        const int wd = inotify_add_watch(m_inotifyFd, QFile::encodeName(directory).constData(), kWatchMask);
+        if (wd < 0) {
+            if (errno == ENOSPC)
+                qWarning() << "inotify watch limit reached; raise fs.inotify.max_user_watches";
+            else
+                qWarning() << "Cannot watch" << directory << "-" << strerror(errno);
+            return;
+        }
+
+        m_watchPaths.insert(wd, directory);
+        m_watchDescriptors.insert(directory, wd);
+        return;
+    }
+#endif
+
+    if (m_listings.contains(directory))
+        return;
+
+    m_fallback->addPath(directory);
+
+    QSet<QString> files;
+    const QStringList names = QDir(directory).entryList(LibraryScanner::audioFileFilters(), QDir::Files);
+    for (const QString& name : names) {
+        files.insert(name);
+    }
+    m_listings.insert(directory, files);
+}
+
+void LibraryWatcher::removeDirectory(const QString& directory)
+{
+#ifdef Q_OS_LINUX
+    if (m_inotifyFd >= 0) {
+        for (auto it = m_watchDescriptors.begin(); it != m_watchDescriptors.end();) {
+            if (it.key() == directory || isBelow(it.key(), directory)) {
+                inotify_rm_watch(m_inotifyFd, it.value());
+                m_watchPaths.remove(it.value());
+                it = m_watchDescriptors.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return;
+    }
+#endif
+
+    for (auto it = m_listings.begin(); it != m_listings.end();) {
+        if (it.key() == directory || isBelow(it.key(), directory)) {
+            m_fallback->removePath(it.key());
+            it = m_listings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// ==================== Event Sources ====================
+
+void LibraryWatcher::readEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[64 * 1024];
+
+    for (;;) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (const char* p = buffer; p < buffer + length;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qWarning() << "inotify queue overflow; requesting rescan";
+                for (const QString& root : m_roots) {
+                    emit rescanRequired(root);
+                }
+                continue;
+            }
+
+            const QString directory = m_watchPaths.value(event->wd);
+            if (directory.isEmpty())
+                continue;
+
+            if (event->mask & IN_IGNORED) {
+                m_watchPaths.remove(event->wd);
+                if (m_watchDescriptors.value(directory, -1) == event->wd)
+                    m_watchDescriptors.remove(directory);
+                continue;
+            }
+
+            // Subdirectories are reported by their parent; only a root needs this
+            if (event->mask & IN_DELETE_SELF) {
+                if (m_roots.contains(directory))
+                    noteRemovedDirectory(directory);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            const QString path = directory + QLatin1Char('/') + QFile::decodeName(event->name);
+
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    addDirectoryTree(path, true);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    removeDirectory(path);
+                    noteRemovedDirectory(path);
+                }
+                continue;
+            }
+
+            if (!isAudioFile(path))
+                continue;
+
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                noteChanged(path);
+            else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                noteRemoved(path);
+        }
+    }
+#endif
+}
+
+void LibraryWatcher::onDirectoryChanged(const QString& directory)
+{
+    if (!QFileInfo::exists(directory)) {
+        removeDirectory(directory);
+        noteRemovedDirectory(directory);
+        return;
+    }
+
+    // QFileSystemWatcher only says "something changed here"; diff the listing
+    QSet<QString> current;
+    const QDir dir(directory);
+    const QStringList names = dir.entryList(LibraryScanner::audioFileFilters(), QDir::Files);
+    for (const QString& name : names) {
+        current.insert(name);
+    }
+
+    const QSet<QString> previous = m_listings.value(directory);
+    for (const QString& name : current) {
+        if (!previous.contains(name))
+            noteChanged(dir.filePath(name));
+    }
+    for (const QString& name : previous) {
+        if (!current.contains(name))
+            noteRemoved(dir.filePath(name));
+    }
+    m_listings.insert(directory, current);
+
+    const QStringList subdirectories = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString& name : subdirectories) {
+        const QString path = dir.filePath(name);
+        if (!m_listings.contains(path))
+            addDirectoryTree(path, true);
+    }
+}
+
+// ==================== Coalescing ====================
+
+void LibraryWatcher::noteChanged(const QString& path)
+{
+    m_removed.remove(path);
+    m_changed.insert(path);
+    schedule();
+}
+
+void LibraryWatcher::noteRemoved(const QString& path)
+{
+    m_changed.remove(path);
+    m_removed.insert(path);
+    schedule();
+}
+
+void LibraryWatcher::noteRemovedDirectory(const QString& directory)
+{
+    // Anything pending below the directory is superseded by its removal
+    for (auto it = m_changed.begin(); it != m_changed.end();) {
+        it = isBelow(*it, directory) ? m_changed.erase(it) : std::next(it);
+    }
+    for (auto it = m_removed.begin(); it != m_removed.end();) {
+        it = isBelow(*it, directory) ? m_removed.erase(it) : std::next(it);
+    }
+
+    m_removedDirectories.insert(directory);
+    schedule();
+}
+
+void LibraryWatcher::schedule()
+{
+    if (!m_pendingSince.isValid())
+        m_pendingSince.start();
+
+    if (m_pendingSince.elapsed() >= m_maxLatencyMs) {
+        flush();
+        return;
+    }
+
+    // Restart the quiet period on every event
+    m_debounce->start();
+}
+
+void LibraryWatcher::flush()
+{
+    m_debounce->stop();
+    m_pendingSince.invalidate();
+
+    if (m_changed.isEmpty() && m_removed.isEmpty() && m_removedDirectories.isEmpty())
+        return;
+
+    const QStringList changed(m_changed.cbegin(), m_changed.cend());
+    const QStringList removed(m_removed.cbegin(), m_removed.cend());
+    const QStringList removedDirectories(m_removedDirectories.cbegin(), m_removedDirectories.cend());
+
+    m_changed.clear();
+    m_removed.clear();
+    m_removedDirectories.clear();
+
+    qDebug() << "Library changes:" << changed.size() << "changed," << removed.size() << "removed,"
+             << removedDirectories.size() << "directories removed";
+
+    emit changesReady(changed, removed, removedDirectories);
+}
+
+bool LibraryWatcher::isAudioFile(const QString& path)
+{
+    static const QSet<QString> suffixes = []() {
+        QSet<QString> result;
+        for (const QString& filter : LibraryScanner::audioFileFilters()) {
+            result.insert(filter.mid(2));   // "*.mp3" -> "mp3"
+        }
+        return result;
+    }();
+
+    const int dot = path.lastIndexOf(QLatin1Char('.'));
+    return dot > path.lastIndexOf(QLatin1Char('/')) && suffixes.contains(path.mid(dot + 1).toLower());
+}
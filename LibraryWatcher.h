@@ -0,0 +1,84 @@
+#ifndef LIBRARYWATCHER_H
+#define LIBRARYWATCHER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+
+class QSocketNotifier;
+class QFileSystemWatcher;
+
+// Live watcher for scanned library roots.
+// On Linux every directory below the roots gets an inotify watch; elsewhere
+// QFileSystemWatcher is used and directory listings are diffed. Events are
+// coalesced per path (the last event wins) and held back until the tree has
+// been quiet for the debounce interval, so an rsync of an album arrives as
+// a single changesReady() batch. A burst that never goes quiet is still
+// flushed after the maximum latency.
+class LibraryWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LibraryWatcher(QObject* parent = nullptr);
+    ~LibraryWatcher() override;
+
+    void setRoots(const QStringList& roots);
+    QStringList roots() const { return m_roots; }
+
+    void setDebounceInterval(int milliseconds) { m_debounce->setInterval(milliseconds); }
+    void setMaxLatency(int milliseconds) { m_maxLatencyMs = milliseconds; }
+
+signals:
+    // changedFiles: created, modified or moved in; removedDirectories: every
+    // file below these paths is gone. Apply removals before changes.
+    void changesReady(const QStringList& changedFiles, const QStringList& removedFiles,
+                      const QStringList& removedDirectories);
+
+    // The kernel queue overflowed; the root must be rescanned to catch up
+    void rescanRequired(const QString& root);
+
+private slots:
+    void readEvents();
+    void onDirectoryChanged(const QString& directory);
+    void flush();
+
+private:
+    void clearWatches();
+    void addDirectoryTree(const QString& directory, bool reportFiles);
+    void addDirectory(const QString& directory);
+    void removeDirectory(const QString& directory);
+
+    void noteChanged(const QString& path);
+    void noteRemoved(const QString& path);
+    void noteRemovedDirectory(const QString& directory);
+    void schedule();
+
+    static bool isAudioFile(const QString& path);
+
+    QStringList m_roots;
+
+    // Coalesced state since the last flush
+    QSet<QString> m_changed;
+    QSet<QString> m_removed;
+    QSet<QString> m_removedDirectories;
+
+    QTimer* m_debounce;
+    QElapsedTimer m_pendingSince;
+    int m_maxLatencyMs = 10000;
+
+    // inotify backend
+    int m_inotifyFd = -1;
+    QSocketNotifier* m_notifier = nullptr;
+    QHash<int, QString> m_watchPaths;
+    QHash<QString, int> m_watchDescriptors;
+
+    // Portable fallback: last known audio files per directory
+    QFileSystemWatcher* m_fallback = nullptr;
+    QHash<QString, QSet<QString>> m_listings;
+};
+
+#endif // LIBRARYWATCHER_H
@@ -1,6 +1,8 @@
 #include "MusicLibrary.h"
+#include "LibraryScanner.h"
+#include "LibrarySnapshot.h"
+#include "ScanJournal.h"
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QDebug>
 #include <QFile>
@@ -15,7 +17,30 @@ int MusicLibrary::s_totalArtists = 0;
 qint64 MusicLibrary::s_totalDuration = 0;
 
 MusicLibrary::MusicLibrary()
+    : m_scanner(new LibraryScanner(this))
 {
+    m_scanner->setJournalFile(ScanJournal::defaultLocation("music-library.journal"));
+    m_scanner->setWatchEnabled(true);
+
+    connect(m_scanner, &LibraryScanner::scanStarted, this, [this]() { emit scanStarted(); });
+    connect(m_scanner, &LibraryScanner::tracksScanned, this, &MusicLibrary::onTracksScanned);
+    connect(m_scanner, &LibraryScanner::tracksUnchanged, this, &MusicLibrary::onTracksUnchanged);
+    connect(m_scanner, &LibraryScanner::tracksRemoved, this, &MusicLibrary::removeTracks);
+    connect(m_scanner, &LibraryScanner::progressChanged, this, &MusicLibrary::scanProgress);
+    connect(m_scanner, &LibraryScanner::scanFinished, this, [this](int processed, bool cancelled) {
+        if (cancelled) {
+            qDebug() << "Scan cancelled after" << processed << "audio files";
+            return;
+        }
+        qDebug() << "Scanned" << processed << "audio files";
+        emit scanCompleted(trackCount());
+    });
+
+    // Watcher batches arrive through the track signals and libraryChanged()
+    connect(m_scanner, &LibraryScanner::liveChangesApplied, this, [](int processed) {
+        qDebug() << "Live update applied," << processed << "files parsed";
+    });
+
     qDebug() << "MusicLibrary singleton created";
 }
 
@@ -39,82 +64,229 @@ MusicLibrary& MusicLibrary::instance()
 
 void MusicLibrary::addTrack(const Track& track)
 {
-    QString path = track.path();
+    const QString path = track.path();
 
-    if (m_trackMap.find(path) != m_trackMap.end()) {
+    if (hasTrack(path)) {
         qDebug() << "Track already exists:" << path;
         return;
     }
 
-    m_tracks.push_back(track);
-    m_trackMap[path] = track;
+    detachSnapshot();
+
+    const TrackId id = static_cast<TrackId>(m_tracks.size());
+    const auto link = [id](GroupIndex& index, StringPool::Symbol key) {
+        std::vector<TrackId>& ids = index[key];
+        ids.push_back(id);
+        return static_cast<quint32>(ids.size() - 1);
+    };
 
-    // Update indices
-    m_albumMap[track.album()].push_back(track);
-    m_artistMap[track.artist()].push_back(track);
-    m_artistSet.insert(track.artist());
-    m_albumSet.insert(track.album());
-    m_genreSet.insert(track.genre());
+    TrackSlot slot;
+    slot.addedSequence = m_nextSequence++;
+    slot.artistPos = link(m_artistIndex, track.artistId());
+    slot.albumPos = link(m_albumIndex, track.albumId());
+    slot.genrePos = link(m_genreIndex, track.genreId());
 
+    m_tracks.push_back(track);
+    m_slots.push_back(slot);
+    m_idByPath.insert(path, id);
+    m_searchIndex.add(static_cast<int>(id), track);
+
+    s_totalDuration += track.duration();
     updateStatistics();
 
     emit trackAdded(track);
-    emit libraryChanged();
+    notifyChanged();
 }
 
 void MusicLibrary::removeTrack(const QString& path)
 {
-    auto it = m_trackMap.find(path);
-    if (it == m_trackMap.end()) {
-        return;
+    removeTracks(QStringList{path});
+}
+
+void MusicLibrary::addTracks(const std::vector<Track>& tracks)
+{
+    if (!tracks.empty())
+        detachSnapshot();
+
+    beginBatch();
+    m_tracks.reserve(m_tracks.size() + tracks.size());
+    m_slots.reserve(m_slots.size() + tracks.size());
+    for (const Track& track : tracks) {
+        addTrack(track);
     }
+    commitBatch();
+}
 
-    // Remove from main list
-    m_tracks.erase(
-        std::remove_if(m_tracks.begin(), m_tracks.end(),
-                       [&path](const Track& t) { return t.path() == path; }),
-        m_tracks.end()
-        );
+void MusicLibrary::removeTracks(const QStringList& paths)
+{
+    bool changed = false;
+    for (const QString& path : paths) {
+        const TrackId id = trackId(path);
+        if (id == InvalidTrackId)
+            continue;
+
+        // Ids are snapshot rows, so the id stays valid across the copy
+        detachSnapshot();
+        eraseTrack(id);
+        changed = true;
+        emit trackRemoved(path);
+    }
+
+    if (!changed)
+        return;
 
-    m_trackMap.erase(it);
-    rebuildIndices();
     updateStatistics();
+    notifyChanged();
+}
 
-    emit trackRemoved(path);
-    emit libraryChanged();
+void MusicLibrary::eraseTrack(TrackId id)
+{
+    const Track& track = m_tracks[id];
+
+    // Swap-and-pop the id out of a group, re-pointing whichever track moved into its place
+    const auto unlink = [this, id](GroupIndex& index, StringPool::Symbol key, quint32 TrackSlot::*pos) {
+        auto it = index.find(key);
+        std::vector<TrackId>& ids = it.value();
+        const TrackId moved = ids.back();
+        ids[m_slots[id].*pos] = moved;
+        m_slots[moved].*pos = m_slots[id].*pos;
+        ids.pop_back();
+        if (ids.empty())
+            index.erase(it);
+    };
+
+    unlink(m_artistIndex, track.artistId(), &TrackSlot::artistPos);
+    unlink(m_albumIndex, track.albumId(), &TrackSlot::albumPos);
+    unlink(m_genreIndex, track.genreId(), &TrackSlot::genrePos);
+
+    s_totalDuration -= track.duration();
+    m_idByPath.remove(track.path());
+
+    // Keep the store dense: the last track takes over the freed id
+    const TrackId last = static_cast<TrackId>(m_tracks.size() - 1);
+    if (id != last) {
+        m_tracks[id] = std::move(m_tracks[last]);
+        m_slots[id] = m_slots[last];
+
+        const Track& moved = m_tracks[id];
+        const TrackSlot& slot = m_slots[id];
+        m_idByPath.insert(moved.path(), id);
+        m_artistIndex[moved.artistId()][slot.artistPos] = id;
+        m_albumIndex[moved.albumId()][slot.albumPos] = id;
+        m_genreIndex[moved.genreId()][slot.genrePos] = id;
+        m_searchIndex.add(static_cast<int>(id), moved);
+    }
+
+    m_searchIndex.remove(static_cast<int>(last));
+
+    m_tracks.pop_back();
+    m_slots.pop_back();
+}
+
+void MusicLibrary::beginBatch()
+{
+    ++m_batchDepth;
+}
+
+void MusicLibrary::commitBatch()
+{
+    if (m_batchDepth == 0)
+        return;
+
+    if (--m_batchDepth == 0 && m_batchChanged) {
+        m_batchChanged = false;
+        emit libraryChanged();
+    }
+}
+
+void MusicLibrary::notifyChanged()
+{
+    if (m_batchDepth > 0)
+        m_batchChanged = true;
+    else
+        emit libraryChanged();
+}
+
+int MusicLibrary::trackCount() const
+{
+    return m_snapshot ? m_snapshot->trackCount() : static_cast<int>(m_tracks.size());
+}
+
+int MusicLibrary::albumCount() const
+{
+    return m_snapshot ? m_snapshot->groupCount(LibrarySnapshot::Index::Album)
+                      : static_cast<int>(m_albumIndex.size());
+}
+
+int MusicLibrary::artistCount() const
+{
+    return m_snapshot ? m_snapshot->groupCount(LibrarySnapshot::Index::Artist)
+                      : static_cast<int>(m_artistIndex.size());
+}
+
+int MusicLibrary::genreCount() const
+{
+    return m_snapshot ? m_snapshot->groupCount(LibrarySnapshot::Index::Genre)
+                      : static_cast<int>(m_genreIndex.size());
 }
 
 bool MusicLibrary::hasTrack(const QString& path) const
 {
-    return m_trackMap.find(path) != m_trackMap.end();
+    return trackId(path) != InvalidTrackId;
+}
+
+TrackId MusicLibrary::trackId(const QString& path) const
+{
+    if (m_snapshot) {
+        const int row = m_snapshot->findTrack(path);
+        return row < 0 ? InvalidTrackId : static_cast<TrackId>(row);
+    }
+    return m_idByPath.value(path, InvalidTrackId);
 }
 
 Track* MusicLibrary::getTrack(const QString& path)
 {
-    auto it = m_trackMap.find(path);
-    if (it != m_trackMap.end()) {
+    return getTrack(trackId(path));
+}
+
+Track* MusicLibrary::getTrack(TrackId id)
+{
+    if (m_snapshot) {
+        if (id >= static_cast<TrackId>(m_snapshot->trackCount()))
+            return nullptr;
+
+        auto it = m_loadedRows.find(id);
+        if (it == m_loadedRows.end())
+            it = m_loadedRows.emplace(id, m_snapshot->track(static_cast<int>(id))).first;
         return &it->second;
     }
-    return nullptr;
+    return id < m_tracks.size() ? &m_tracks[id] : nullptr;
 }
 
 std::vector<Track> MusicLibrary::getAllTracks() const
 {
-    return m_tracks;
+    if (!m_snapshot)
+        return m_tracks;
+
+    std::vector<Track> tracks;
+    const int count = m_snapshot->trackCount();
+    tracks.reserve(count);
+    for (int row = 0; row < count; ++row) {
+        tracks.push_back(snapshotTrack(static_cast<TrackId>(row)));
+    }
+    return tracks;
 }
 
 std::vector<Track> MusicLibrary::searchTracks(const QString& query) const
 {
+    ensureSearchIndex();
+
     std::vector<Track> results;
-    QString lowerQuery = query.toLower();
-
-    for (const auto& track : m_tracks) {
-        if (track.title().toLower().contains(lowerQuery) ||
-            track.artist().toLower().contains(lowerQuery) ||
-            track.album().toLower().contains(lowerQuery) ||
-            track.genre().toLower().contains(lowerQuery)) {
-            results.push_back(track);
-        }
+    const std::vector<int> ids = m_searchIndex.search(SearchIndex::normalize(query));
+
+    results.reserve(ids.size());
+    for (int id : ids) {
+        results.push_back(m_snapshot ? snapshotTrack(static_cast<TrackId>(id)) : m_tracks[id]);
     }
 
     return results;
@@ -122,51 +294,86 @@ std::vector<Track> MusicLibrary::searchTracks(const QString& query) const
 
 std::vector<Track> MusicLibrary::getTracksByArtist(const QString& artist) const
 {
-    auto it = m_artistMap.find(artist);
-    if (it != m_artistMap.end()) {
-        return it->second;
-    }
-    return std::vector<Track>();
+    return tracksFor(LibrarySnapshot::Index::Artist, m_artistIndex, artist);
 }
 
 std::vector<Track> MusicLibrary::getTracksByAlbum(const QString& album) const
 {
-    auto it = m_albumMap.find(album);
-    if (it != m_albumMap.end()) {
-        return it->second;
-    }
-    return std::vector<Track>();
+    return tracksFor(LibrarySnapshot::Index::Album, m_albumIndex, album);
 }
 
 std::vector<Track> MusicLibrary::getTracksByGenre(const QString& genre) const
+{
+    return tracksFor(LibrarySnapshot::Index::Genre, m_genreIndex, genre);
+}
+
+std::vector<Track> MusicLibrary::tracksFor(LibrarySnapshot::Index group, const GroupIndex& index,
+                                           const QString& key) const
 {
     std::vector<Track> results;
-    for (const auto& track : m_tracks) {
-        if (track.genre() == genre) {
-            results.push_back(track);
+
+    if (m_snapshot) {
+        // Postings are read straight from the mapped index section
+        const LibrarySnapshot::Group rows = m_snapshot->group(group, m_snapshot->findGroup(group, key));
+        const quint32 count = static_cast<quint32>(m_snapshot->trackCount());
+        results.reserve(rows.count);
+        for (int i = 0; i < rows.count; ++i) {
+            if (rows.rows[i] < count)
+                results.push_back(snapshotTrack(rows.rows[i]));
         }
+        return results;
+    }
+
+    auto it = index.constFind(StringPool::instance().find(key));
+    if (it == index.cend())
+        return results;
+
+    results.reserve(it.value().size());
+    for (TrackId id : it.value()) {
+        results.push_back(m_tracks[id]);
     }
     return results;
 }
 
 std::map<QString, std::vector<Track>> MusicLibrary::getAlbumMap() const
 {
-    return m_albumMap;
+    std::map<QString, std::vector<Track>> albums;
+    for (const QString& album : getAllAlbums()) {
+        albums.emplace(album, tracksFor(LibrarySnapshot::Index::Album, m_albumIndex, album));
+    }
+    return albums;
 }
 
 std::set<QString> MusicLibrary::getAllArtists() const
 {
-    return m_artistSet;
+    return keysOf(LibrarySnapshot::Index::Artist, m_artistIndex);
 }
 
 std::set<QString> MusicLibrary::getAllAlbums() const
 {
-    return m_albumSet;
+    return keysOf(LibrarySnapshot::Index::Album, m_albumIndex);
 }
 
 std::set<QString> MusicLibrary::getAllGenres() const
 {
-    return m_genreSet;
+    return keysOf(LibrarySnapshot::Index::Genre, m_genreIndex);
+}
+
+std::set<QString> MusicLibrary::keysOf(LibrarySnapshot::Index group, const GroupIndex& index) const
+{
+    std::set<QString> keys;
+    if (m_snapshot) {
+        const int count = m_snapshot->groupCount(group);
+        for (int i = 0; i < count; ++i) {
+            keys.insert(m_snapshot->group(group, i).key);
+        }
+        return keys;
+    }
+
+    for (auto it = index.cbegin(); it != index.cend(); ++it) {
+        keys.insert(StringPool::instance().string(it.key()));
+    }
+    return keys;
 }
 
 void MusicLibrary::addPlaylist(const Playlist& playlist)
@@ -202,7 +409,7 @@ std::vector<Playlist> MusicLibrary::getAllPlaylists() const
 
 std::vector<Track> MusicLibrary::getMostPlayed(int count) const
 {
-    std::vector<Track> sorted = m_tracks;
+    std::vector<Track> sorted = getAllTracks();
     std::sort(sorted.begin(), sorted.end(),
               [](const Track& a, const Track& b) {
                   return a.playCount() > b.playCount();
@@ -217,7 +424,7 @@ std::vector<Track> MusicLibrary::getMostPlayed(int count) const
 
 std::vector<Track> MusicLibrary::getRecentlyPlayed(int count) const
 {
-    std::vector<Track> sorted = m_tracks;
+    std::vector<Track> sorted = getAllTracks();
     std::sort(sorted.begin(), sorted.end(),
               [](const Track& a, const Track& b) {
                   return a.lastPlayed() > b.lastPlayed();
@@ -232,11 +439,33 @@ std::vector<Track> MusicLibrary::getRecentlyPlayed(int count) const
 
 std::vector<Track> MusicLibrary::getRecentlyAdded(int count) const
 {
-    std::vector<Track> result;
-    int start = std::max(0, static_cast<int>(m_tracks.size()) - count);
+    // Snapshot rows are in insertion order already
+    if (m_snapshot) {
+        const int total = m_snapshot->trackCount();
+        std::vector<Track> result;
+        for (int row = total - std::min(total, std::max(0, count)); row < total; ++row) {
+            result.push_back(snapshotTrack(static_cast<TrackId>(row)));
+        }
+        return result;
+    }
+
+    // Removals reorder the store, so insertion order lives in the slots
+    std::vector<TrackId> ids(m_tracks.size());
+    for (TrackId id = 0; id < ids.size(); ++id) {
+        ids[id] = id;
+    }
 
-    for (size_t i = start; i < m_tracks.size(); ++i) {
-        result.push_back(m_tracks[i]);
+    const size_t n = std::min(ids.size(), static_cast<size_t>(std::max(0, count)));
+    std::partial_sort(ids.begin(), ids.begin() + n, ids.end(),
+                      [this](TrackId a, TrackId b) {
+                          return m_slots[a].addedSequence > m_slots[b].addedSequence;
+                      });
+
+    // Oldest first, as before
+    std::vector<Track> result;
+    result.reserve(n);
+    for (size_t i = n; i > 0; --i) {
+        result.push_back(m_tracks[ids[i - 1]]);
     }
 
     return result;
@@ -244,119 +473,92 @@ std::vector<Track> MusicLibrary::getRecentlyAdded(int count) const
 
 void MusicLibrary::scanDirectory(const QString& directoryPath)
 {
-    QStringList audioExtensions = {"*.mp3", "*.flac", "*.ogg", "*.wav", "*.m4a", "*.aac"};
+    // Asynchronous; progress and completion arrive through scanProgress/scanCompleted
+    m_scanner->scanDirectory(directoryPath);
+}
 
-    QDir dir(directoryPath);
-    if (!dir.exists()) {
-        qWarning() << "Directory does not exist:" << directoryPath;
-        return;
+void MusicLibrary::onTracksScanned(const QVector<Track>& tracks)
+{
+    // New or modified files; a modified file replaces its stale entry
+    QStringList stale;
+    for (const Track& track : tracks) {
+        if (hasTrack(track.path()))
+            stale.append(track.path());
     }
 
-    QDirIterator it(directoryPath, audioExtensions, QDir::Files, QDirIterator::Subdirectories);
-
-    int count = 0;
-    int total = 0;
+    detachSnapshot();
 
-    // Count total files first
-    QDirIterator countIt(directoryPath, audioExtensions, QDir::Files, QDirIterator::Subdirectories);
-    while (countIt.hasNext()) {
-        countIt.next();
-        total++;
+    beginBatch();
+    removeTracks(stale);
+    m_tracks.reserve(m_tracks.size() + tracks.size());
+    m_slots.reserve(m_slots.size() + tracks.size());
+    for (const Track& track : tracks) {
+        addTrack(track);
     }
+    commitBatch();
+}
 
-    // Now scan
-    while (it.hasNext()) {
-        QString filePath = it.next();
-
-        if (!hasTrack(filePath)) {
-            Track track(filePath);
+void MusicLibrary::onTracksUnchanged(const QVector<Track>& tracks)
+{
+    beginBatch();
+    for (const Track& track : tracks) {
+        if (!hasTrack(track.path())) {
             addTrack(track);
         }
-
-        count++;
-        emit scanProgress(count, total);
     }
-
-    qDebug() << "Scanned" << count << "audio files";
+    commitBatch();
 }
 
 void MusicLibrary::clearLibrary()
 {
-    m_tracks.clear();
-    m_trackMap.clear();
-    m_albumMap.clear();
-    m_artistMap.clear();
-    m_artistSet.clear();
-    m_albumSet.clear();
-    m_genreSet.clear();
+    // Batches of a running scan would refill the library afterwards
+    m_scanner->cancel();
 
-    updateStatistics();
-    emit libraryChanged();
-}
+    m_snapshot.reset();
+    m_loadedRows.clear();
+    m_searchIndexReady = true;
 
-void MusicLibrary::updateStatistics()
-{
-    s_totalTracks = static_cast<int>(m_tracks.size());
-    s_totalAlbums = static_cast<int>(m_albumSet.size());
-    s_totalArtists = static_cast<int>(m_artistSet.size());
+    m_tracks.clear();
+    m_slots.clear();
+    m_idByPath.clear();
+    m_artistIndex.clear();
+    m_albumIndex.clear();
+    m_genreIndex.clear();
+    m_searchIndex.clear();
 
     s_totalDuration = 0;
-    for (const auto& track : m_tracks) {
-        s_totalDuration += track.duration();
-    }
+    updateStatistics();
+    notifyChanged();
 }
 
-void MusicLibrary::rebuildIndices()
+void MusicLibrary::updateStatistics()
 {
-    m_albumMap.clear();
-    m_artistMap.clear();
-    m_artistSet.clear();
-    m_albumSet.clear();
-    m_genreSet.clear();
-
-    for (const auto& track : m_tracks) {
-        m_albumMap[track.album()].push_back(track);
-        m_artistMap[track.artist()].push_back(track);
-        m_artistSet.insert(track.artist());
-        m_albumSet.insert(track.album());
-        m_genreSet.insert(track.genre());
-    }
+    // O(1): the total duration is kept as a running sum by add/remove
+    s_totalTracks = trackCount();
+    s_totalAlbums = albumCount();
+    s_totalArtists = artistCount();
 }
 
-bool MusicLibrary::saveToFile(const QString& filePath) const
+bool MusicLibrary::saveToFile(const QString& filePath)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Cannot save library to" << filePath;
-        return false;
-    }
-
-    QDataStream out(&file);
-    out << static_cast<quint32>(m_tracks.size());
-
-    for (const auto& track : m_tracks) {
-        out << track.path()
-        << track.title()
-        << track.artist()
-        << track.album()
-        << track.genre()
-        << track.year()
-        << track.duration()
-        << track.playCount();
-    }
-
-    file.close();
-    return true;
+    // The mapped file may be the one being replaced
+    detachSnapshot();
+    return LibrarySnapshot::write(filePath, m_tracks);
 }
 
 bool MusicLibrary::loadFromFile(const QString& filePath)
 {
+    if (LibrarySnapshot::isSnapshot(filePath))
+        return loadSnapshot(filePath);
+
+    // Legacy QDataStream library; the next save converts it to a snapshot
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "Cannot load library from" << filePath;
         return false;
     }
 
+    beginBatch();
     clearLibrary();
 
     QDataStream in(&file);
@@ -364,24 +566,112 @@ bool MusicLibrary::loadFromFile(const QString& filePath)
     in >> trackCount;
 
     for (quint32 i = 0; i < trackCount; ++i) {
-        Track track;
         QString path, title, artist, album, genre;
         int year, playCount;
         qint64 duration;
 
         in >> path >> title >> artist >> album >> genre >> year >> duration >> playCount;
 
-        track = Track(path);
-        track.setTitle(title);
-        track.setArtist(artist);
+        // Metadata comes from the file; don't re-parse the audio
+        Track track(path, title, artist);
         track.setAlbum(album);
         track.setGenre(genre);
         track.setYear(year);
         track.setDuration(duration);
+        track.setPlayCount(playCount);
 
         addTrack(track);
     }
+    commitBatch();
 
     file.close();
     return true;
 }
+
+bool MusicLibrary::loadSnapshot(const QString& filePath)
+{
+    auto snapshot = std::make_unique<LibrarySnapshot>();
+    if (!snapshot->open(filePath))
+        return false;
+
+    // Nothing is decoded here; reads go to the mapping until the first change
+    beginBatch();
+    clearLibrary();
+    m_snapshot = std::move(snapshot);
+    m_searchIndexReady = false;
+
+    s_totalDuration = m_snapshot->totalDuration();
+    updateStatistics();
+    notifyChanged();
+    commitBatch();
+
+    qDebug() << "Mapped library snapshot with" << trackCount() << "tracks";
+    return true;
+}
+
+Track MusicLibrary::snapshotTrack(TrackId id) const
+{
+    // Rows handed out by getTrack() may have been edited since
+    auto it = m_loadedRows.find(id);
+    return it != m_loadedRows.end() ? it->second : m_snapshot->track(static_cast<int>(id));
+}
+
+void MusicLibrary::ensureSearchIndex() const
+{
+    if (m_searchIndexReady)
+        return;
+
+    const int count = m_snapshot ? m_snapshot->trackCount() : 0;
+    for (int row = 0; row < count; ++row) {
+        m_searchIndex.add(row, snapshotTrack(static_cast<TrackId>(row)));
+    }
+    m_searchIndexReady = true;
+}
+
+void MusicLibrary::detachSnapshot()
+{
+    if (!m_snapshot)
+        return;
+
+    const std::unique_ptr<LibrarySnapshot> snapshot = std::move(m_snapshot);
+    const bool indexSearch = !m_searchIndexReady;
+
+    // Rows load in order, so a track's TrackId stays its snapshot row
+    const int count = snapshot->trackCount();
+    m_tracks.reserve(count);
+    m_slots.resize(count);
+    m_idByPath.reserve(count);
+    for (int row = 0; row < count; ++row) {
+        auto loaded = m_loadedRows.find(static_cast<TrackId>(row));
+        m_tracks.push_back(loaded != m_loadedRows.end() ? std::move(loaded->second) : snapshot->track(row));
+        m_slots[row].addedSequence = static_cast<quint64>(row);
+        m_idByPath.insert(m_tracks.back().path(), static_cast<TrackId>(row));
+        if (indexSearch)
+            m_searchIndex.add(row, m_tracks.back());
+    }
+    m_loadedRows.clear();
+    m_searchIndexReady = true;
+    m_nextSequence = static_cast<quint64>(count);
+
+    // Prebuilt groups map one-to-one onto index entries; nothing is regrouped
+    const auto loadIndex = [this, &snapshot, count](LibrarySnapshot::Index index, GroupIndex& groups,
+                                                    quint32 TrackSlot::*pos) {
+        const int groupCount = snapshot->groupCount(index);
+        groups.reserve(groupCount);
+        for (int i = 0; i < groupCount; ++i) {
+            const LibrarySnapshot::Group group = snapshot->group(index, i);
+            std::vector<TrackId>& ids = groups[StringPool::instance().intern(group.key)];
+            ids.reserve(group.count);
+            for (int j = 0; j < group.count; ++j) {
+                if (group.rows[j] >= quint32(count))
+                    continue;
+                m_slots[group.rows[j]].*pos = static_cast<quint32>(ids.size());
+                ids.push_back(group.rows[j]);
+            }
+        }
+    };
+
+    loadIndex(LibrarySnapshot::Index::Artist, m_artistIndex, &TrackSlot::artistPos);
+    loadIndex(LibrarySnapshot::Index::Album, m_albumIndex, &TrackSlot::albumPos);
+    loadIndex(LibrarySnapshot::Index::Genre, m_genreIndex, &TrackSlot::genrePos);
+}
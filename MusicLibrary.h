@@ -3,11 +3,29 @@
 
 #include "Track.h"
 #include "Playlist.h"
+#include "SearchIndex.h"
+#include "LibrarySnapshot.h"
 #include <vector>
 #include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
 #include <QString>
 #include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+class LibraryScanner;
+
+// Dense index into the track store. Ids are contiguous (0..trackCount-1);
+// removing a track moves the last track into its id.
+using TrackId = quint32;
+
+// A library loaded from a snapshot stays mapped and is read in place: a
+// track's id is its snapshot row, rows are decoded when asked for, and group
+// and path lookups go through the snapshot's index sections. The first change
+// to the library (or a save) copies the snapshot into the in-memory store.
 
 class MusicLibrary : public QObject {
     Q_OBJECT
@@ -29,19 +47,33 @@ public:
     static qint64 getTotalDuration() { return s_totalDuration; }
 
     // QML-friendly getters
-    int trackCount() const { return static_cast<int>(m_tracks.size()); }
-    int albumCount() const { return static_cast<int>(m_albumSet.size()); }
-    int artistCount() const { return static_cast<int>(m_artistSet.size()); }
-    int genreCount() const { return static_cast<int>(m_genreSet.size()); }
+    int trackCount() const;
+    int albumCount() const;
+    int artistCount() const;
+    int genreCount() const;
 
     // Track management (make these Q_INVOKABLE for QML)
     Q_INVOKABLE void addTrack(const Track& track);
     Q_INVOKABLE void removeTrackByPath(const QString& path);
     Q_INVOKABLE bool hasTrack(const QString& path) const;
 
+    // Bulk ingest. Between beginBatch() and commitBatch() indices and totals
+    // are still updated per track, but libraryChanged() is emitted once at
+    // the outermost commit. Batches nest.
+    void beginBatch();
+    void commitBatch();
+    void addTracks(const std::vector<Track>& tracks);
+    void removeTracks(const QStringList& paths);
+
     // These can't be called from QML directly (return C++ types)
+    static constexpr TrackId InvalidTrackId = ~TrackId(0);
+
     void removeTrack(const QString& path);
+    TrackId trackId(const QString& path) const;
+
+    // Points into the store; valid until the next add, remove or save
     Track* getTrack(const QString& path);
+    Track* getTrack(TrackId id);
     std::vector<Track> getAllTracks() const;
     std::vector<Track> searchTracks(const QString& query) const;
     std::vector<Track> getTracksByArtist(const QString& artist) const;
@@ -68,7 +100,7 @@ public:
     Q_INVOKABLE void clearLibrary();
 
     // Save/Load (make Q_INVOKABLE for QML)
-    Q_INVOKABLE bool saveToFile(const QString& filePath) const;
+    Q_INVOKABLE bool saveToFile(const QString& filePath);
     Q_INVOKABLE bool loadFromFile(const QString& filePath);
 
 signals:
@@ -95,18 +127,57 @@ private:
     static int s_totalArtists;
     static qint64 s_totalDuration;
 
-    // STL Containers
+    using GroupIndex = QHash<StringPool::Symbol, std::vector<TrackId>>;
+
+    // Where a track sits in each group vector, so it can be unlinked in O(1)
+    struct TrackSlot {
+        quint64 addedSequence = 0;
+        quint32 artistPos = 0;
+        quint32 albumPos = 0;
+        quint32 genrePos = 0;
+    };
+
+    // The only copy of each Track, indexed by TrackId; m_slots runs parallel
     std::vector<Track> m_tracks;
-    std::map<QString, Track> m_trackMap;
-    std::map<QString, std::vector<Track>> m_albumMap;
-    std::map<QString, std::vector<Track>> m_artistMap;
-    std::set<QString> m_artistSet;
-    std::set<QString> m_albumSet;
-    std::set<QString> m_genreSet;
+    std::vector<TrackSlot> m_slots;
+    QHash<QString, TrackId> m_idByPath;
+    quint64 m_nextSequence = 0;
+
+    // Secondary indices hold ids only; empty groups are erased
+    GroupIndex m_artistIndex;
+    GroupIndex m_albumIndex;
+    GroupIndex m_genreIndex;
+
+    // Full-text index keyed by TrackId; built on first search after a snapshot load
+    mutable SearchIndex m_searchIndex;
+    mutable bool m_searchIndexReady = true;
+
+    // Mapped snapshot backing the library until the first change
+    std::unique_ptr<LibrarySnapshot> m_snapshot;
+    // Snapshot rows handed out by getTrack(); node-based, so pointers stay put
+    std::unordered_map<TrackId, Track> m_loadedRows;
+
     std::vector<Playlist> m_playlists;
 
+    // Background scanner shared by scanDirectory()
+    LibraryScanner* m_scanner;
+
+    void onTracksScanned(const QVector<Track>& tracks);
+    void onTracksUnchanged(const QVector<Track>& tracks);
+    // Coalesced while a batch is open
+    int m_batchDepth = 0;
+    bool m_batchChanged = false;
+
+    void notifyChanged();
     void updateStatistics();
-    void rebuildIndices();
+    void eraseTrack(TrackId id);
+    std::vector<Track> tracksFor(LibrarySnapshot::Index group, const GroupIndex& index, const QString& key) const;
+    std::set<QString> keysOf(LibrarySnapshot::Index group, const GroupIndex& index) const;
+    bool loadSnapshot(const QString& filePath);
+
+    Track snapshotTrack(TrackId id) const;
+    void ensureSearchIndex() const;
+    void detachSnapshot();
 };
 
 #endif // MUSICLIBRARY_H
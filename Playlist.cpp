@@ -73,7 +73,11 @@ Playlist& Playlist::operator+=(const Playlist& other)
 
 bool Playlist::operator==(const Playlist& other) const
 {
-    return m_name == other.m_name && m_tracks == other.m_tracks;
+    // Tracks are the same entry when they point at the same file
+    return m_name == other.m_name
+        && std::equal(m_tracks.begin(), m_tracks.end(),
+                      other.m_tracks.begin(), other.m_tracks.end(),
+                      [](const Track& a, const Track& b) { return a.path() == b.path(); });
 }
 
 void Playlist::addTrack(const Track& track)
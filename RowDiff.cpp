@@ -0,0 +1,164 @@
+#include "RowDiff.h"
+#include <algorithm>
+
+void RowDiff::apply(std::vector<int>& rows, std::vector<int> next, size_t idLimit, Listener& listener) const
+{
+    std::vector<int>& current = rows;
+    const int nextCount = static_cast<int>(next.size());
+
+    std::vector<int> nextRows(idLimit, -1);
+    for (int row = 0; row < nextCount; ++row) {
+        nextRows[next[row]] = row;
+    }
+
+    // Destination row of every current row, -1 if it goes away
+    std::vector<int> target(current.size());
+    std::vector<char> isNew(nextCount, 1);
+    int removalRuns = 0;
+    for (size_t row = 0; row < current.size(); ++row) {
+        target[row] = nextRows[current[row]];
+        if (target[row] >= 0)
+            isNew[target[row]] = 0;
+        else if (row == 0 || target[row - 1] >= 0)
+            ++removalRuns;
+    }
+
+    int insertionRuns = 0;
+    for (int row = 0; row < nextCount; ++row) {
+        if (isNew[row] && (row == 0 || !isNew[row - 1]))
+            ++insertionRuns;
+    }
+
+    // A scattered edit script costs more than rebuilding the visible delegates
+    if (removalRuns + insertionRuns > m_maxOperations) {
+        listener.beginReset();
+        current = std::move(next);
+        listener.endReset();
+        return;
+    }
+
+    // Removals, back to front so earlier rows keep their numbers
+    for (int row = static_cast<int>(current.size()) - 1; row >= 0; --row) {
+        if (target[row] >= 0)
+            continue;
+
+        const int last = row;
+        while (row > 0 && target[row - 1] < 0)
+            --row;
+
+        listener.beginRemove(row, last);
+        current.erase(current.begin() + row, current.begin() + last + 1);
+        target.erase(target.begin() + row, target.begin() + last + 1);
+        listener.endRemove();
+    }
+
+    reorder(current, target, listener);
+
+    // Insertions front to back; survivors are already in their final order
+    for (int row = 0; row < nextCount; ++row) {
+        if (!isNew[row])
+            continue;
+
+        int last = row;
+        while (last + 1 < nextCount && isNew[last + 1])
+            ++last;
+
+        listener.beginInsert(row, last);
+        current.insert(current.begin() + row, next.begin() + row, next.begin() + last + 1);
+        listener.endInsert();
+        row = last;
+    }
+}
+
+void RowDiff::reorder(std::vector<int>& rows, std::vector<int>& target, Listener& listener) const
+{
+    std::vector<int>& current = rows;
+    const int count = static_cast<int>(target.size());
+
+    // Rows on a longest increasing run of targets stay; only the rest move
+    std::vector<int> tails;          // row index ending the best run of each length
+    std::vector<int> previous(count, -1);
+    for (int row = 0; row < count; ++row) {
+        auto it = std::lower_bound(tails.begin(), tails.end(), target[row],
+                                   [&target](int tailRow, int value) { return target[tailRow] < value; });
+        if (it != tails.begin())
+            previous[row] = *(it - 1);
+        if (it == tails.end())
+            tails.push_back(row);
+        else
+            *it = row;
+    }
+
+    const int moves = count - static_cast<int>(tails.size());
+    if (moves == 0)
+        return;
+
+    if (moves > m_maxMoves) {
+        // A re-sort: one layout change, with persistent indexes remapped
+        std::vector<int> order(count);
+        for (int row = 0; row < count; ++row) {
+            order[row] = row;
+        }
+        std::sort(order.begin(), order.end(), [&target](int a, int b) { return target[a] < target[b]; });
+
+        listener.beginLayoutChange();
+
+        std::vector<int> newRow(count);
+        std::vector<int> reordered(count);
+        for (int row = 0; row < count; ++row) {
+            newRow[order[row]] = row;
+            reordered[row] = current[order[row]];
+        }
+
+        current = std::move(reordered);
+        std::sort(target.begin(), target.end());
+
+        listener.endLayoutChange(newRow);
+        return;
+    }
+
+    // A few rows changed places: move each one after its placed predecessor
+    std::vector<char> placed(count, 0);
+    for (int row = tails.empty() ? -1 : tails.back(); row >= 0; row = previous[row]) {
+        placed[row] = 1;
+    }
+
+    std::vector<int> pending;
+    std::vector<int> placedTargets;
+    for (int row = 0; row < count; ++row) {
+        (placed[row] ? placedTargets : pending).push_back(target[row]);
+    }
+    std::sort(pending.begin(), pending.end());
+
+    for (int wanted : pending) {
+        int from = -1;
+        int after = -1;
+        int afterTarget = -1;
+        for (int row = 0; row < count; ++row) {
+            const int t = target[row];
+            if (t == wanted)
+                from = row;
+            else if (t < wanted && t > afterTarget
+                     && std::binary_search(placedTargets.begin(), placedTargets.end(), t)) {
+                after = row;
+                afterTarget = t;
+            }
+        }
+
+        const int destination = after + 1;
+        if (destination != from && destination != from + 1) {
+            listener.beginMove(from, destination);
+            const int insertAt = destination > from ? destination - 1 : destination;
+
+            const int id = current[from];
+            current.erase(current.begin() + from);
+            current.insert(current.begin() + insertAt, id);
+            target.erase(target.begin() + from);
+            target.insert(target.begin() + insertAt, wanted);
+
+            listener.endMove();
+        }
+
+        placedTargets.insert(std::lower_bound(placedTargets.begin(), placedTargets.end(), wanted), wanted);
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef ROWDIFF_H
+#define ROWDIFF_H
+
+#include <cstddef>
+#include <vector>
+
+// Edit script between two orderings of a list model's rows.
+// Rows are identified by an id (e.g. a track slot) that is unique within a
+// list, non-negative and below idLimit. apply() turns the current rows into
+// the next ones with row removals, moves and insertions, in that order, so
+// views keep their delegates and scroll position. Each step is bracketed by
+// Listener calls, with the rows already changed when the matching end call
+// arrives. A scattered script falls back to one reset, and a re-sort of the
+// surviving rows to one layout change.
+class RowDiff
+{
+public:
+    // The QAbstractItemModel notifications for each step
+    class Listener
+    {
+    public:
+        virtual ~Listener() = default;
+
+        virtual void beginReset() = 0;
+        virtual void endReset() = 0;
+        virtual void beginRemove(int first, int last) = 0;
+        virtual void endRemove() = 0;
+        virtual void beginMove(int from, int destination) = 0;    // destination as in beginMoveRows()
+        virtual void endMove() = 0;
+        virtual void beginInsert(int first, int last) = 0;
+        virtual void endInsert() = 0;
+        virtual void beginLayoutChange() = 0;
+        virtual void endLayoutChange(const std::vector<int>& newRows) = 0;   // new row of each old row
+    };
+
+    RowDiff(int maxOperations, int maxMoves)
+        : m_maxOperations(maxOperations)
+        , m_maxMoves(maxMoves)
+    {
+    }
+
+    void apply(std::vector<int>& rows, std::vector<int> next, size_t idLimit, Listener& listener) const;
+
+private:
+    void reorder(std::vector<int>& rows, std::vector<int>& target, Listener& listener) const;
+
+    int m_maxOperations;    // removal plus insertion runs before a reset
+    int m_maxMoves;         // single-row moves before a layout change
+};
+
+#endif // ROWDIFF_H
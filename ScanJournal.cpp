@@ -0,0 +1,179 @@
+#include "ScanJournal.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+ScanJournal::ScanJournal(const QString& filePath)
+    : m_filePath(filePath)
+{
+}
+
+// ==================== Static Helpers ====================
+
+FileState ScanJournal::fileState(const QString& path)
+{
+    FileState state;
+
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(path).constData(), &st) != 0)
+        return state;
+
+    state.size = static_cast<qint64>(st.st_size);
+    state.inode = static_cast<quint64>(st.st_ino);
+#ifdef Q_OS_LINUX
+    state.mtimeMs = qint64(st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#else
+    state.mtimeMs = qint64(st.st_mtime) * 1000;
+#endif
+#else
+    QFileInfo info(path);
+    if (!info.exists())
+        return state;
+
+    state.size = info.size();
+    state.mtimeMs = info.lastModified().toMSecsSinceEpoch();
+#endif
+
+    return state;
+}
+
+QString ScanJournal::defaultLocation(const QString& fileName)
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dir);
+    return dir + "/" + fileName;
+}
+
+// ==================== Persistence ====================
+
+bool ScanJournal::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+
+    if (magic != kMagic || version != kVersion) {
+        qWarning() << "Ignoring scan journal with unknown format:" << m_filePath;
+        return false;
+    }
+
+    // The count comes from disk; never reserve more than the file can hold
+    const qint64 fits = (file.size() - file.pos()) / kMinEntrySize;
+    m_entries.clear();
+    m_entries.reserve(static_cast<int>(qMin<qint64>(count, fits)));
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path, title, artist, album, genre;
+        Entry entry;
+        int year = 0;
+        int trackNumber = 0;
+        qint64 duration = 0;
+
+        in >> path
+           >> entry.state.size >> entry.state.mtimeMs >> entry.state.inode
+           >> title >> artist >> album >> genre
+           >> year >> trackNumber >> duration;
+
+        entry.track = Track(path, title, artist);
+        entry.track.setAlbum(album);
+        entry.track.setGenre(genre);
+        entry.track.setYear(year);
+        entry.track.setTrackNumber(trackNumber);
+        entry.track.setDuration(duration);
+
+        m_entries.insert(path, entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Scan journal is truncated, discarding:" << m_filePath;
+        m_entries.clear();
+        return false;
+    }
+
+    m_dirty = false;
+    qDebug() << "Loaded scan journal with" << m_entries.size() << "entries";
+    return true;
+}
+
+bool ScanJournal::save()
+{
+    if (!m_dirty)
+        return true;
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Cannot save scan journal to" << m_filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << kMagic << kVersion << static_cast<quint32>(m_entries.size());
+
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        const Entry& entry = it.value();
+        const Track& track = entry.track;
+        out << it.key()
+            << entry.state.size << entry.state.mtimeMs << entry.state.inode
+            << track.title() << track.artist() << track.album() << track.genre()
+            << track.year() << track.trackNumber() << track.duration();
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write scan journal:" << m_filePath;
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+// ==================== Entries ====================
+
+const ScanJournal::Entry* ScanJournal::find(const QString& path) const
+{
+    auto it = m_entries.constFind(path);
+    return it != m_entries.cend() ? &it.value() : nullptr;
+}
+
+void ScanJournal::update(const QString& path, const FileState& state, const Track& track)
+{
+    m_entries.insert(path, Entry{state, track});
+    m_dirty = true;
+}
+
+void ScanJournal::remove(const QString& path)
+{
+    if (m_entries.remove(path) > 0)
+        m_dirty = true;
+}
+
+QStringList ScanJournal::pathsUnder(const QString& root) const
+{
+    QString prefix = QDir::cleanPath(root);
+    if (!prefix.endsWith('/'))
+        prefix += '/';
+
+    QStringList paths;
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        if (it.key().startsWith(prefix))
+            paths.append(it.key());
+    }
+    return paths;
+}
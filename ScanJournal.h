@@ -0,0 +1,67 @@
+#ifndef SCANJOURNAL_H
+#define SCANJOURNAL_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include "Track.h"
+
+// On-disk identity of a file as seen by the last scan
+struct FileState {
+    qint64 size = -1;
+    qint64 mtimeMs = 0;
+    quint64 inode = 0;
+
+    bool exists() const { return size >= 0; }
+    bool operator==(const FileState& other) const
+    {
+        return size == other.size && mtimeMs == other.mtimeMs && inode == other.inode;
+    }
+    bool operator!=(const FileState& other) const { return !(*this == other); }
+};
+
+// Persisted per-file fingerprints plus the metadata parsed for them.
+// A rescan compares each file's current FileState against the journal and
+// only re-parses files that are new or changed; journal entries whose
+// files were not seen again are reported as deleted.
+//
+// Not synchronised: readers (scanner workers) and writers (the scanner on
+// its own thread, after its workers have finished) never overlap.
+class ScanJournal
+{
+public:
+    struct Entry {
+        FileState state;
+        Track track;
+    };
+
+    explicit ScanJournal(const QString& filePath);
+
+    // Single stat() call; inode is 0 where the platform has none
+    static FileState fileState(const QString& path);
+    static QString defaultLocation(const QString& fileName);
+
+    bool load();
+    bool save();
+
+    const Entry* find(const QString& path) const;
+    void update(const QString& path, const FileState& state, const Track& track);
+    void remove(const QString& path);
+
+    // Journalled paths below the given directory
+    QStringList pathsUnder(const QString& root) const;
+
+    int size() const { return m_entries.size(); }
+    QString filePath() const { return m_filePath; }
+
+private:
+    QString m_filePath;
+    QHash<QString, Entry> m_entries;
+    bool m_dirty = false;
+
+    static constexpr quint32 kMagic = 0x464A524E;   // "FJRN"
+    static constexpr quint16 kVersion = 1;
+    static constexpr qint64 kMinEntrySize = 60;     // all strings empty
+};
+
+#endif // SCANJOURNAL_H
@@ -0,0 +1,153 @@
+#include "SearchIndex.h"
+#include <algorithm>
+
+namespace {
+
+// Cannot appear in a normalised query, so matches stay within one field
+constexpr QChar kFieldSeparator(0x1F);
+
+} // namespace
+
+SearchIndex::Trigram SearchIndex::trigramAt(const QChar* text)
+{
+    return (Trigram(text[0].unicode()) << 32) | (Trigram(text[1].unicode()) << 16) | text[2].unicode();
+}
+
+QString SearchIndex::normalize(const QString& query)
+{
+    return query.trimmed().toCaseFolded();
+}
+
+// ==================== Maintenance ====================
+
+void SearchIndex::add(int doc, const Track& track)
+{
+    if (doc < 0)
+        return;
+
+    if (doc >= static_cast<int>(m_haystacks.size()))
+        m_haystacks.resize(doc + 1);
+
+    remove(doc);
+
+    QString haystack = track.title();
+    haystack += kFieldSeparator;
+    haystack += track.artist();
+    haystack += kFieldSeparator;
+    haystack += track.album();
+    haystack += kFieldSeparator;
+    haystack += track.genre();
+
+    m_haystacks[doc] = haystack.toCaseFolded();
+    ++m_liveDocs;
+
+    indexHaystack(doc, m_haystacks[doc]);
+}
+
+void SearchIndex::remove(int doc)
+{
+    if (doc < 0 || doc >= static_cast<int>(m_haystacks.size()) || m_haystacks[doc].isNull())
+        return;
+
+    // Its posting entries go stale; verification rejects them from now on
+    const int length = static_cast<int>(m_haystacks[doc].size());
+    m_staleEntries += std::max(0, length - 2);
+    m_haystacks[doc] = QString();
+    --m_liveDocs;
+
+    if (m_staleEntries > 4096 && m_staleEntries * 2 > m_postingEntries)
+        rebuildPostings();
+}
+
+void SearchIndex::clear()
+{
+    m_haystacks.clear();
+    m_postings.clear();
+    m_liveDocs = 0;
+    m_postingEntries = 0;
+    m_staleEntries = 0;
+}
+
+void SearchIndex::indexHaystack(int doc, const QString& haystack)
+{
+    const int length = static_cast<int>(haystack.size());
+    if (length < 3)
+        return;
+
+    // One posting per distinct trigram; repeats inside a doc add nothing
+    std::vector<Trigram> trigrams;
+    trigrams.reserve(length - 2);
+    const QChar* text = haystack.constData();
+    for (int i = 0; i + 2 < length; ++i) {
+        trigrams.push_back(trigramAt(text + i));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+    for (Trigram trigram : trigrams) {
+        m_postings[trigram].push_back(doc);
+    }
+
+    // Accounted per raw position so remove() can estimate without rescanning
+    m_postingEntries += length - 2;
+}
+
+void SearchIndex::rebuildPostings()
+{
+    m_postings.clear();
+    m_postingEntries = 0;
+    m_staleEntries = 0;
+
+    for (int doc = 0; doc < static_cast<int>(m_haystacks.size()); ++doc) {
+        if (!m_haystacks[doc].isNull())
+            indexHaystack(doc, m_haystacks[doc]);
+    }
+}
+
+// ==================== Queries ====================
+
+bool SearchIndex::matches(int doc, const QString& normalizedQuery) const
+{
+    if (doc < 0 || doc >= static_cast<int>(m_haystacks.size()) || m_haystacks[doc].isNull())
+        return false;
+
+    return normalizedQuery.isEmpty() || m_haystacks[doc].contains(normalizedQuery);
+}
+
+std::vector<int> SearchIndex::search(const QString& normalizedQuery) const
+{
+    std::vector<int> results;
+    const int docCount = static_cast<int>(m_haystacks.size());
+
+    // Too short for trigrams: verify every live doc in place
+    if (normalizedQuery.size() < 3) {
+        results.reserve(m_liveDocs);
+        for (int doc = 0; doc < docCount; ++doc) {
+            if (matches(doc, normalizedQuery))
+                results.push_back(doc);
+        }
+        return results;
+    }
+
+    // Every trigram of the query must occur in a match; the rarest bounds the candidates
+    const std::vector<int>* candidates = nullptr;
+    const QChar* text = normalizedQuery.constData();
+    for (int i = 0; i + 2 < normalizedQuery.size(); ++i) {
+        auto it = m_postings.constFind(trigramAt(text + i));
+        if (it == m_postings.cend())
+            return results;
+
+        if (!candidates || it.value().size() < candidates->size())
+            candidates = &it.value();
+    }
+
+    for (int doc : *candidates) {
+        if (m_haystacks[doc].contains(normalizedQuery))
+            results.push_back(doc);
+    }
+
+    // A doc re-added under the same id can appear twice in a posting list
+    std::sort(results.begin(), results.end());
+    results.erase(std::unique(results.begin(), results.end()), results.end());
+    return results;
+}
@@ -0,0 +1,49 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QHash>
+#include <QString>
+#include <vector>
+#include "Track.h"
+
+// Case-folded trigram index over title, artist, album and genre.
+// A document is an integer id chosen by the owner (a store slot); each keeps
+// one folded haystack with the fields separated so matches never span two
+// fields. A query of three or more characters is answered by taking the
+// rarest of its trigram posting lists and verifying only those candidates;
+// shorter queries scan the haystacks, which allocates nothing per track.
+//
+// Postings are append-only: remove() and re-adding a doc just drop or
+// replace its haystack, and stale posting entries fail verification until
+// enough accumulate to trigger a rebuild.
+class SearchIndex
+{
+public:
+    void add(int doc, const Track& track);
+    void remove(int doc);
+    void clear();
+
+    // Queries must be normalised once up front (trimmed, case-folded)
+    static QString normalize(const QString& query);
+
+    // Matching docs in ascending order; an empty query matches every doc
+    std::vector<int> search(const QString& normalizedQuery) const;
+    bool matches(int doc, const QString& normalizedQuery) const;
+
+    int size() const { return m_liveDocs; }
+
+private:
+    using Trigram = quint64;
+
+    static Trigram trigramAt(const QChar* text);
+    void indexHaystack(int doc, const QString& haystack);
+    void rebuildPostings();
+
+    std::vector<QString> m_haystacks;      // by doc; null when absent
+    QHash<Trigram, std::vector<int>> m_postings;
+    int m_liveDocs = 0;
+    qint64 m_postingEntries = 0;
+    qint64 m_staleEntries = 0;
+};
+
+#endif // SEARCHINDEX_H
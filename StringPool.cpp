@@ -0,0 +1,95 @@
+#include "StringPool.h"
+#include <QMutexLocker>
+#include <stdexcept>
+
+StringPool::StringPool()
+{
+    for (auto& chunk : m_chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    internLocked(QString());
+}
+
+StringPool::~StringPool()
+{
+    for (auto& chunk : m_chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+StringPool& StringPool::instance()
+{
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::Symbol StringPool::intern(const QString& value)
+{
+    if (value.isEmpty())
+        return EmptySymbol;
+
+    QMutexLocker locker(&m_mutex);
+    return internLocked(value);
+}
+
+StringPool::Symbol StringPool::find(const QString& value) const
+{
+    if (value.isEmpty())
+        return EmptySymbol;
+
+    QMutexLocker locker(&m_mutex);
+    return m_symbols.value(value, NoSymbol);
+}
+
+StringPool::Symbol StringPool::internLocked(const QString& value)
+{
+    auto it = m_symbols.constFind(value);
+    if (it != m_symbols.cend())
+        return it.value();
+
+    // The folded form is interned first so folded() always has a target
+    const QString foldedText = value.toCaseFolded();
+    const Symbol foldedSymbol = foldedText != value ? internLocked(foldedText) : NoSymbol;
+
+    const Symbol symbol = m_count.load(std::memory_order_relaxed);
+    const quint32 chunkIndex = symbol >> kChunkBits;
+    if (chunkIndex >= kMaxChunks)
+        throw std::length_error("StringPool is full");
+
+    Entry* chunk = m_chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Entry[kChunkSize];
+        m_chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+
+    Entry& entry = chunk[symbol & (kChunkSize - 1)];
+    entry.text = value;
+    entry.folded = foldedSymbol != NoSymbol ? foldedSymbol : symbol;
+
+    m_symbols.insert(value, symbol);
+
+    // Publishes the entry to lock-free readers
+    m_count.store(symbol + 1, std::memory_order_release);
+    return symbol;
+}
+
+const QString& StringPool::string(Symbol symbol) const
+{
+    static const QString empty;
+    if (symbol >= m_count.load(std::memory_order_acquire))
+        return empty;
+
+    const Entry* chunk = m_chunks[symbol >> kChunkBits].load(std::memory_order_acquire);
+    return chunk[symbol & (kChunkSize - 1)].text;
+}
+
+StringPool::Symbol StringPool::folded(Symbol symbol) const
+{
+    if (symbol >= m_count.load(std::memory_order_acquire))
+        return symbol;
+
+    const Entry* chunk = m_chunks[symbol >> kChunkBits].load(std::memory_order_acquire);
+    return chunk[symbol & (kChunkSize - 1)].folded;
+}
@@ -0,0 +1,64 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+// Process-wide symbol table for repetitive metadata (artist, album, genre).
+// Each distinct string is stored once and addressed by a compact integer
+// Symbol, so grouping and equality checks compare integers and a Track
+// carries three 32-bit handles instead of three QStrings.
+//
+// Symbols are never freed. Entries live in fixed-size chunks that are never
+// moved, so string() and folded() are lock-free; only intern() locks.
+class StringPool
+{
+public:
+    using Symbol = quint32;
+
+    static constexpr Symbol EmptySymbol = 0;       // always ""
+    static constexpr Symbol NoSymbol = ~Symbol(0);
+
+    static StringPool& instance();
+
+    // Returns the existing symbol for value or creates one
+    Symbol intern(const QString& value);
+
+    // Lookup without inserting; NoSymbol when value was never interned
+    Symbol find(const QString& value) const;
+
+    const QString& string(Symbol symbol) const;
+
+    // Symbol of the case-folded form; equal for strings that differ only in case
+    Symbol folded(Symbol symbol) const;
+
+    int size() const { return static_cast<int>(m_count.load(std::memory_order_acquire)); }
+
+private:
+    StringPool();
+    ~StringPool();
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    struct Entry {
+        QString text;
+        Symbol folded = 0;
+    };
+
+    Symbol internLocked(const QString& value);
+
+    static constexpr int kChunkBits = 12;
+    static constexpr quint32 kChunkSize = 1u << kChunkBits;
+    static constexpr quint32 kMaxChunks = 4096;
+
+    std::atomic<Entry*> m_chunks[kMaxChunks];
+    std::atomic<quint32> m_count{0};
+
+    mutable QMutex m_mutex;
+    QHash<QString, Symbol> m_symbols;
+};
+
+#endif // STRINGPOOL_H
@@ -0,0 +1,1210 @@
+#include "TagReader.h"
+#include <QBuffer>
+#include <QByteArray>
+#include <QFile>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+// Upper bounds on what is ever pulled into memory for a single frame/block
+constexpr qint64 kMaxTextFrame = 64 * 1024;
+constexpr qint64 kMaxCommentBlock = 1024 * 1024;
+constexpr qint64 kMaxUnsyncTag = 4 * 1024 * 1024;
+constexpr qint64 kMaxPicture = 16 * 1024 * 1024;
+constexpr int kFrontCover = 3;      // ID3/FLAC picture type
+constexpr int kMpegProbeSize = 16 * 1024;
+constexpr qint64 kOggTailSize = 64 * 1024;
+constexpr int kMaxOggPages = 64;
+
+const char* const kId3Genres[] = {
+    "Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge", "Hip-Hop",
+    "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B", "Rap", "Reggae", "Rock",
+    "Techno", "Industrial", "Alternative", "Ska", "Death Metal", "Pranks", "Soundtrack",
+    "Euro-Techno", "Ambient", "Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance",
+    "Classical", "Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+    "AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative", "Instrumental Pop",
+    "Instrumental Rock", "Ethnic", "Gothic", "Darkwave", "Techno-Industrial", "Electronic",
+    "Pop-Folk", "Eurodance", "Dream", "Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40",
+    "Christian Rap", "Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave",
+    "Psychadelic", "Rave", "Showtunes", "Trailer", "Lo-Fi", "Tribal", "Acid Punk",
+    "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll", "Hard Rock", "Folk",
+    "Folk-Rock", "National Folk", "Swing", "Fast Fusion", "Bebob", "Latin", "Revival",
+    "Celtic", "Bluegrass", "Avantgarde", "Gothic Rock", "Progressive Rock",
+    "Psychedelic Rock", "Symphonic Rock", "Slow Rock", "Big Band", "Chorus",
+    "Easy Listening", "Acoustic", "Humour", "Speech", "Chanson", "Opera", "Chamber Music",
+    "Sonata", "Symphony", "Booty Bass", "Primus", "Porn Groove", "Satire", "Slow Jam",
+    "Club", "Tango", "Samba", "Folklore", "Ballad", "Power Ballad", "Rhythmic Soul",
+    "Freestyle", "Duet", "Punk Rock", "Drum Solo", "A capella", "Euro-House", "Dance Hall"
+};
+constexpr int kId3GenreCount = static_cast<int>(sizeof(kId3Genres) / sizeof(kId3Genres[0]));
+
+// ==================== Byte Helpers ====================
+
+inline quint32 be16(const uchar* p) { return (quint32(p[0]) << 8) | p[1]; }
+inline quint32 be24(const uchar* p) { return (quint32(p[0]) << 16) | (quint32(p[1]) << 8) | p[2]; }
+inline quint32 be32(const uchar* p) { return (quint32(p[0]) << 24) | be24(p + 1); }
+inline quint64 be64(const uchar* p) { return (quint64(be32(p)) << 32) | be32(p + 4); }
+inline quint32 le16(const uchar* p) { return quint32(p[0]) | (quint32(p[1]) << 8); }
+inline quint32 le32(const uchar* p) { return le16(p) | (le16(p + 2) << 16); }
+inline quint64 le64(const uchar* p) { return quint64(le32(p)) | (quint64(le32(p + 4)) << 32); }
+inline quint32 synchsafe32(const uchar* p)
+{
+    return (quint32(p[0] & 0x7F) << 21) | (quint32(p[1] & 0x7F) << 14)
+           | (quint32(p[2] & 0x7F) << 7) | quint32(p[3] & 0x7F);
+}
+
+inline const uchar* bytes(const char* p) { return reinterpret_cast<const uchar*>(p); }
+
+bool readAt(QIODevice& device, qint64 pos, char* buffer, qint64 length)
+{
+    return device.seek(pos) && device.read(buffer, length) == length;
+}
+
+QByteArray readBlock(QIODevice& device, qint64 pos, qint64 length)
+{
+    if (!device.seek(pos))
+        return QByteArray();
+    return device.read(length);
+}
+
+// Reverses ID3 unsynchronisation (0xFF 0x00 -> 0xFF) in place
+void removeUnsync(QByteArray& data)
+{
+    char* out = data.data();
+    const char* in = out;
+    const char* end = in + data.size();
+    while (in < end) {
+        const char c = *in++;
+        *out++ = c;
+        if (uchar(c) == 0xFF && in < end && *in == 0)
+            ++in;
+    }
+    data.truncate(static_cast<int>(out - data.data()));
+}
+
+// ==================== Text Helpers ====================
+
+int nulLength(const char* p, int size)
+{
+    const void* nul = std::memchr(p, 0, static_cast<size_t>(size));
+    return nul ? static_cast<int>(static_cast<const char*>(nul) - p) : size;
+}
+
+QString fromUtf16Bytes(const uchar* p, int size, bool bigEndian)
+{
+    int units = size / 2;
+    for (int i = 0; i < units; ++i) {
+        if (p[2 * i] == 0 && p[2 * i + 1] == 0) {
+            units = i;
+            break;
+        }
+    }
+
+    QString text(units, Qt::Uninitialized);
+    QChar* out = text.data();
+    for (int i = 0; i < units; ++i) {
+        const uchar* unit = p + 2 * i;
+        out[i] = QChar(static_cast<char16_t>(bigEndian ? be16(unit) : le16(unit)));
+    }
+    return text;
+}
+
+QString decodeId3Text(const char* data, int size)
+{
+    if (size < 2)
+        return QString();
+
+    const uchar encoding = uchar(data[0]);
+    const char* p = data + 1;
+    int n = size - 1;
+
+    switch (encoding) {
+    case 0:
+        return QString::fromLatin1(p, nulLength(p, n)).trimmed();
+    case 3:
+        return QString::fromUtf8(p, nulLength(p, n)).trimmed();
+    case 1:
+    case 2: {
+        bool bigEndian = (encoding == 2);
+        if (n >= 2 && uchar(p[0]) == 0xFF && uchar(p[1]) == 0xFE) {
+            bigEndian = false;
+            p += 2;
+            n -= 2;
+        } else if (n >= 2 && uchar(p[0]) == 0xFE && uchar(p[1]) == 0xFF) {
+            bigEndian = true;
+            p += 2;
+            n -= 2;
+        }
+        return fromUtf16Bytes(bytes(p), n, bigEndian).trimmed();
+    }
+    default:
+        return QString();
+    }
+}
+
+QString id3GenreName(int index)
+{
+    if (index >= 0 && index < kId3GenreCount)
+        return QString::fromLatin1(kId3Genres[index]);
+    return QString();
+}
+
+// Resolves "(17)", "17" and "(17)Rock" style genre references
+QString resolveGenre(const QString& genre)
+{
+    if (genre.isEmpty())
+        return genre;
+
+    if (genre.startsWith(QLatin1Char('('))) {
+        const int close = genre.indexOf(QLatin1Char(')'));
+        if (close > 1) {
+            const QString refinement = genre.mid(close + 1).trimmed();
+            if (!refinement.isEmpty())
+                return refinement;
+            bool ok = false;
+            const int index = genre.mid(1, close - 1).toInt(&ok);
+            if (ok)
+                return id3GenreName(index);
+        }
+        return genre;
+    }
+
+    bool ok = false;
+    const int index = genre.toInt(&ok);
+    return ok ? id3GenreName(index) : genre;
+}
+
+int parseYear(const QString& date)
+{
+    return date.left(4).toInt();
+}
+
+int parseTrackNumber(const QString& track)
+{
+    return track.section(QLatin1Char('/'), 0, 0).trimmed().toInt();
+}
+
+// First value wins; later duplicates (ID3v1, repeated comments) never override
+void assignIfEmpty(QString& field, const QString& value)
+{
+    if (field.isEmpty() && !value.isEmpty())
+        field = value;
+}
+
+bool keyIs(const char* key, int keyLength, const char* name)
+{
+    const int n = static_cast<int>(std::strlen(name));
+    return keyLength == n && qstrnicmp(key, name, static_cast<uint>(n)) == 0;
+}
+
+// Parses a Vorbis comment payload (shared by FLAC, Ogg Vorbis and Opus)
+void parseVorbisComments(const char* data, qint64 size, AudioTags& tags)
+{
+    qint64 pos = 0;
+    auto need = [&](qint64 n) { return n >= 0 && pos + n <= size; };
+
+    if (!need(4))
+        return;
+    const qint64 vendorLength = le32(bytes(data + pos));
+    pos += 4;
+    if (!need(vendorLength))
+        return;
+    pos += vendorLength;
+
+    if (!need(4))
+        return;
+    const quint32 count = le32(bytes(data + pos));
+    pos += 4;
+
+    for (quint32 i = 0; i < count; ++i) {
+        if (!need(4))
+            return;
+        const qint64 length = le32(bytes(data + pos));
+        pos += 4;
+        if (!need(length))
+            return;
+
+        const char* entry = data + pos;
+        pos += length;
+
+        const void* eq = std::memchr(entry, '=', static_cast<size_t>(length));
+        if (!eq)
+            continue;
+
+        const int keyLength = static_cast<int>(static_cast<const char*>(eq) - entry);
+        const char* value = entry + keyLength + 1;
+        const int valueLength = static_cast<int>(length) - keyLength - 1;
+
+        if (keyIs(entry, keyLength, "TITLE"))
+            assignIfEmpty(tags.title, QString::fromUtf8(value, valueLength).trimmed());
+        else if (keyIs(entry, keyLength, "ARTIST"))
+            assignIfEmpty(tags.artist, QString::fromUtf8(value, valueLength).trimmed());
+        else if (keyIs(entry, keyLength, "ALBUM"))
+            assignIfEmpty(tags.album, QString::fromUtf8(value, valueLength).trimmed());
+        else if (keyIs(entry, keyLength, "GENRE"))
+            assignIfEmpty(tags.genre, QString::fromUtf8(value, valueLength).trimmed());
+        else if (keyIs(entry, keyLength, "DATE") && tags.year == 0)
+            tags.year = parseYear(QString::fromLatin1(value, valueLength));
+        else if (keyIs(entry, keyLength, "TRACKNUMBER") && tags.trackNumber == 0)
+            tags.trackNumber = parseTrackNumber(QString::fromLatin1(value, valueLength));
+    }
+}
+
+// ==================== MPEG Audio ====================
+
+struct MpegFrame {
+    int version = 0;        // 1, 2 or 25 (MPEG 2.5)
+    int layer = 0;
+    int bitrateKbps = 0;
+    int sampleRate = 0;
+    int channels = 0;
+    int frameLength = 0;
+    int samplesPerFrame = 0;
+};
+
+bool parseMpegHeader(const uchar* h, MpegFrame& frame)
+{
+    static const int kBitrates[5][15] = {
+        {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},  // V1 L1
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},     // V1 L2
+        {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},      // V1 L3
+        {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},     // V2 L1
+        {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}           // V2 L2/L3
+    };
+    static const int kSampleRates[3][3] = {
+        {44100, 48000, 32000},
+        {22050, 24000, 16000},
+        {11025, 12000, 8000}
+    };
+
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0)
+        return false;
+
+    const int versionBits = (h[1] >> 3) & 0x03;
+    const int layerBits = (h[1] >> 1) & 0x03;
+    const int bitrateIndex = (h[2] >> 4) & 0x0F;
+    const int sampleRateIndex = (h[2] >> 2) & 0x03;
+    const int padding = (h[2] >> 1) & 0x01;
+
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15
+        || sampleRateIndex == 3)
+        return false;
+
+    frame.version = versionBits == 3 ? 1 : (versionBits == 2 ? 2 : 25);
+    frame.layer = 4 - layerBits;
+    frame.channels = ((h[3] >> 6) & 0x03) == 3 ? 1 : 2;
+    frame.sampleRate = kSampleRates[frame.version == 1 ? 0 : (frame.version == 2 ? 1 : 2)][sampleRateIndex];
+
+    const int table = frame.version == 1 ? frame.layer - 1 : (frame.layer == 1 ? 3 : 4);
+    frame.bitrateKbps = kBitrates[table][bitrateIndex];
+
+    if (frame.layer == 1) {
+        frame.samplesPerFrame = 384;
+        frame.frameLength = (12 * frame.bitrateKbps * 1000 / frame.sampleRate + padding) * 4;
+    } else {
+        frame.samplesPerFrame = (frame.layer == 3 && frame.version != 1) ? 576 : 1152;
+        frame.frameLength = frame.samplesPerFrame / 8 * frame.bitrateKbps * 1000 / frame.sampleRate + padding;
+    }
+    return frame.frameLength > 4;
+}
+
+// ADTS AAC: walks a few frame headers to estimate the average frame size
+bool readAdts(QIODevice& device, qint64 start, qint64 end, AudioTags& tags)
+{
+    static const int kAacRates[13] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+    };
+    constexpr int kSampleFrames = 64;
+
+    qint64 pos = start;
+    qint64 measuredBytes = 0;
+    int frames = 0;
+    int sampleRate = 0;
+    uchar h[7];
+
+    while (frames < kSampleFrames && pos + 7 <= end) {
+        if (!readAt(device, pos, reinterpret_cast<char*>(h), 7))
+            break;
+        if (h[0] != 0xFF || (h[1] & 0xF6) != 0xF0)
+            break;
+
+        const int rateIndex = (h[2] >> 2) & 0x0F;
+        const int frameLength = ((h[3] & 0x03) << 11) | (h[4] << 3) | (h[5] >> 5);
+        if (rateIndex >= 13 || frameLength < 7)
+            break;
+
+        if (frames == 0) {
+            sampleRate = kAacRates[rateIndex];
+            tags.channels = ((h[2] & 0x01) << 2) | (h[3] >> 6);
+        }
+
+        measuredBytes += frameLength;
+        pos += frameLength;
+        ++frames;
+    }
+
+    if (frames == 0 || sampleRate == 0)
+        return false;
+
+    tags.sampleRate = sampleRate;
+    const double averageFrame = double(measuredBytes) / frames;
+    const double totalFrames = double(end - start) / averageFrame;
+    tags.durationMs = static_cast<qint64>(totalFrames * 1024.0 * 1000.0 / sampleRate);
+    return true;
+}
+
+// ==================== Ogg ====================
+
+// Reassembles packets of the first logical stream, one page at a time
+class OggPacketReader
+{
+public:
+    explicit OggPacketReader(QIODevice& device) : m_device(device) {}
+
+    bool next(QByteArray& packet, qint64 maxBytes)
+    {
+        packet.clear();
+        for (;;) {
+            if (m_segmentIndex >= m_segmentCount) {
+                if (!loadPage())
+                    return false;
+                continue;
+            }
+
+            const int length = m_lacing[m_segmentIndex++];
+            if (packet.size() + length <= maxBytes) {
+                if (!m_device.seek(m_dataPos))
+                    return false;
+                packet.append(m_device.read(length));
+            }
+            m_dataPos += length;
+
+            if (length < 255)
+                return true;
+        }
+    }
+
+    quint32 serial() const { return m_serial; }
+
+private:
+    bool loadPage()
+    {
+        uchar header[27];
+        while (m_pagesRead < kMaxOggPages) {
+            if (!readAt(m_device, m_pagePos, reinterpret_cast<char*>(header), 27)
+                || std::memcmp(header, "OggS", 4) != 0)
+                return false;
+
+            const int segments = header[26];
+            if (m_device.read(reinterpret_cast<char*>(m_lacing), segments) != segments)
+                return false;
+
+            qint64 bodySize = 0;
+            for (int i = 0; i < segments; ++i)
+                bodySize += m_lacing[i];
+
+            const quint32 serial = le32(header + 14);
+            m_dataPos = m_pagePos + 27 + segments;
+            m_pagePos = m_dataPos + bodySize;
+            ++m_pagesRead;
+
+            if (!m_haveSerial) {
+                m_serial = serial;
+                m_haveSerial = true;
+            } else if (serial != m_serial) {
+                continue;
+            }
+
+            m_segmentCount = segments;
+            m_segmentIndex = 0;
+            return true;
+        }
+        return false;
+    }
+
+    QIODevice& m_device;
+    qint64 m_pagePos = 0;
+    qint64 m_dataPos = 0;
+    uchar m_lacing[255];
+    int m_segmentCount = 0;
+    int m_segmentIndex = 0;
+    int m_pagesRead = 0;
+    quint32 m_serial = 0;
+    bool m_haveSerial = false;
+};
+
+// ==================== ID3 Frames ====================
+
+// One ID3v2 frame as seen by walkId3Frames(); the body is read on demand
+struct Id3Frame {
+    QIODevice* device = nullptr;
+    const char* id = nullptr;   // 3 characters in v2.2, 4 in v2.3/v2.4
+    int version = 0;
+    uchar format = 0;           // per-frame format flags (v2.3/v2.4)
+    qint64 bodyPos = 0;
+    qint64 size = 0;
+
+    bool idIs(const char* v2, const char* v3) const
+    {
+        return std::memcmp(id, version == 2 ? v2 : v3, version == 2 ? 3 : 4) == 0;
+    }
+
+    // Payload with the group id / data length prefixes stripped and frame
+    // unsynchronisation removed; empty if compressed, encrypted or unreadable
+    QByteArray body() const
+    {
+        int skip = 0;
+        if (version == 3) {
+            if (format & 0xC0)              // compressed / encrypted
+                return QByteArray();
+            if (format & 0x20)
+                skip = 1;                   // group id
+        } else if (version == 4) {
+            if (format & 0x0C)              // compressed / encrypted
+                return QByteArray();
+            if (format & 0x40)
+                skip += 1;                  // group id
+            if (format & 0x01)
+                skip += 4;                  // data length indicator
+        }
+
+        QByteArray data = readBlock(*device, bodyPos, size);
+        if (data.size() != size)
+            return QByteArray();
+        if (version == 4 && (format & 0x02))
+            removeUnsync(data);
+        if (skip >= data.size())
+            return QByteArray();
+        return data.mid(skip);
+    }
+};
+
+// Return false to stop the walk
+using Id3FrameVisitor = std::function<bool(const Id3Frame&)>;
+
+// Calls visit for each frame of the ID3v2 tag at offset, handling whole-tag
+// unsynchronisation, the extended header and the per-version size fields.
+// Returns false when there is no supported tag there.
+bool walkId3Frames(QIODevice& device, qint64 offset, qint64* tagEnd, const Id3FrameVisitor& visit)
+{
+    uchar header[10];
+    if (!readAt(device, offset, reinterpret_cast<char*>(header), 10) || std::memcmp(header, "ID3", 3) != 0)
+        return false;
+
+    const int version = header[3];
+    const uchar flags = header[5];
+    const qint64 size = synchsafe32(header + 6);
+
+    if (tagEnd)
+        *tagEnd = offset + 10 + size + ((flags & 0x10) ? 10 : 0);
+
+    if (version < 2 || version > 4)
+        return false;
+
+    // Whole-tag unsynchronisation (v2.2/v2.3): resync once, then walk from memory
+    if ((flags & 0x80) && version < 4) {
+        if (size > kMaxUnsyncTag)
+            return false;
+        QByteArray raw = readBlock(device, offset + 10, size);
+        removeUnsync(raw);
+
+        QByteArray wrapped;
+        wrapped.reserve(10 + raw.size());
+        wrapped.append(reinterpret_cast<const char*>(header), 10);
+        wrapped[5] = char(flags & ~0x80);
+        wrapped.append(raw);
+        const quint32 resyncedSize = static_cast<quint32>(raw.size());
+        wrapped[6] = char((resyncedSize >> 21) & 0x7F);
+        wrapped[7] = char((resyncedSize >> 14) & 0x7F);
+        wrapped[8] = char((resyncedSize >> 7) & 0x7F);
+        wrapped[9] = char(resyncedSize & 0x7F);
+
+        QBuffer resynced(&wrapped);
+        resynced.open(QIODevice::ReadOnly);
+        return walkId3Frames(resynced, 0, nullptr, visit);
+    }
+
+    const int frameHeaderSize = version == 2 ? 6 : 10;
+    qint64 pos = offset + 10;
+    const qint64 end = offset + 10 + size;
+
+    // Extended header
+    if (flags & 0x40) {
+        uchar ext[4];
+        if (!readAt(device, pos, reinterpret_cast<char*>(ext), 4))
+            return false;
+        pos += version == 4 ? synchsafe32(ext) : 4 + be32(ext);
+    }
+
+    uchar fh[10];
+    Id3Frame frame;
+    frame.device = &device;
+    frame.id = reinterpret_cast<const char*>(fh);
+    frame.version = version;
+    while (pos + frameHeaderSize <= end) {
+        if (!readAt(device, pos, reinterpret_cast<char*>(fh), frameHeaderSize) || fh[0] == 0)
+            break;
+
+        if (version == 2)
+            frame.size = be24(fh + 3);
+        else if (version == 3)
+            frame.size = be32(fh + 4);
+        else
+            frame.size = synchsafe32(fh + 4);
+
+        frame.bodyPos = pos + frameHeaderSize;
+        frame.format = version == 2 ? 0 : fh[9];
+        pos = frame.bodyPos + frame.size;
+        if (frame.size <= 0 || pos > end)
+            break;
+
+        if (!visit(frame))
+            break;
+    }
+
+    return true;
+}
+
+// ==================== MP4 ====================
+
+struct Mp4Atom {
+    char type[4];
+    qint64 bodyPos = 0;
+    qint64 end = 0;
+};
+
+bool readMp4Atom(QIODevice& device, qint64 pos, qint64 limit, Mp4Atom& atom)
+{
+    uchar header[16];
+    if (pos + 8 > limit || !readAt(device, pos, reinterpret_cast<char*>(header), 8))
+        return false;
+
+    qint64 size = be32(header);
+    std::memcpy(atom.type, header + 4, 4);
+    atom.bodyPos = pos + 8;
+
+    if (size == 1) {
+        if (device.read(reinterpret_cast<char*>(header + 8), 8) != 8)
+            return false;
+        size = static_cast<qint64>(be64(header + 8));
+        atom.bodyPos = pos + 16;
+    } else if (size == 0) {
+        size = limit - pos;
+    }
+
+    atom.end = pos + size;
+    return size >= atom.bodyPos - pos && atom.end <= limit;
+}
+
+bool findMp4Child(QIODevice& device, qint64 pos, qint64 end, const char* type, Mp4Atom& found)
+{
+    Mp4Atom atom;
+    while (readMp4Atom(device, pos, end, atom)) {
+        if (std::memcmp(atom.type, type, 4) == 0) {
+            found = atom;
+            return true;
+        }
+        pos = atom.end;
+    }
+    return false;
+}
+
+// iTunes-style metadata: moov/udta/meta/ilst (meta is sometimes directly under moov)
+bool findMp4Ilst(QIODevice& device, const Mp4Atom& moov, Mp4Atom& ilst)
+{
+    Mp4Atom udta;
+    Mp4Atom meta;
+    bool haveMeta = false;
+    if (findMp4Child(device, moov.bodyPos, moov.end, "udta", udta))
+        haveMeta = findMp4Child(device, udta.bodyPos, udta.end, "meta", meta);
+    if (!haveMeta)
+        haveMeta = findMp4Child(device, moov.bodyPos, moov.end, "meta", meta);
+    if (!haveMeta)
+        return false;
+
+    // ISO meta is a full box (4-byte version/flags); QuickTime meta is not
+    char probe[8];
+    qint64 children = meta.bodyPos;
+    if (readAt(device, meta.bodyPos, probe, 8) && std::memcmp(probe + 4, "hdlr", 4) != 0)
+        children += 4;
+
+    return findMp4Child(device, children, meta.end, "ilst", ilst);
+}
+
+void readMp4Items(QIODevice& device, const Mp4Atom& ilst, AudioTags& tags)
+{
+    Mp4Atom item;
+    qint64 pos = ilst.bodyPos;
+    while (readMp4Atom(device, pos, ilst.end, item)) {
+        pos = item.end;
+
+        const qint64 itemSize = item.end - item.bodyPos;
+        if (itemSize < 16 || itemSize > kMaxTextFrame)
+            continue;
+
+        const QByteArray body = readBlock(device, item.bodyPos, itemSize);
+        if (body.size() < 16 || std::memcmp(body.constData() + 4, "data", 4) != 0)
+            continue;
+
+        const qint64 dataSize = std::min<qint64>(be32(bytes(body.constData())), body.size());
+        if (dataSize < 16)
+            continue;
+
+        const char* payload = body.constData() + 16;
+        const int payloadSize = static_cast<int>(dataSize - 16);
+        const QString text = QString::fromUtf8(payload, payloadSize).trimmed();
+
+        if (std::memcmp(item.type, "\xA9nam", 4) == 0)
+            assignIfEmpty(tags.title, text);
+        else if (std::memcmp(item.type, "\xA9" "ART", 4) == 0)
+            assignIfEmpty(tags.artist, text);
+        else if (std::memcmp(item.type, "\xA9" "alb", 4) == 0)
+            assignIfEmpty(tags.album, text);
+        else if (std::memcmp(item.type, "\xA9gen", 4) == 0)
+            assignIfEmpty(tags.genre, text);
+        else if (std::memcmp(item.type, "gnre", 4) == 0 && payloadSize >= 2)
+            assignIfEmpty(tags.genre, id3GenreName(int(be16(bytes(payload))) - 1));
+        else if (std::memcmp(item.type, "\xA9" "day", 4) == 0 && tags.year == 0)
+            tags.year = parseYear(text);
+        else if (std::memcmp(item.type, "trkn", 4) == 0 && payloadSize >= 4 && tags.trackNumber == 0)
+            tags.trackNumber = static_cast<int>(be16(bytes(payload + 2)));
+    }
+}
+
+} // namespace
+
+// ==================== Entry Point ====================
+
+bool TagReader::read(const QString& path, AudioTags& tags)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 fileSize = file.size();
+    uchar magic[12];
+    if (!readAt(file, 0, reinterpret_cast<char*>(magic), sizeof(magic)))
+        return false;
+
+    qint64 audioStart = 0;
+    if (std::memcmp(magic, "ID3", 3) == 0) {
+        readId3v2(file, 0, tags, &audioStart);
+        if (!readAt(file, audioStart, reinterpret_cast<char*>(magic), sizeof(magic)))
+            return !tags.title.isEmpty();
+    }
+
+    bool recognised = false;
+    if (std::memcmp(magic, "fLaC", 4) == 0) {
+        recognised = readFlac(file, audioStart, tags);
+    } else if (std::memcmp(magic, "OggS", 4) == 0) {
+        recognised = readOgg(file, fileSize, tags);
+    } else if (std::memcmp(magic + 4, "ftyp", 4) == 0) {
+        recognised = readMp4(file, fileSize, tags);
+    } else if (std::memcmp(magic, "RIFF", 4) == 0 && std::memcmp(magic + 8, "WAVE", 4) == 0) {
+        recognised = readWav(file, fileSize, tags);
+    } else {
+        // MPEG audio / ADTS; an ID3v1 tag only exists on these
+        qint64 audioEnd = fileSize;
+        char tail[3];
+        if (fileSize >= 128 && readAt(file, fileSize - 128, tail, 3) && std::memcmp(tail, "TAG", 3) == 0)
+            audioEnd -= 128;
+
+        recognised = readMpeg(file, audioStart, audioEnd, tags);
+        readId3v1(file, fileSize, tags);
+    }
+
+    return recognised || !tags.title.isEmpty();
+}
+
+// ==================== ID3 ====================
+
+bool TagReader::readId3v2(QIODevice& device, qint64 offset, AudioTags& tags, qint64* tagEnd)
+{
+    QString tlen;
+    const bool found = walkId3Frames(device, offset, tagEnd, [&](const Id3Frame& frame) {
+        QString* target = nullptr;
+        enum { Text, Genre, Year, TrackNo, Length } kind = Text;
+
+        if (frame.idIs("TT2", "TIT2"))
+            target = &tags.title;
+        else if (frame.idIs("TP1", "TPE1"))
+            target = &tags.artist;
+        else if (frame.idIs("TAL", "TALB"))
+            target = &tags.album;
+        else if (frame.idIs("TCO", "TCON"))
+            kind = Genre;
+        else if (frame.idIs("TYE", "TYER") || (frame.version == 4 && std::memcmp(frame.id, "TDRC", 4) == 0))
+            kind = Year;
+        else if (frame.idIs("TRK", "TRCK"))
+            kind = TrackNo;
+        else if (frame.idIs("TLE", "TLEN"))
+            kind = Length;
+        else
+            return true;
+
+        if (frame.size > kMaxTextFrame)
+            return true;
+
+        const QByteArray body = frame.body();
+        if (body.isEmpty())
+            return true;
+
+        const QString text = decodeId3Text(body.constData(), body.size());
+        switch (kind) {
+        case Text:
+            assignIfEmpty(*target, text);
+            break;
+        case Genre:
+            assignIfEmpty(tags.genre, resolveGenre(text));
+            break;
+        case Year:
+            if (tags.year == 0)
+                tags.year = parseYear(text);
+            break;
+        case TrackNo:
+            if (tags.trackNumber == 0)
+                tags.trackNumber = parseTrackNumber(text);
+            break;
+        case Length:
+            tlen = text;
+            break;
+        }
+        return true;
+    });
+
+    // TLEN is only a hint; frame-accurate durations from the audio stream win
+    if (tags.durationMs == 0 && !tlen.isEmpty())
+        tags.durationMs = tlen.toLongLong();
+
+    return found;
+}
+
+void TagReader::readId3v1(QIODevice& device, qint64 fileSize, AudioTags& tags)
+{
+    if (fileSize < 128)
+        return;
+
+    char tag[128];
+    if (!readAt(device, fileSize - 128, tag, 128) || std::memcmp(tag, "TAG", 3) != 0)
+        return;
+
+    auto field = [&](int offset, int length) {
+        return QString::fromLatin1(tag + offset, nulLength(tag + offset, length)).trimmed();
+    };
+
+    assignIfEmpty(tags.title, field(3, 30));
+    assignIfEmpty(tags.artist, field(33, 30));
+    assignIfEmpty(tags.album, field(63, 30));
+    if (tags.year == 0)
+        tags.year = field(93, 4).toInt();
+    if (tags.trackNumber == 0 && tag[125] == 0 && tag[126] != 0)
+        tags.trackNumber = uchar(tag[126]);
+    assignIfEmpty(tags.genre, id3GenreName(uchar(tag[127])));
+}
+
+// ==================== MPEG / ADTS ====================
+
+bool TagReader::readMpeg(QIODevice& device, qint64 audioStart, qint64 audioEnd, AudioTags& tags)
+{
+    char probe[kMpegProbeSize];
+    if (!device.seek(audioStart))
+        return false;
+
+    const int available = static_cast<int>(device.read(probe, kMpegProbeSize));
+    const uchar* p = bytes(probe);
+
+    for (int i = 0; i + 4 <= available; ++i) {
+        if (p[i] != 0xFF || (p[i + 1] & 0xE0) != 0xE0)
+            continue;
+
+        // Layer bits 00 are reserved for MPEG audio and mark an ADTS stream
+        if ((p[i + 1] & 0x06) == 0 && (p[i + 1] & 0xF0) == 0xF0)
+            return readAdts(device, audioStart + i, audioEnd, tags);
+
+        MpegFrame frame;
+        if (!parseMpegHeader(p + i, frame))
+            continue;
+
+        // Require a second sync word when it falls inside the probe to reject false syncs
+        const int nextFrame = i + frame.frameLength;
+        MpegFrame next;
+        if (nextFrame + 4 <= available && !parseMpegHeader(p + nextFrame, next))
+            continue;
+
+        tags.sampleRate = frame.sampleRate;
+        tags.channels = frame.channels;
+
+        // Xing/Info (VBR and LAME CBR) or VBRI headers carry the exact frame count
+        const int sideInfo = frame.version == 1 ? (frame.channels == 1 ? 17 : 32)
+                                                : (frame.channels == 1 ? 9 : 17);
+        quint32 frameCount = 0;
+        const int xing = i + 4 + sideInfo;
+        const int vbri = i + 4 + 32;
+        if (xing + 12 <= available
+            && (std::memcmp(p + xing, "Xing", 4) == 0 || std::memcmp(p + xing, "Info", 4) == 0)) {
+            if (be32(p + xing + 4) & 0x01)
+                frameCount = be32(p + xing + 8);
+        } else if (vbri + 18 <= available && std::memcmp(p + vbri, "VBRI", 4) == 0) {
+            frameCount = be32(p + vbri + 14);
+        }
+
+        if (frameCount > 0) {
+            tags.durationMs = qint64(frameCount) * frame.samplesPerFrame * 1000 / frame.sampleRate;
+        } else {
+            // Constant bitrate: kbit/s is bits per millisecond
+            const qint64 audioBytes = audioEnd - (audioStart + i);
+            tags.durationMs = audioBytes * 8 / frame.bitrateKbps;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+// ==================== FLAC ====================
+
+bool TagReader::readFlac(QIODevice& device, qint64 offset, AudioTags& tags)
+{
+    qint64 pos = offset + 4;
+    bool haveStreamInfo = false;
+    uchar header[4];
+
+    for (int block = 0; block < 128; ++block) {
+        if (!readAt(device, pos, reinterpret_cast<char*>(header), 4))
+            break;
+
+        const bool last = header[0] & 0x80;
+        const int type = header[0] & 0x7F;
+        const qint64 length = be24(header + 1);
+
+        if (type == 0 && length >= 34) {
+            uchar info[34];
+            if (device.read(reinterpret_cast<char*>(info), 34) == 34) {
+                const int sampleRate = int((quint32(info[10]) << 12) | (quint32(info[11]) << 4) | (info[12] >> 4));
+                const quint64 totalSamples = (quint64(info[13] & 0x0F) << 32) | be32(info + 14);
+                tags.sampleRate = sampleRate;
+                tags.channels = ((info[12] >> 1) & 0x07) + 1;
+                if (sampleRate > 0)
+                    tags.durationMs = static_cast<qint64>(totalSamples * 1000 / quint64(sampleRate));
+                haveStreamInfo = true;
+            }
+        } else if (type == 4 && length <= kMaxCommentBlock) {
+            const QByteArray comments = device.read(length);
+            parseVorbisComments(comments.constData(), comments.size(), tags);
+        }
+
+        pos += 4 + length;
+        if (last)
+            break;
+    }
+
+    return haveStreamInfo;
+}
+
+// ==================== Ogg Vorbis / Opus ====================
+
+bool TagReader::readOgg(QIODevice& device, qint64 fileSize, AudioTags& tags)
+{
+    OggPacketReader reader(device);
+    QByteArray packet;
+
+    if (!reader.next(packet, kMaxTextFrame))
+        return false;
+
+    bool opus = false;
+    int preSkip = 0;
+    int granuleRate = 0;
+
+    if (packet.size() >= 16 && std::memcmp(packet.constData(), "\x01vorbis", 7) == 0) {
+        tags.channels = uchar(packet[11]);
+        tags.sampleRate = static_cast<int>(le32(bytes(packet.constData() + 12)));
+        granuleRate = tags.sampleRate;
+    } else if (packet.size() >= 19 && std::memcmp(packet.constData(), "OpusHead", 8) == 0) {
+        opus = true;
+        tags.channels = uchar(packet[9]);
+        preSkip = static_cast<int>(le16(bytes(packet.constData() + 10)));
+        tags.sampleRate = static_cast<int>(le32(bytes(packet.constData() + 12)));
+        granuleRate = 48000;   // Opus granules always count 48 kHz samples
+    } else {
+        return false;
+    }
+
+    if (reader.next(packet, kMaxCommentBlock)) {
+        if (!opus && packet.size() > 7 && std::memcmp(packet.constData(), "\x03vorbis", 7) == 0)
+            parseVorbisComments(packet.constData() + 7, packet.size() - 7, tags);
+        else if (opus && packet.size() > 8 && std::memcmp(packet.constData(), "OpusTags", 8) == 0)
+            parseVorbisComments(packet.constData() + 8, packet.size() - 8, tags);
+    }
+
+    // Duration comes from the granule position of the stream's last page
+    const qint64 tailSize = std::min(fileSize, kOggTailSize);
+    const QByteArray tail = readBlock(device, fileSize - tailSize, tailSize);
+    const uchar* t = bytes(tail.constData());
+    for (int i = static_cast<int>(tail.size()) - 27; i >= 0; --i) {
+        if (t[i] != 'O' || std::memcmp(t + i, "OggS", 4) != 0)
+            continue;
+        if (le32(t + i + 14) != reader.serial())
+            continue;
+
+        const qint64 granule = static_cast<qint64>(le64(t + i + 6));
+        if (granule > 0 && granuleRate > 0) {
+            tags.durationMs = std::max<qint64>(0, granule - preSkip) * 1000 / granuleRate;
+            break;
+        }
+    }
+
+    return true;
+}
+
+// ==================== MP4 / M4A ====================
+
+bool TagReader::readMp4(QIODevice& device, qint64 fileSize, AudioTags& tags)
+{
+    Mp4Atom moov;
+    if (!findMp4Child(device, 0, fileSize, "moov", moov))
+        return false;
+
+    Mp4Atom mvhd;
+    if (findMp4Child(device, moov.bodyPos, moov.end, "mvhd", mvhd)) {
+        uchar header[32];
+        if (readAt(device, mvhd.bodyPos, reinterpret_cast<char*>(header), 32)) {
+            quint32 timescale = 0;
+            quint64 duration = 0;
+            if (header[0] == 1) {
+                timescale = be32(header + 20);
+                duration = be64(header + 24);
+            } else {
+                timescale = be32(header + 12);
+                duration = be32(header + 16);
+            }
+            if (timescale > 0)
+                tags.durationMs = static_cast<qint64>(duration * 1000 / timescale);
+        }
+    }
+
+    Mp4Atom ilst;
+    if (findMp4Ilst(device, moov, ilst))
+        readMp4Items(device, ilst, tags);
+
+    return true;
+}
+
+// ==================== WAV ====================
+
+bool TagReader::readWav(QIODevice& device, qint64 fileSize, AudioTags& tags)
+{
+    qint64 pos = 12;
+    quint32 byteRate = 0;
+    qint64 dataSize = 0;
+    uchar chunk[8];
+
+    while (pos + 8 <= fileSize) {
+        if (!readAt(device, pos, reinterpret_cast<char*>(chunk), 8))
+            break;
+
+        const qint64 size = le32(chunk + 4);
+        const qint64 bodyPos = pos + 8;
+
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            uchar fmt[16];
+            if (device.read(reinterpret_cast<char*>(fmt), 16) == 16) {
+                tags.channels = static_cast<int>(le16(fmt + 2));
+                tags.sampleRate = static_cast<int>(le32(fmt + 4));
+                byteRate = le32(fmt + 8);
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            // Streamed writers leave 0 or 0xFFFFFFFF here; clamp to the file
+            dataSize = std::min(size, fileSize - bodyPos);
+            if (size == 0)
+                dataSize = fileSize - bodyPos;
+        } else if (std::memcmp(chunk, "LIST", 4) == 0 && size >= 4 && size <= kMaxTextFrame) {
+            const QByteArray list = device.read(size);
+            if (list.size() == size && std::memcmp(list.constData(), "INFO", 4) == 0) {
+                qint64 sub = 4;
+                while (sub + 8 <= list.size()) {
+                    const char* id = list.constData() + sub;
+                    const qint64 length = le32(bytes(id + 4));
+                    if (sub + 8 + length > list.size())
+                        break;
+
+                    const char* value = id + 8;
+                    const QString text = QString::fromUtf8(value, nulLength(value, static_cast<int>(length))).trimmed();
+                    if (std::memcmp(id, "INAM", 4) == 0)
+                        assignIfEmpty(tags.title, text);
+                    else if (std::memcmp(id, "IART", 4) == 0)
+                        assignIfEmpty(tags.artist, text);
+                    else if (std::memcmp(id, "IPRD", 4) == 0)
+                        assignIfEmpty(tags.album, text);
+                    else if (std::memcmp(id, "IGNR", 4) == 0)
+                        assignIfEmpty(tags.genre, text);
+                    else if (std::memcmp(id, "ICRD", 4) == 0 && tags.year == 0)
+                        tags.year = parseYear(text);
+                    else if ((std::memcmp(id, "ITRK", 4) == 0 || std::memcmp(id, "IPRT", 4) == 0)
+                             && tags.trackNumber == 0)
+                        tags.trackNumber = parseTrackNumber(text);
+
+                    sub += 8 + length + (length & 1);
+                }
+            }
+        } else if (std::memcmp(chunk, "id3 ", 4) == 0 || std::memcmp(chunk, "ID3 ", 4) == 0) {
+            readId3v2(device, bodyPos, tags, nullptr);
+        }
+
+        pos = bodyPos + size + (size & 1);
+    }
+
+    if (byteRate > 0)
+        tags.durationMs = dataSize * 1000 / byteRate;
+
+    return byteRate > 0;
+}
+
+// ==================== Cover Art ====================
+
+QByteArray TagReader::readCover(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    const qint64 fileSize = file.size();
+    uchar magic[12];
+    if (!readAt(file, 0, reinterpret_cast<char*>(magic), sizeof(magic)))
+        return QByteArray();
+
+    qint64 audioStart = 0;
+    if (std::memcmp(magic, "ID3", 3) == 0) {
+        QByteArray picture = readId3Picture(file, 0, &audioStart);
+        if (!picture.isEmpty())
+            return picture;
+        if (!readAt(file, audioStart, reinterpret_cast<char*>(magic), sizeof(magic)))
+            return QByteArray();
+    }
+
+    if (std::memcmp(magic, "fLaC", 4) == 0)
+        return readFlacPicture(file, audioStart);
+    if (std::memcmp(magic + 4, "ftyp", 4) == 0)
+        return readMp4Cover(file, fileSize);
+
+    return QByteArray();
+}
+
+QByteArray TagReader::readId3Picture(QIODevice& device, qint64 offset, qint64* tagEnd)
+{
+    QByteArray front;
+    QByteArray fallback;
+    walkId3Frames(device, offset, tagEnd, [&](const Id3Frame& frame) {
+        if (!frame.idIs("PIC", "APIC") || frame.size > kMaxPicture)
+            return true;
+
+        const QByteArray body = frame.body();
+
+        // encoding, MIME type (v2.2: 3-char format), picture type, description, data
+        const char* data = body.constData();
+        const int bodySize = body.size();
+        if (bodySize < 2)
+            return true;
+
+        int p = 0;
+
+        const uchar encoding = uchar(data[p++]);
+        if (frame.version == 2)
+            p += 3;
+        else
+            p += nulLength(data + p, bodySize - p) + 1;
+        if (p >= bodySize)
+            return true;
+
+        const int pictureType = uchar(data[p++]);
+
+        if (encoding == 1 || encoding == 2) {
+            while (p + 1 < bodySize && (data[p] != 0 || data[p + 1] != 0))
+                p += 2;
+            p += 2;
+        } else {
+            p += nulLength(data + p, bodySize - p) + 1;
+        }
+        if (p >= bodySize)
+            return true;
+
+        if (pictureType == kFrontCover) {
+            front = body.mid(p);
+            return false;
+        }
+        if (fallback.isEmpty())
+            fallback = body.mid(p);
+        return true;
+    });
+
+    return front.isEmpty() ? fallback : front;
+}
+
+QByteArray TagReader::readFlacPicture(QIODevice& device, qint64 offset)
+{
+    qint64 pos = offset + 4;
+    uchar header[4];
+    QByteArray fallback;
+
+    for (int block = 0; block < 128; ++block) {
+        if (!readAt(device, pos, reinterpret_cast<char*>(header), 4))
+            break;
+
+        const bool last = header[0] & 0x80;
+        const int type = header[0] & 0x7F;
+        const qint64 length = be24(header + 1);
+
+        // PICTURE: type, MIME, description, geometry, then the image data
+        if (type == 6 && length >= 32 && length <= kMaxPicture) {
+            const QByteArray picture = device.read(length);
+            const uchar* b = bytes(picture.constData());
+            const qint64 size = picture.size();
+
+            qint64 p = 4;
+            if (p + 4 <= size)
+                p += 4 + be32(b + p);                       // MIME type
+            if (p + 4 <= size)
+                p += 4 + be32(b + p);                       // description
+            p += 16;                                        // width, height, depth, colours
+
+            if (p + 4 <= size) {
+                const qint64 dataSize = be32(b + p);
+                p += 4;
+                if (dataSize > 0 && p + dataSize <= size) {
+                    if (int(be32(b)) == kFrontCover)
+                        return picture.mid(static_cast<int>(p), static_cast<int>(dataSize));
+                    if (fallback.isEmpty())
+                        fallback = picture.mid(static_cast<int>(p), static_cast<int>(dataSize));
+                }
+            }
+        }
+
+        pos += 4 + length;
+        if (last)
+            break;
+    }
+
+    return fallback;
+}
+
+QByteArray TagReader::readMp4Cover(QIODevice& device, qint64 fileSize)
+{
+    Mp4Atom moov;
+    Mp4Atom ilst;
+    Mp4Atom covr;
+    Mp4Atom data;
+    if (!findMp4Child(device, 0, fileSize, "moov", moov)
+        || !findMp4Ilst(device, moov, ilst)
+        || !findMp4Child(device, ilst.bodyPos, ilst.end, "covr", covr)
+        || !findMp4Child(device, covr.bodyPos, covr.end, "data", data)) {
+        return QByteArray();
+    }
+
+    // data: 4-byte type, 4-byte locale, then the JPEG/PNG bytes
+    const qint64 payloadSize = data.end - data.bodyPos - 8;
+    if (payloadSize <= 0 || payloadSize > kMaxPicture)
+        return QByteArray();
+
+    return readBlock(device, data.bodyPos + 8, payloadSize);
+}
@@ -0,0 +1,51 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+
+// Metadata extracted from a file's headers and tags
+struct AudioTags {
+    QString title;
+    QString artist;
+    QString album;
+    QString genre;
+    int year = 0;
+    int trackNumber = 0;
+    qint64 durationMs = 0;
+    int sampleRate = 0;
+    int channels = 0;
+};
+
+// In-process tag/header parser.
+// Reads only the header bytes it needs (ID3v2/ID3v1 + MPEG frame headers,
+// FLAC STREAMINFO/VORBIS_COMMENT, Ogg Vorbis/Opus headers, MP4 moov atoms,
+// WAV RIFF chunks) and keeps no shared state, so it is safe to call
+// concurrently from scanner worker threads.
+class TagReader
+{
+public:
+    // Returns false when the file cannot be opened or nothing was recognised
+    static bool read(const QString& path, AudioTags& tags);
+
+    // Encoded bytes of the embedded cover (ID3v2 APIC/PIC, FLAC PICTURE,
+    // MP4 covr), preferring the front cover; empty if there is none
+    static QByteArray readCover(const QString& path);
+
+private:
+    static bool readId3v2(QIODevice& device, qint64 offset, AudioTags& tags, qint64* tagEnd);
+    static void readId3v1(QIODevice& device, qint64 fileSize, AudioTags& tags);
+    static bool readMpeg(QIODevice& device, qint64 audioStart, qint64 audioEnd, AudioTags& tags);
+    static bool readFlac(QIODevice& device, qint64 offset, AudioTags& tags);
+    static bool readOgg(QIODevice& device, qint64 fileSize, AudioTags& tags);
+    static bool readMp4(QIODevice& device, qint64 fileSize, AudioTags& tags);
+    static bool readWav(QIODevice& device, qint64 fileSize, AudioTags& tags);
+
+    static QByteArray readId3Picture(QIODevice& device, qint64 offset, qint64* tagEnd);
+    static QByteArray readFlacPicture(QIODevice& device, qint64 offset);
+    static QByteArray readMp4Cover(QIODevice& device, qint64 fileSize);
+};
+
+#endif // TAGREADER_H
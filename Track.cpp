@@ -1,17 +1,15 @@
 #include "Track.h"
+#include "TagReader.h"
+#include <QDebug>
 #include <QFileInfo>
-#include <QMediaPlayer>
-#include <QAudioOutput>
-#include <QEventLoop>
-#include <QTimer>
 
 // ==================== CONSTRUCTORS ====================
 Track::Track()
     : m_path("")
     , m_title("Unknown")
-    , m_artist("Unknown Artist")
-    , m_album("Unknown Album")
-    , m_genre("Unknown Genre")
+    , m_artist(unknownArtist())
+    , m_album(unknownAlbum())
+    , m_genre(unknownGenre())
     , m_year(0)
     , m_duration(0)
     , m_playCount(0)
@@ -20,7 +18,9 @@ Track::Track()
 
 Track::Track(const QString& path)
     : m_path(path)
-    , m_genre("Unknown Genre")
+    , m_artist(StringPool::EmptySymbol)
+    , m_album(StringPool::EmptySymbol)
+    , m_genre(unknownGenre())
     , m_year(0)
     , m_playCount(0)
 {
@@ -30,9 +30,9 @@ Track::Track(const QString& path)
 Track::Track(const QString& path, const QString& title, const QString& artist)
     : m_path(path)
     , m_title(title)
-    , m_artist(artist)
-    , m_album("Unknown Album")
-    , m_genre("Unknown Genre")
+    , m_artist(StringPool::instance().intern(artist))
+    , m_album(unknownAlbum())
+    , m_genre(unknownGenre())
     , m_year(0)
     , m_duration(0)
     , m_playCount(0)
@@ -45,6 +45,24 @@ Track::~Track()
 }
 
 // ==================== STATIC FUNCTIONS ====================
+StringPool::Symbol Track::unknownArtist()
+{
+    static const StringPool::Symbol symbol = StringPool::instance().intern("Unknown Artist");
+    return symbol;
+}
+
+StringPool::Symbol Track::unknownAlbum()
+{
+    static const StringPool::Symbol symbol = StringPool::instance().intern("Unknown Album");
+    return symbol;
+}
+
+StringPool::Symbol Track::unknownGenre()
+{
+    static const StringPool::Symbol symbol = StringPool::instance().intern("Unknown Genre");
+    return symbol;
+}
+
 bool Track::isValidAudioFile(const QString& path)
 {
     QStringList validExtensions = {"mp3", "flac", "ogg", "wav", "m4a", "aac", "wma"};
@@ -104,55 +122,32 @@ void Track::loadMetadata()
     if (!fileInfo.exists()) {
         qWarning() << "File does not exist:" << m_path;
         m_title = "Unknown";
-        m_artist = "Unknown Artist";
-        m_album = "Unknown Album";
-        m_genre = "Unknown Genre";
+        m_artist = unknownArtist();
+        m_album = unknownAlbum();
+        m_genre = unknownGenre();
         m_year = 0;
         return;
     }
 
     // Use filename as title if no metadata available
     m_title = fileInfo.baseName();
-    m_artist = "Unknown Artist";
-    m_album = "Unknown Album";
-    m_genre = "Unknown Genre";
+    m_artist = unknownArtist();
+    m_album = unknownAlbum();
+    m_genre = unknownGenre();
     m_year = 0;
 
-    // Try to get duration using QMediaPlayer
-    QMediaPlayer tempPlayer;
-    QAudioOutput tempOutput;
-    tempPlayer.setAudioOutput(&tempOutput);
-
-    QEventLoop loop;
-    QTimer timeoutTimer;
-    timeoutTimer.setSingleShot(true);
-    timeoutTimer.setInterval(2000); // 2 second timeout
-
-    bool durationLoaded = false;
-
-    QObject::connect(&tempPlayer, &QMediaPlayer::durationChanged, [&](qint64 duration) {
-        if (duration > 0) {
-            m_duration = duration;
-            durationLoaded = true;
-            loop.quit();
-        }
-    });
-
-    QObject::connect(&timeoutTimer, &QTimer::timeout, [&]() {
-        loop.quit();
-    });
-
-    tempPlayer.setSource(QUrl::fromLocalFile(m_path));
-    timeoutTimer.start();
-
-    // Wait for duration or timeout
-    if (!durationLoaded) {
-        loop.exec();
+    // Header/tag parse only; no decoder or event loop, so this is safe on scanner threads
+    AudioTags tags;
+    if (!TagReader::read(m_path, tags)) {
+        qDebug() << "Could not read metadata for:" << m_path;
+        return;
     }
 
-    if (m_duration == 0) {
-        qDebug() << "Could not determine duration for:" << m_path;
-    } else {
-        qDebug() << "Loaded metadata for:" << m_title << "Duration:" << formatDuration(m_duration);
-    }
+    if (!tags.title.isEmpty()) m_title = tags.title;
+    if (!tags.artist.isEmpty()) setArtist(tags.artist);
+    if (!tags.album.isEmpty()) setAlbum(tags.album);
+    if (!tags.genre.isEmpty()) setGenre(tags.genre);
+    m_year = tags.year;
+    m_trackNumber = tags.trackNumber;
+    m_duration = tags.durationMs;
 }
@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QDateTime>
+#include "StringPool.h"
 
 class Track
 {
@@ -23,21 +24,35 @@ public:
     // Getters
     QString path() const { return m_path; }
     QString title() const { return m_title; }
-    QString artist() const { return m_artist; }
-    QString album() const { return m_album; }
-    QString genre() const { return m_genre; }
+    QString artist() const { return StringPool::instance().string(m_artist); }
+    QString album() const { return StringPool::instance().string(m_album); }
+    QString genre() const { return StringPool::instance().string(m_genre); }
     int year() const { return m_year; }
+    int trackNumber() const { return m_trackNumber; }
     qint64 duration() const { return m_duration; }
     int playCount() const { return m_playCount; }
     QDateTime lastPlayed() const { return m_lastPlayed; }
 
+    // Interned handles; compare these instead of the strings when grouping
+    StringPool::Symbol artistId() const { return m_artist; }
+    StringPool::Symbol albumId() const { return m_album; }
+    StringPool::Symbol genreId() const { return m_genre; }
+
+    // Symbols of the placeholder values, interned once
+    static StringPool::Symbol unknownArtist();
+    static StringPool::Symbol unknownAlbum();
+    static StringPool::Symbol unknownGenre();
+
     // Setters
     void setTitle(const QString& title) { m_title = title; }
-    void setArtist(const QString& artist) { m_artist = artist; }
-    void setAlbum(const QString& album) { m_album = album; }
-    void setGenre(const QString& genre) { m_genre = genre; }
+    void setArtist(const QString& artist) { m_artist = StringPool::instance().intern(artist); }
+    void setAlbum(const QString& album) { m_album = StringPool::instance().intern(album); }
+    void setGenre(const QString& genre) { m_genre = StringPool::instance().intern(genre); }
     void setYear(int year) { m_year = year; }
+    void setTrackNumber(int trackNumber) { m_trackNumber = trackNumber; }
     void setDuration(qint64 durationMs) { m_duration = durationMs; }
+    void setPlayCount(int playCount) { m_playCount = playCount; }
+    void setLastPlayed(const QDateTime& lastPlayed) { m_lastPlayed = lastPlayed; }
 
     // Methods
     void incrementPlayCount();
@@ -46,10 +61,11 @@ public:
 private:
     QString m_path;
     QString m_title;
-    QString m_artist;
-    QString m_album;
-    QString m_genre;
+    StringPool::Symbol m_artist;
+    StringPool::Symbol m_album;
+    StringPool::Symbol m_genre;
     int m_year = 0;
+    int m_trackNumber = 0;
     qint64 m_duration = 0;
     int m_playCount = 0;
     QDateTime m_lastPlayed;
@@ -0,0 +1,698 @@
+#include "TrackFilter.h"
+#include <QDateTime>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <limits>
+
+// ==================== FilterIndex ====================
+
+StringPool::Symbol FilterIndex::foldedValue(Key key, const Track& track)
+{
+    const StringPool& pool = StringPool::instance();
+    switch (key) {
+    case Artist:
+        return pool.folded(track.artistId());
+    case Album:
+        return pool.folded(track.albumId());
+    default:
+        return pool.folded(track.genreId());
+    }
+}
+
+void FilterIndex::erase(std::vector<int>& ids, int slot)
+{
+    auto it = std::find(ids.begin(), ids.end(), slot);
+    if (it != ids.end()) {
+        *it = ids.back();
+        ids.pop_back();
+    }
+}
+
+void FilterIndex::add(int slot, const Track& track)
+{
+    for (int k = 0; k < KeyCount; ++k) {
+        m_symbols[k][foldedValue(static_cast<Key>(k), track)].push_back(slot);
+    }
+    m_years[track.year()].push_back(slot);
+}
+
+void FilterIndex::remove(int slot, const Track& track)
+{
+    for (int k = 0; k < KeyCount; ++k) {
+        auto it = m_symbols[k].find(foldedValue(static_cast<Key>(k), track));
+        if (it == m_symbols[k].end())
+            continue;
+        erase(it.value(), slot);
+        if (it.value().empty())
+            m_symbols[k].erase(it);
+    }
+
+    auto year = m_years.find(track.year());
+    if (year != m_years.end()) {
+        erase(year.value(), slot);
+        if (year.value().empty())
+            m_years.erase(year);
+    }
+}
+
+void FilterIndex::clear()
+{
+    for (int k = 0; k < KeyCount; ++k) {
+        m_symbols[k].clear();
+    }
+    m_years.clear();
+}
+
+const std::vector<int>* FilterIndex::lookup(Key key, StringPool::Symbol folded) const
+{
+    auto it = m_symbols[key].constFind(folded);
+    return it != m_symbols[key].cend() ? &it.value() : nullptr;
+}
+
+// ==================== Plan ====================
+
+struct TrackFilter::Node {
+    enum Kind {
+        And,
+        Or,
+        Not,
+        Symbol,     // indexed: folded artist/album/genre equals symbol
+        Range,      // numeric field within [low, high]; year is indexed
+        Text        // residual: substring of title, or of any text field
+    };
+
+    enum Field {
+        Artist,
+        Album,
+        Genre,
+        Title,
+        AnyText,
+        Year,
+        PlayCount,
+        Duration,       // seconds
+        TrackNumber,
+        LastPlayed      // seconds since epoch, or age in seconds if relative
+    };
+
+    Kind kind = And;
+    Field field = AnyText;
+    StringPool::Symbol symbol = StringPool::NoSymbol;
+    qint64 low = std::numeric_limits<qint64>::min();
+    qint64 high = std::numeric_limits<qint64>::max();
+    bool relative = false;
+    QString text;
+    std::vector<Node> children;
+
+    bool indexed() const
+    {
+        switch (kind) {
+        case Symbol:
+            return true;
+        case Range:
+            return field == Year;
+        case Not:
+            return children.front().indexed();
+        default:
+            return std::all_of(children.begin(), children.end(), [](const Node& child) { return child.indexed(); });
+        }
+    }
+};
+
+namespace {
+
+using Node = TrackFilter::Node;
+using Bits = std::vector<quint64>;
+
+// ==================== Parser ====================
+
+struct Token {
+    enum Type {
+        Word,
+        Open,
+        Close,
+        And,
+        Or,
+        Not,
+        End
+    };
+
+    Type type = End;
+    QString text;
+    int position = 0;
+};
+
+std::vector<Token> tokenize(const QString& input)
+{
+    std::vector<Token> tokens;
+    int i = 0;
+    const int length = input.size();
+
+    while (i < length) {
+        const QChar c = input[i];
+        if (c.isSpace()) {
+            ++i;
+            continue;
+        }
+
+        Token token;
+        token.position = i;
+
+        if (c == '(' || c == ')') {
+            token.type = c == '(' ? Token::Open : Token::Close;
+            tokens.push_back(token);
+            ++i;
+            continue;
+        }
+
+        if (c == '-' && i + 1 < length && !input[i + 1].isSpace()) {
+            token.type = Token::Not;
+            tokens.push_back(token);
+            ++i;
+            continue;
+        }
+
+        // A word runs to whitespace or a parenthesis; quotes may span both
+        bool quoted = false;
+        while (i < length) {
+            const QChar ch = input[i];
+            if (ch == '"') {
+                quoted = true;
+                const int close = input.indexOf('"', i + 1);
+                const int end = close < 0 ? length : close;
+                token.text += input.mid(i + 1, end - i - 1);
+                i = end + 1;
+                continue;
+            }
+            if (ch.isSpace() || ch == '(' || ch == ')')
+                break;
+            token.text += ch;
+            ++i;
+        }
+
+        token.type = Token::Word;
+        if (!quoted && token.text == QLatin1String("AND"))
+            token.type = Token::And;
+        else if (!quoted && token.text == QLatin1String("OR"))
+            token.type = Token::Or;
+        else if (!quoted && token.text == QLatin1String("NOT"))
+            token.type = Token::Not;
+
+        tokens.push_back(token);
+    }
+
+    Token end;
+    end.position = length;
+    tokens.push_back(end);
+    return tokens;
+}
+
+class Parser
+{
+public:
+    explicit Parser(const QString& input)
+        : m_tokens(tokenize(input))
+    {
+    }
+
+    bool parse(Node& root, QString* error)
+    {
+        root = parseOr();
+        if (m_error.isEmpty() && peek().type != Token::End)
+            fail(QStringLiteral("unexpected ')'"));
+
+        if (!m_error.isEmpty()) {
+            *error = m_error;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr qint64 kMin = std::numeric_limits<qint64>::min();
+    static constexpr qint64 kMax = std::numeric_limits<qint64>::max();
+
+    const Token& peek() const { return m_tokens[m_next]; }
+    const Token& take() { return m_tokens[m_next < m_tokens.size() - 1 ? m_next++ : m_next]; }
+
+    void fail(const QString& message)
+    {
+        if (m_error.isEmpty())
+            m_error = QStringLiteral("%1 at position %2").arg(message).arg(peek().position + 1);
+    }
+
+    static Node combine(Node::Kind kind, std::vector<Node> children)
+    {
+        if (children.size() == 1)
+            return std::move(children.front());
+
+        Node node;
+        node.kind = kind;
+        node.children = std::move(children);
+        return node;
+    }
+
+    Node parseOr()
+    {
+        std::vector<Node> children;
+        children.push_back(parseAnd());
+        while (m_error.isEmpty() && peek().type == Token::Or) {
+            take();
+            children.push_back(parseAnd());
+        }
+        return combine(Node::Or, std::move(children));
+    }
+
+    Node parseAnd()
+    {
+        std::vector<Node> children;
+        children.push_back(parseUnary());
+        while (m_error.isEmpty()) {
+            const Token::Type type = peek().type;
+            if (type == Token::And) {
+                take();
+            } else if (type != Token::Word && type != Token::Open && type != Token::Not) {
+                break;
+            }
+            children.push_back(parseUnary());
+        }
+        return combine(Node::And, std::move(children));
+    }
+
+    Node parseUnary()
+    {
+        if (peek().type == Token::Not) {
+            take();
+            Node node;
+            node.kind = Node::Not;
+            node.children.push_back(parseUnary());
+            return node;
+        }
+
+        if (peek().type == Token::Open) {
+            take();
+            Node node = parseOr();
+            if (m_error.isEmpty() && take().type != Token::Close)
+                fail(QStringLiteral("missing ')'"));
+            return node;
+        }
+
+        if (peek().type != Token::Word) {
+            fail(QStringLiteral("expected a term"));
+            return Node();
+        }
+
+        return parseTerm(take().text);
+    }
+
+    Node parseTerm(const QString& word)
+    {
+        Node node;
+        const int colon = word.indexOf(':');
+        if (colon <= 0) {
+            node.kind = Node::Text;
+            node.field = Node::AnyText;
+            node.text = word;
+            return node;
+        }
+
+        static const struct {
+            const char* name;
+            Node::Field field;
+        } fields[] = {
+            {"artist", Node::Artist},
+            {"album", Node::Album},
+            {"genre", Node::Genre},
+            {"title", Node::Title},
+            {"year", Node::Year},
+            {"playcount", Node::PlayCount},
+            {"plays", Node::PlayCount},
+            {"duration", Node::Duration},
+            {"length", Node::Duration},
+            {"track", Node::TrackNumber},
+            {"tracknumber", Node::TrackNumber},
+            {"lastplayed", Node::LastPlayed},
+            {"played", Node::LastPlayed},
+        };
+
+        const QString name = word.left(colon);
+        const QString value = word.mid(colon + 1);
+
+        const auto it = std::find_if(std::begin(fields), std::end(fields), [&name](const auto& entry) {
+            return name.compare(QLatin1String(entry.name), Qt::CaseInsensitive) == 0;
+        });
+        if (it == std::end(fields)) {
+            fail(QStringLiteral("unknown field '%1'").arg(name));
+            return node;
+        }
+
+        node.field = it->field;
+        switch (node.field) {
+        case Node::Artist:
+        case Node::Album:
+        case Node::Genre:
+            // Interned so the symbol also matches tracks scanned later
+            node.kind = Node::Symbol;
+            node.symbol = StringPool::instance().intern(value.trimmed().toCaseFolded());
+            return node;
+        case Node::Title:
+            node.kind = Node::Text;
+            node.text = value;
+            return node;
+        default:
+            node.kind = Node::Range;
+            parseRange(node, value);
+            return node;
+        }
+    }
+
+    // The interval one value stands for: a single number, a whole day for
+    // a date, or an age for a relative time
+    bool parseBound(Node& node, const QString& text, qint64* low, qint64* high, bool* relative)
+    {
+        bool ok = false;
+        *relative = false;
+
+        if (node.field == Node::Duration && text.contains(':')) {
+            qint64 seconds = 0;
+            for (const QString& part : text.split(':')) {
+                const qint64 component = part.toLongLong(&ok);
+                if (!ok)
+                    break;
+                seconds = seconds * 60 + component;
+            }
+            *low = *high = seconds;
+        } else if (node.field == Node::LastPlayed) {
+            static const struct {
+                QChar unit;
+                qint64 seconds;
+            } units[] = {
+                {'h', 3600}, {'d', 86400}, {'w', 7 * 86400}, {'m', 30 * 86400}, {'y', 365 * 86400},
+            };
+
+            const QDate date = QDate::fromString(text, Qt::ISODate);
+            if (date.isValid()) {
+                ok = true;
+                *low = date.startOfDay().toSecsSinceEpoch();
+                *high = date.addDays(1).startOfDay().toSecsSinceEpoch() - 1;
+            } else {
+                for (const auto& unit : units) {
+                    if (text.endsWith(unit.unit, Qt::CaseInsensitive)) {
+                        *low = *high = text.chopped(1).toLongLong(&ok) * unit.seconds;
+                        *relative = true;
+                        break;
+                    }
+                }
+            }
+        } else {
+            *low = *high = text.toLongLong(&ok);
+        }
+
+        if (!ok)
+            fail(QStringLiteral("invalid value '%1'").arg(text));
+        return ok;
+    }
+
+    void parseRange(Node& node, const QString& value)
+    {
+        qint64 low = 0;
+        qint64 high = 0;
+        bool relative = false;
+
+        const int dots = value.indexOf(QLatin1String(".."));
+        if (dots >= 0) {
+            const QString from = value.left(dots);
+            const QString to = value.mid(dots + 2);
+            bool relativeTo = false;
+            if (!from.isEmpty() && !parseBound(node, from, &node.low, &high, &relative))
+                return;
+            if (!to.isEmpty() && !parseBound(node, to, &low, &node.high, &relativeTo))
+                return;
+            if (!from.isEmpty() && !to.isEmpty() && relative != relativeTo) {
+                fail(QStringLiteral("cannot mix dates and ages in '%1'").arg(value));
+                return;
+            }
+            node.relative = relative || relativeTo;
+            return;
+        }
+
+        static const char* const operators[] = {">=", "<=", ">", "<", "="};
+        QString op;
+        for (const char* candidate : operators) {
+            if (value.startsWith(QLatin1String(candidate))) {
+                op = QLatin1String(candidate);
+                break;
+            }
+        }
+
+        if (!parseBound(node, value.mid(op.size()), &low, &high, &relative))
+            return;
+
+        node.relative = relative;
+        if (op == QLatin1String(">"))
+            node.low = high < kMax ? high + 1 : kMax;
+        else if (op == QLatin1String(">="))
+            node.low = low;
+        else if (op == QLatin1String("<"))
+            node.high = low > kMin ? low - 1 : kMin;
+        else if (op == QLatin1String("<="))
+            node.high = high;
+        else if (relative && op.isEmpty())
+            node.high = high;       // "lastplayed:30d" means within the last 30 days
+        else {
+            node.low = low;
+            node.high = high;
+        }
+    }
+
+    std::vector<Token> m_tokens;
+    size_t m_next = 0;
+    QString m_error;
+};
+
+// ==================== Evaluation ====================
+
+struct Context {
+    const std::vector<Track>* tracks = nullptr;
+    const FilterIndex* index = nullptr;
+    qint64 now = 0;
+};
+
+qint64 fieldValue(Node::Field field, const Track& track, bool* known)
+{
+    *known = true;
+    switch (field) {
+    case Node::Year:
+        return track.year();
+    case Node::PlayCount:
+        return track.playCount();
+    case Node::Duration:
+        return static_cast<qint64>(track.duration()) / 1000;
+    case Node::TrackNumber:
+        return track.trackNumber();
+    default:
+        *known = track.lastPlayed().isValid();
+        return *known ? track.lastPlayed().toSecsSinceEpoch() : 0;
+    }
+}
+
+bool test(const Node& node, const Track& track, qint64 now)
+{
+    switch (node.kind) {
+    case Node::And:
+        return std::all_of(node.children.begin(), node.children.end(),
+                           [&](const Node& child) { return test(child, track, now); });
+    case Node::Or:
+        return std::any_of(node.children.begin(), node.children.end(),
+                           [&](const Node& child) { return test(child, track, now); });
+    case Node::Not:
+        return !test(node.children.front(), track, now);
+    case Node::Symbol: {
+        const StringPool& pool = StringPool::instance();
+        const StringPool::Symbol value = node.field == Node::Artist ? track.artistId()
+                                       : node.field == Node::Album  ? track.albumId()
+                                                                    : track.genreId();
+        return pool.folded(value) == node.symbol;
+    }
+    case Node::Range: {
+        bool known = false;
+        qint64 value = fieldValue(node.field, track, &known);
+        if (!known)
+            return false;
+        if (node.relative)
+            value = now - value;
+        return value >= node.low && value <= node.high;
+    }
+    case Node::Text:
+        if (node.field == Node::Title)
+            return track.title().contains(node.text, Qt::CaseInsensitive);
+        return track.title().contains(node.text, Qt::CaseInsensitive)
+            || track.artist().contains(node.text, Qt::CaseInsensitive)
+            || track.album().contains(node.text, Qt::CaseInsensitive)
+            || track.genre().contains(node.text, Qt::CaseInsensitive);
+    }
+    return false;
+}
+
+inline void setBit(Bits& bits, int slot)
+{
+    bits[slot >> 6] |= quint64(1) << (slot & 63);
+}
+
+void andBits(Bits& bits, const Bits& other)
+{
+    for (size_t w = 0; w < bits.size(); ++w) {
+        bits[w] &= other[w];
+    }
+}
+
+bool isEmpty(const Bits& bits)
+{
+    return std::all_of(bits.begin(), bits.end(), [](quint64 word) { return word == 0; });
+}
+
+template <typename Function>
+void forEachBit(const Bits& bits, Function&& function)
+{
+    for (size_t w = 0; w < bits.size(); ++w) {
+        quint64 word = bits[w];
+        while (word) {
+            const int bit = qCountTrailingZeroBits(word);
+            function(static_cast<int>(w * 64 + bit));
+            word &= word - 1;
+        }
+    }
+}
+
+// Slots of within that match node
+Bits evaluate(const Node& node, const Context& context, const Bits& within)
+{
+    Bits result(within.size(), 0);
+
+    switch (node.kind) {
+    case Node::And: {
+        // Cheap indexed children first; residual ones only see what is left
+        std::vector<const Node*> order;
+        for (const Node& child : node.children) {
+            order.push_back(&child);
+        }
+        std::stable_partition(order.begin(), order.end(), [](const Node* child) { return child->indexed(); });
+
+        result = within;
+        for (const Node* child : order) {
+            if (isEmpty(result))
+                break;
+            result = evaluate(*child, context, result);
+        }
+        return result;
+    }
+    case Node::Or: {
+        Bits remaining = within;
+        for (const Node& child : node.children) {
+            const Bits matched = evaluate(child, context, remaining);
+            for (size_t w = 0; w < result.size(); ++w) {
+                result[w] |= matched[w];
+                remaining[w] &= ~matched[w];
+            }
+        }
+        return result;
+    }
+    case Node::Not: {
+        const Bits matched = evaluate(node.children.front(), context, within);
+        for (size_t w = 0; w < result.size(); ++w) {
+            result[w] = within[w] & ~matched[w];
+        }
+        return result;
+    }
+    case Node::Symbol: {
+        const FilterIndex::Key key = node.field == Node::Artist ? FilterIndex::Artist
+                                   : node.field == Node::Album  ? FilterIndex::Album
+                                                                : FilterIndex::Genre;
+        if (const std::vector<int>* hits = context.index->lookup(key, node.symbol)) {
+            for (int slot : *hits) {
+                if (slot < static_cast<int>(within.size() * 64))
+                    setBit(result, slot);
+            }
+        }
+        andBits(result, within);
+        return result;
+    }
+    case Node::Range:
+        if (node.field == Node::Year) {
+            const QMap<int, std::vector<int>>& years = context.index->years();
+            const qint64 low = std::clamp<qint64>(node.low, std::numeric_limits<int>::min(),
+                                                  std::numeric_limits<int>::max());
+            for (auto it = years.lowerBound(static_cast<int>(low)); it != years.end() && it.key() <= node.high; ++it) {
+                for (int slot : it.value()) {
+                    if (slot < static_cast<int>(within.size() * 64))
+                        setBit(result, slot);
+                }
+            }
+            andBits(result, within);
+            return result;
+        }
+        break;
+    default:
+        break;
+    }
+
+    // Residual term: check the candidates one by one
+    forEachBit(within, [&](int slot) {
+        if (test(node, (*context.tracks)[slot], context.now))
+            setBit(result, slot);
+    });
+    return result;
+}
+
+} // namespace
+
+// ==================== TrackFilter ====================
+
+TrackFilter::TrackFilter(const QString& text)
+    : m_name(text)
+{
+    // Sidebar names; the grouped views show every track
+    QString expression = text.trimmed();
+    if (expression == "All Tracks" || expression == "Artists" || expression == "Albums" || expression == "Genres")
+        expression.clear();
+    else if (expression == "Favorites")
+        expression = "playcount:>=5";
+    else if (expression == "Recently Played")
+        expression = "lastplayed:<=7d";
+
+    if (expression.isEmpty())
+        return;
+
+    auto root = std::make_shared<Node>();
+    Parser parser(expression);
+    if (parser.parse(*root, &m_error))
+        m_root = root;
+}
+
+bool TrackFilter::matches(const Track& track) const
+{
+    if (!m_root)
+        return true;
+
+    return test(*m_root, track, QDateTime::currentSecsSinceEpoch());
+}
+
+std::vector<int> TrackFilter::select(const std::vector<Track>& tracks, const FilterIndex& index,
+                                     const std::vector<int>& candidates) const
+{
+    if (!m_root)
+        return candidates;
+
+    Bits within((tracks.size() + 63) / 64, 0);
+    for (int slot : candidates) {
+        setBit(within, slot);
+    }
+
+    Context context;
+    context.tracks = &tracks;
+    context.index = &index;
+    context.now = QDateTime::currentSecsSinceEpoch();
+
+    std::vector<int> selected;
+    forEachBit(evaluate(*m_root, context, within), [&selected](int slot) { selected.push_back(slot); });
+    return selected;
+}
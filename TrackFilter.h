@@ -0,0 +1,87 @@
+#ifndef TRACKFILTER_H
+#define TRACKFILTER_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <memory>
+#include <vector>
+#include "Track.h"
+
+// Secondary indices answering filter terms without visiting every track:
+// slots by case-folded artist, album and genre symbol, and slots by year.
+// The store owner keeps it in step with the store (remove() takes the track
+// as it was). Copies share their data until one of them is modified, so a
+// query snapshot can take one cheaply.
+class FilterIndex
+{
+public:
+    enum Key {
+        Artist,
+        Album,
+        Genre,
+        KeyCount
+    };
+
+    void add(int slot, const Track& track);
+    void remove(int slot, const Track& track);
+    void clear();
+
+    // Unordered slots; null when no track has the value
+    const std::vector<int>* lookup(Key key, StringPool::Symbol folded) const;
+    const QMap<int, std::vector<int>>& years() const { return m_years; }
+
+private:
+    static StringPool::Symbol foldedValue(Key key, const Track& track);
+    static void erase(std::vector<int>& ids, int slot);
+
+    QHash<StringPool::Symbol, std::vector<int>> m_symbols[KeyCount];
+    QMap<int, std::vector<int>> m_years;
+};
+
+// Filter expression set from the library view, parsed once into a plan.
+//
+//   artist:"Daft Punk" year:1995..2005 -genre:house
+//   (genre:jazz OR genre:blues) AND playcount:>10
+//   lastplayed:<30d          played in the last 30 days
+//
+// Terms are field:value; numeric fields (year, playcount, duration,
+// track, lastplayed) take =, <, <=, >, >= and lo..hi ranges, either end
+// optional. Durations are seconds or m:ss, lastplayed takes an age
+// (h, d, w, m, y) or a yyyy-MM-dd date. artist, album and genre match the
+// whole value ignoring case; title and bare words match substrings.
+// Terms side by side are ANDed; OR, NOT (or a leading -) and parentheses
+// combine them. The sidebar names ("All Tracks", "Favorites", ...) are
+// accepted as before.
+//
+// select() evaluates the plan as slot bitsets: artist/album/genre and year
+// terms come from a FilterIndex, and the remaining (residual) terms are
+// only checked for slots that the indexed terms of the same AND left over.
+class TrackFilter
+{
+public:
+    TrackFilter() = default;                   // matches every track
+    explicit TrackFilter(const QString& text);
+
+    QString name() const { return m_name; }
+
+    // A filter that failed to parse matches every track
+    bool isValid() const { return m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+    bool matchesAll() const { return !m_root; }
+
+    bool matches(const Track& track) const;
+
+    // Matching slots out of candidates, both in ascending order
+    std::vector<int> select(const std::vector<Track>& tracks, const FilterIndex& index,
+                            const std::vector<int>& candidates) const;
+
+    struct Node;
+
+private:
+    QString m_name = "All Tracks";
+    QString m_error;
+    std::shared_ptr<const Node> m_root;        // null: everything
+};
+
+#endif // TRACKFILTER_H
@@ -0,0 +1,268 @@
+#include "TrackSortIndex.h"
+#include <QLocale>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+constexpr int kMinRowsPerChunk = 4096;
+
+// Runs task(0..count-1) on pool, using the calling thread for whatever the
+// pool cannot take right now; safe to call from a task already on pool
+void runParallel(QThreadPool* pool, int count, const std::function<void(int)>& task)
+{
+    QSemaphore done;
+    for (int i = 1; i < count; ++i) {
+        const auto run = [&task, &done, i]() {
+            task(i);
+            done.release();
+        };
+        if (!pool->tryStart(run))
+            run();
+    }
+    task(0);
+    done.acquire(count - 1);
+}
+
+} // namespace
+
+TrackSortIndex::TrackSortIndex(const std::vector<Track>& store)
+    : m_store(store)
+    , m_collator(QLocale())
+{
+    // "Track 2" before "Track 10", and case is not a sort criterion
+    m_collator.setNumericMode(true);
+    m_collator.setCaseSensitivity(Qt::CaseInsensitive);
+}
+
+bool TrackSortIndex::fieldFromName(const QString& name, Field* field)
+{
+    static const struct {
+        const char* name;
+        Field field;
+    } fields[] = {
+        {"Title", Title},
+        {"Artist", Artist},
+        {"Album", Album},
+        {"Genre", Genre},
+        {"Year", Year},
+        {"Duration", Duration},
+        {"TrackNumber", TrackNumber},
+        {"PlayCount", PlayCount},
+    };
+
+    for (const auto& entry : fields) {
+        if (name.compare(QLatin1String(entry.name), Qt::CaseInsensitive) == 0) {
+            *field = entry.field;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ==================== Maintenance ====================
+
+void TrackSortIndex::insert(const std::vector<int>& added)
+{
+    if (added.empty())
+        return;
+
+    for (int slot : added) {
+        ensureKeys(slot);
+    }
+
+    for (int f = 0; f < FieldCount; ++f) {
+        if (!m_built[f])
+            continue;
+
+        // Sort the batch, then one linear merge into the cached order
+        const Field field = static_cast<Field>(f);
+        const auto less = [this, field](int a, int b) { return lessThan(field, a, b); };
+
+        std::vector<int> batch = added;
+        std::sort(batch.begin(), batch.end(), less);
+
+        std::vector<int> merged;
+        merged.reserve(m_permutations[f].size() + batch.size());
+        std::merge(m_permutations[f].begin(), m_permutations[f].end(), batch.begin(), batch.end(),
+                   std::back_inserter(merged), less);
+        m_permutations[f] = std::move(merged);
+    }
+}
+
+void TrackSortIndex::remove(const std::vector<int>& released)
+{
+    if (released.empty())
+        return;
+
+    std::vector<char> removed(m_store.size(), 0);
+    for (int slot : released) {
+        if (slot >= 0 && slot < static_cast<int>(removed.size()))
+            removed[slot] = 1;
+        if (slot >= 0 && slot < static_cast<int>(m_titleKeys.size()))
+            m_titleKeys[slot].reset();
+    }
+
+    for (int f = 0; f < FieldCount; ++f) {
+        if (!m_built[f])
+            continue;
+
+        std::vector<int>& order = m_permutations[f];
+        order.erase(std::remove_if(order.begin(), order.end(),
+                                   [&removed](int slot) { return slot < static_cast<int>(removed.size()) && removed[slot]; }),
+                    order.end());
+    }
+}
+
+void TrackSortIndex::clear()
+{
+    m_titleKeys.clear();
+    for (int f = 0; f < FieldCount; ++f) {
+        m_permutations[f].clear();
+        m_built[f] = false;
+    }
+}
+
+void TrackSortIndex::ensureKeys(int slot)
+{
+    if (slot >= static_cast<int>(m_titleKeys.size()))
+        m_titleKeys.resize(slot + 1);
+
+    const Track& track = m_store[slot];
+    m_titleKeys[slot] = m_collator.sortKey(track.title());
+    ensureSymbolKey(track.artistId());
+    ensureSymbolKey(track.albumId());
+    ensureSymbolKey(track.genreId());
+}
+
+void TrackSortIndex::ensureSymbolKey(StringPool::Symbol symbol)
+{
+    if (symbol >= m_symbolKeys.size())
+        m_symbolKeys.resize(symbol + 1);
+
+    // Symbols are immutable, so each key is computed once
+    std::optional<QCollatorSortKey>& key = m_symbolKeys[symbol];
+    if (!key)
+        key = m_collator.sortKey(StringPool::instance().string(symbol));
+}
+
+// ==================== Ordering ====================
+
+int TrackSortIndex::compare(Field field, int a, int b) const
+{
+    // Keys of inserted slots are all present, so this only reads and is
+    // safe to call from several threads at once
+    const Track& x = m_store[a];
+    const Track& y = m_store[b];
+
+    const auto threeWay = [](auto lhs, auto rhs) { return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0); };
+    const auto symbols = [this](StringPool::Symbol lhs, StringPool::Symbol rhs) {
+        return lhs == rhs ? 0 : m_symbolKeys[lhs]->compare(*m_symbolKeys[rhs]);
+    };
+
+    switch (field) {
+    case Title:
+        return m_titleKeys[a]->compare(*m_titleKeys[b]);
+    case Artist:
+        return symbols(x.artistId(), y.artistId());
+    case Album:
+        return symbols(x.albumId(), y.albumId());
+    case Genre:
+        return symbols(x.genreId(), y.genreId());
+    case Year:
+        return threeWay(x.year(), y.year());
+    case Duration:
+        return threeWay(x.duration(), y.duration());
+    case TrackNumber:
+        return threeWay(x.trackNumber(), y.trackNumber());
+    case PlayCount:
+        return threeWay(x.playCount(), y.playCount());
+    default:
+        return 0;
+    }
+}
+
+bool TrackSortIndex::lessThan(Field field, int a, int b) const
+{
+    const int order = compare(field, a, b);
+    return order != 0 ? order < 0 : a < b;
+}
+
+const std::vector<int>& TrackSortIndex::permutation(Field field)
+{
+    if (!m_built[field]) {
+        std::vector<int>& order = m_permutations[field];
+        order.clear();
+        for (int slot = 0; slot < static_cast<int>(m_titleKeys.size()); ++slot) {
+            if (m_titleKeys[slot])
+                order.push_back(slot);
+        }
+        std::sort(order.begin(), order.end(), [this, field](int a, int b) { return lessThan(field, a, b); });
+        m_built[field] = true;
+    }
+    return m_permutations[field];
+}
+
+std::vector<int> TrackSortIndex::denseRanks(Field field)
+{
+    std::vector<int> ranks(m_store.size(), 0);
+    const std::vector<int>& order = permutation(field);
+
+    int rank = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        if (i > 0 && compare(field, order[i - 1], order[i]) != 0)
+            ++rank;
+        ranks[order[i]] = rank;
+    }
+    return ranks;
+}
+
+std::vector<int> TrackSortIndex::parallelStableSort(const std::vector<int>& keys, int keyCount, int rowCount,
+                                                    QThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+    std::vector<int> rows(rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        rows[row] = row;
+    }
+
+    const auto less = [&keys, keyCount](int a, int b) {
+        const int* x = keys.data() + size_t(a) * keyCount;
+        const int* y = keys.data() + size_t(b) * keyCount;
+        for (int k = 0; k < keyCount; ++k) {
+            if (x[k] != y[k])
+                return x[k] < y[k];
+        }
+        return false;
+    };
+
+    const int chunks = std::max(1, std::min(pool->maxThreadCount(), rowCount / kMinRowsPerChunk));
+    std::vector<int> bounds(chunks + 1);
+    for (int i = 0; i <= chunks; ++i) {
+        bounds[i] = static_cast<int>(qint64(rowCount) * i / chunks);
+    }
+
+    runParallel(pool, chunks, [&](int i) {
+        std::stable_sort(rows.begin() + bounds[i], rows.begin() + bounds[i + 1], less);
+    });
+
+    // Pairwise merge rounds; inplace_merge keeps equal rows in input order
+    for (int width = 1; width < chunks; width *= 2) {
+        if (cancelled && cancelled->load(std::memory_order_relaxed))
+            return {};
+
+        const int pairs = (chunks + 2 * width - 1) / (2 * width);
+        runParallel(pool, pairs, [&](int pair) {
+            const int first = pair * 2 * width;
+            const int middle = std::min(first + width, chunks);
+            const int last = std::min(first + 2 * width, chunks);
+            if (middle < last) {
+                std::inplace_merge(rows.begin() + bounds[first], rows.begin() + bounds[middle],
+                                   rows.begin() + bounds[last], less);
+            }
+        });
+    }
+
+    return rows;
+}
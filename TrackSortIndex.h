@@ -0,0 +1,86 @@
+#ifndef TRACKSORTINDEX_H
+#define TRACKSORTINDEX_H
+
+#include <QCollator>
+#include <QString>
+#include <atomic>
+#include <optional>
+#include <vector>
+#include "Track.h"
+
+class QThreadPool;
+
+// Sort support for a slot-addressed track store.
+// Locale-aware collation keys are computed once: per slot for titles and
+// per interned symbol for artist, album and genre, so comparisons never
+// allocate. For each field that has been sorted on, the full ascending
+// permutation of occupied slots is cached and kept up to date by merging
+// inserted batches and filtering out removed slots, so switching columns
+// or filters does not sort from scratch.
+//
+// The owner reports changes after updating the store: insert() for new
+// slots, remove() for released ones, and both for slots whose track was
+// replaced.
+class TrackSortIndex
+{
+public:
+    enum Field {
+        Title,
+        Artist,
+        Album,
+        Genre,
+        Year,
+        Duration,
+        TrackNumber,
+        PlayCount,
+        FieldCount
+    };
+
+    struct SortKey {
+        Field field = Title;
+        bool descending = false;
+    };
+
+    // Ordered keys, e.g. Artist, Year, Album, TrackNumber
+    using SortSpec = std::vector<SortKey>;
+
+    explicit TrackSortIndex(const std::vector<Track>& store);
+
+    // Accepts the names used by the QML sort menu; returns false if unknown
+    static bool fieldFromName(const QString& name, Field* field);
+
+    void insert(const std::vector<int>& added);
+    void remove(const std::vector<int>& released);
+    void clear();
+
+    // Three-way comparison on one field; 0 for equal values
+    int compare(Field field, int a, int b) const;
+
+    // By slot: equal values share a rank, ranks ascend with the field order.
+    // Lets a multi-key sort run on plain integers away from the store.
+    std::vector<int> denseRanks(Field field);
+
+    // Stable sort of rows 0..rowCount-1 by keyCount integer keys per row
+    // (row-major in keys). Chunks are sorted and merged in parallel on pool;
+    // returns an empty vector if cancelled reads non-zero between passes.
+    static std::vector<int> parallelStableSort(const std::vector<int>& keys, int keyCount, int rowCount,
+                                               QThreadPool* pool, const std::atomic<bool>* cancelled);
+
+private:
+    void ensureKeys(int slot);
+    void ensureSymbolKey(StringPool::Symbol symbol);
+    bool lessThan(Field field, int a, int b) const;
+    const std::vector<int>& permutation(Field field);
+
+    const std::vector<Track>& m_store;
+    QCollator m_collator;
+
+    std::vector<std::optional<QCollatorSortKey>> m_titleKeys;          // by slot
+    std::vector<std::optional<QCollatorSortKey>> m_symbolKeys;         // by symbol
+
+    // Cached ascending permutations; only fields that were asked for are built
+    std::vector<int> m_permutations[FieldCount];
+    bool m_built[FieldCount] = {};
+};
+
+#endif // TRACKSORTINDEX_H
@@ -2,6 +2,7 @@
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QIcon>
+#include "AlbumArtProvider.h"
 #include "AudioController.h"
 #include "Track.h"
 #include "LibraryModel.h"
@@ -24,6 +25,9 @@ int main(int argc, char *argv[])
 
     QQmlApplicationEngine engine;
 
+    // Cover thumbnails for LibraryModel's albumArt role; the engine takes ownership
+    engine.addImageProvider(AlbumArtProvider::kProviderId, new AlbumArtProvider);
+
     const QUrl url(QStringLiteral("qrc:/main.qml"));
     engine.load(url);
 
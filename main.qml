@@ -133,15 +133,8 @@ ApplicationWindow {
     }
 
     function updateLibraryQueue() {
-        var trackPaths = []
-        var count = libraryModel.totalTracks
-
-        for (var i = 0; i < count; i++) {
-            var path = libraryModel.getTrackPath(i)
-            if (path && path !== "") {
-                trackPaths.push(path)
-            }
-        }
+        // One call for the whole result; rows the view has not fetched yet are included
+        var trackPaths = libraryModel.displayedTrackPaths()
 
         // Update the controller's library queue
         audioController.updateLibraryQueue(trackPaths)
@@ -1842,6 +1835,8 @@ ApplicationWindow {
                                                     anchors.fill: parent
                                                     anchors.margins: 2
                                                     source: model.albumArt || ""
+                                                    sourceSize: Qt.size(64, 64)
+                                                    asynchronous: true
                                                     fillMode: Image.PreserveAspectCrop
                                                     smooth: true
                                                 }
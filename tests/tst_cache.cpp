@@ -0,0 +1,102 @@
+#include <QtTest>
+#include <string>
+#include "Cache.h"
+
+class TestCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void evictsLeastRecentlyUsedByWeight();
+    void capsEntryAtQuarterShard();
+    void ignoresNullPut();
+    void countsHitsAndMisses();
+
+private:
+    struct LengthWeigher {
+        size_t operator()(const std::string& value) const { return value.size(); }
+    };
+
+    using Cache = ConcurrentLRUCache<int, std::string, LengthWeigher>;
+};
+
+void TestCache::evictsLeastRecentlyUsedByWeight()
+{
+    Cache cache(100, 1);
+    for (int key = 0; key < 4; ++key) {
+        QVERIFY(cache.put(key, std::string(20, static_cast<char>('a' + key))));
+    }
+    QCOMPARE(cache.weight(), size_t(80));
+
+    // 0 becomes the most recent, so 1 is the coldest when the budget runs out
+    QVERIFY(cache.get(0));
+    cache.put(4, std::string(25, 'e'));
+
+    QVERIFY(!cache.contains(1));
+    QVERIFY(cache.contains(0));
+    QVERIFY(cache.contains(2));
+    QVERIFY(cache.contains(3));
+    QVERIFY(cache.contains(4));
+    QCOMPARE(cache.weight(), size_t(85));
+    QCOMPARE(cache.stats().evictions, uint64_t(1));
+
+    // Replacing an entry releases its old weight first
+    cache.put(2, std::string(5, 'c'));
+    QCOMPARE(cache.weight(), size_t(70));
+    QCOMPARE(cache.size(), size_t(4));
+}
+
+void TestCache::capsEntryAtQuarterShard()
+{
+    Cache cache(200, 2);   // 100 per shard, entries up to 25
+
+    Cache::ValuePtr heavy = cache.put(1, std::string(26, 'x'));
+    QVERIFY(heavy);
+    QCOMPARE(heavy->size(), size_t(26));
+    QVERIFY(!cache.contains(1));
+    QCOMPARE(cache.size(), size_t(0));
+
+    QVERIFY(cache.put(2, std::string(25, 'y')));
+    QVERIFY(cache.contains(2));
+
+    // An oversized replacement drops the entry it replaces
+    cache.put(2, std::string(40, 'z'));
+    QVERIFY(!cache.contains(2));
+    QCOMPARE(cache.weight(), size_t(0));
+}
+
+void TestCache::ignoresNullPut()
+{
+    Cache cache(100, 1);
+    cache.put(1, std::string("kept"));
+
+    QVERIFY(!cache.put(1, Cache::ValuePtr()));
+    QVERIFY(!cache.put(2, Cache::ValuePtr()));
+
+    QCOMPARE(cache.size(), size_t(1));
+    QCOMPARE(*cache.get(1), std::string("kept"));
+    QCOMPARE(cache.stats().insertions, uint64_t(1));
+}
+
+void TestCache::countsHitsAndMisses()
+{
+    Cache cache(100, 4);
+    QVERIFY(!cache.get(7));
+    cache.put(7, std::string("seven"));
+    QVERIFY(cache.get(7));
+    QVERIFY(cache.get(7));
+    QVERIFY(!cache.get(8));
+
+    // contains() is not a lookup that counts
+    QVERIFY(cache.contains(7));
+
+    const Cache::Stats stats = cache.stats();
+    QCOMPARE(stats.hits, uint64_t(2));
+    QCOMPARE(stats.misses, uint64_t(2));
+    QCOMPARE(stats.insertions, uint64_t(1));
+    QCOMPARE(stats.entries, size_t(1));
+    QCOMPARE(stats.weight, size_t(5));
+}
+
+QTEST_GUILESS_MAIN(TestCache)
+#include "tst_cache.moc"
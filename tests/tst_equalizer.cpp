@@ -0,0 +1,178 @@
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "AudioEffect.h"
+
+class TestEqualizer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void flatBandsAreUnity();
+    void peakGainAtCentre_data();
+    void peakGainAtCentre();
+    void layoutsAgree();
+    void unpreparedBlockPassesThrough();
+
+private:
+    static constexpr int kRate = 48000;
+    static constexpr int kBlock = 512;
+    static constexpr double kPi = 3.14159265358979323846;
+
+    static std::vector<float> sine(double frequency, int frames);
+    static void run(EqualizerEffect& eq, std::vector<float>& samples, int channels);
+    static double amplitude(const std::vector<float>& samples, double frequency, int first);
+};
+
+std::vector<float> TestEqualizer::sine(double frequency, int frames)
+{
+    std::vector<float> samples(frames);
+    for (int i = 0; i < frames; ++i) {
+        samples[i] = 0.25f * static_cast<float>(std::sin(2.0 * kPi * frequency * i / kRate));
+    }
+    return samples;
+}
+
+// Interleaved, block by block as the audio thread would
+void TestEqualizer::run(EqualizerEffect& eq, std::vector<float>& samples, int channels)
+{
+    const int frames = static_cast<int>(samples.size()) / channels;
+    for (int first = 0; first < frames; first += kBlock) {
+        const int count = std::min(kBlock, frames - first);
+        eq.process(AudioBlock::interleaved(samples.data() + static_cast<size_t>(first) * channels,
+                                           count, channels, kRate));
+    }
+}
+
+// Amplitude of the frequency component over [first, end); exact when the
+// range holds whole periods
+double TestEqualizer::amplitude(const std::vector<float>& samples, double frequency, int first)
+{
+    double re = 0.0;
+    double im = 0.0;
+    const int count = static_cast<int>(samples.size()) - first;
+    for (int i = first; i < static_cast<int>(samples.size()); ++i) {
+        const double phase = 2.0 * kPi * frequency * i / kRate;
+        re += samples[i] * std::cos(phase);
+        im += samples[i] * std::sin(phase);
+    }
+    return 2.0 * std::sqrt(re * re + im * im) / count;
+}
+
+void TestEqualizer::flatBandsAreUnity()
+{
+    // A band that ramped back to 0 dB leaves the cascade entirely
+    EqualizerEffect eq;
+    eq.prepare(kRate, 2);
+    eq.setBand(5, 6.0f);
+    std::vector<float> warmup(2 * kRate / 10, 0.1f);
+    run(eq, warmup, 2);
+    eq.setBand(5, 0.0f);
+    run(eq, warmup, 2);
+
+    std::vector<float> samples(2 * kRate);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<float>((i * 7919) % 2001) / 1000.0f - 1.0f;
+    }
+    const std::vector<float> input = samples;
+
+    run(eq, samples, 2);
+    QVERIFY(samples == input);
+}
+
+void TestEqualizer::peakGainAtCentre_data()
+{
+    QTest::addColumn<int>("band");
+    QTest::addColumn<float>("gain");
+
+    for (int band = 0; band < EqualizerEffect::BAND_COUNT; ++band) {
+        const QByteArray name = QByteArray::number(EqualizerEffect::BAND_FREQUENCIES[band]) + " Hz";
+        QTest::newRow((name + " +9 dB").constData()) << band << 9.0f;
+        QTest::newRow((name + " -6 dB").constData()) << band << -6.0f;
+    }
+}
+
+void TestEqualizer::peakGainAtCentre()
+{
+    QFETCH(int, band);
+    QFETCH(float, gain);
+
+    EqualizerEffect eq;
+    eq.prepare(kRate, 1);
+    eq.setBand(band, gain);
+
+    const double frequency = EqualizerEffect::BAND_FREQUENCIES[band];
+    std::vector<float> samples = sine(frequency, kRate);
+    const double before = amplitude(samples, frequency, kRate / 2);
+    run(eq, samples, 1);
+    const double after = amplitude(samples, frequency, kRate / 2);
+
+    // Peaking filters reach the full gain at their centre, shelves half of it
+    const bool shelf = band == 0 || band == EqualizerEffect::BAND_COUNT - 1;
+    const double expected = shelf ? gain / 2.0 : gain;
+    const double measured = 20.0 * std::log10(after / before);
+    QVERIFY2(std::abs(measured - expected) < 0.05,
+             qPrintable(QString("measured %1 dB, expected %2 dB").arg(measured).arg(expected)));
+}
+
+void TestEqualizer::layoutsAgree()
+{
+    // Every channel count and layout must give each channel what mono does
+    auto configure = [](EqualizerEffect& eq, int channels) {
+        eq.prepare(kRate, channels);
+        eq.setPreset("Rock");
+    };
+
+    const int frames = kRate / 4;
+    std::vector<float> mono = sine(440.0, frames);
+    for (int i = 0; i < frames; ++i) {
+        mono[i] += 0.25f * static_cast<float>(std::sin(2.0 * kPi * 60.0 * i / kRate));
+    }
+    std::vector<float> expected = mono;
+    EqualizerEffect reference;
+    configure(reference, 1);
+    run(reference, expected, 1);
+
+    for (int channels : {2, 3, 4, 6}) {
+        std::vector<float> interleaved(static_cast<size_t>(frames) * channels);
+        for (int i = 0; i < frames; ++i) {
+            std::fill_n(interleaved.begin() + static_cast<size_t>(i) * channels, channels, mono[i]);
+        }
+        EqualizerEffect eq;
+        configure(eq, channels);
+        run(eq, interleaved, channels);
+
+        for (int i = 0; i < frames; ++i) {
+            for (int c = 0; c < channels; ++c) {
+                QCOMPARE(interleaved[static_cast<size_t>(i) * channels + c], expected[i]);
+            }
+        }
+    }
+
+    std::vector<float> left = mono;
+    std::vector<float> right = mono;
+    float* planes[] = {left.data(), right.data()};
+    EqualizerEffect planar;
+    configure(planar, 2);
+    for (int first = 0; first < frames; first += kBlock) {
+        float* offset[] = {planes[0] + first, planes[1] + first};
+        planar.process(AudioBlock::planar(offset, std::min(kBlock, frames - first), 2, kRate));
+    }
+    QVERIFY(left == expected);
+    QVERIFY(right == expected);
+}
+
+void TestEqualizer::unpreparedBlockPassesThrough()
+{
+    EqualizerEffect eq;
+    eq.prepare(kRate, 2);
+    eq.setBand(3, 12.0f);
+
+    std::vector<float> samples(static_cast<size_t>(kBlock) * 6, 0.5f);
+    run(eq, samples, 6);
+    QVERIFY(std::all_of(samples.begin(), samples.end(), [](float s) { return s == 0.5f; }));
+}
+
+QTEST_GUILESS_MAIN(TestEqualizer)
+#include "tst_equalizer.moc"
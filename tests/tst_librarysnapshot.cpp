@@ -0,0 +1,182 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include <vector>
+#include "LibrarySnapshot.h"
+
+class TestLibrarySnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void roundTripsTracks();
+    void findsTracksByPath();
+    void groupsSortedByKey();
+    void emptyLibrary();
+    void rejectsTruncatedFile();
+    void rejectsForeignFile();
+
+private:
+    static std::vector<Track> sampleTracks();
+    QString snapshotPath() const { return m_dir->filePath("library.snap"); }
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+std::vector<Track> TestLibrarySnapshot::sampleTracks()
+{
+    struct Row {
+        const char* path;
+        const char* title;
+        const char* artist;
+        const char* album;
+        const char* genre;
+        int year;
+    };
+    const Row rows[] = {
+        {"/music/b/02.mp3", "Hyperballad", "Björk", "Post", "Electronic", 1995},
+        {"/music/a/01.flac", "So What", "Miles Davis", "Kind of Blue", "Jazz", 1959},
+        {"/music/b/01.mp3", "Army of Me", "Björk", "Post", "Electronic", 1995},
+        {"/music/c/東京.ogg", "東京", "くるり", "図鑑", "Rock", 2000},
+        {"/music/a/02.flac", "Blue in Green", "Miles Davis", "Kind of Blue", "Jazz", 1959},
+    };
+
+    std::vector<Track> tracks;
+    int number = 1;
+    for (const Row& row : rows) {
+        Track track(QString::fromUtf8(row.path), QString::fromUtf8(row.title), QString::fromUtf8(row.artist));
+        track.setAlbum(QString::fromUtf8(row.album));
+        track.setGenre(QString::fromUtf8(row.genre));
+        track.setYear(row.year);
+        track.setTrackNumber(number);
+        track.setDuration(60000 * number);
+        track.setPlayCount(number - 1);
+        ++number;
+        tracks.push_back(track);
+    }
+    tracks[1].setLastPlayed(QDateTime::fromMSecsSinceEpoch(1700000000000));
+    return tracks;
+}
+
+void TestLibrarySnapshot::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void TestLibrarySnapshot::roundTripsTracks()
+{
+    const std::vector<Track> tracks = sampleTracks();
+    QVERIFY(LibrarySnapshot::write(snapshotPath(), tracks));
+    QVERIFY(LibrarySnapshot::isSnapshot(snapshotPath()));
+
+    LibrarySnapshot snapshot;
+    QVERIFY(snapshot.open(snapshotPath()));
+    QCOMPARE(snapshot.trackCount(), int(tracks.size()));
+    QCOMPARE(snapshot.totalDuration(), qint64(60000 * (1 + 2 + 3 + 4 + 5)));
+
+    for (int row = 0; row < snapshot.trackCount(); ++row) {
+        const Track expected = tracks[row];
+        const Track actual = snapshot.track(row);
+        QCOMPARE(actual.path(), expected.path());
+        QCOMPARE(actual.title(), expected.title());
+        QCOMPARE(actual.artist(), expected.artist());
+        QCOMPARE(actual.album(), expected.album());
+        QCOMPARE(actual.genre(), expected.genre());
+        QCOMPARE(actual.year(), expected.year());
+        QCOMPARE(actual.trackNumber(), expected.trackNumber());
+        QCOMPARE(actual.duration(), expected.duration());
+        QCOMPARE(actual.playCount(), expected.playCount());
+        QCOMPARE(actual.lastPlayed().isValid(), expected.lastPlayed().isValid());
+    }
+    QCOMPARE(snapshot.track(1).lastPlayed().toMSecsSinceEpoch(), qint64(1700000000000));
+}
+
+void TestLibrarySnapshot::findsTracksByPath()
+{
+    const std::vector<Track> tracks = sampleTracks();
+    QVERIFY(LibrarySnapshot::write(snapshotPath(), tracks));
+
+    LibrarySnapshot snapshot;
+    QVERIFY(snapshot.open(snapshotPath()));
+    for (int row = 0; row < int(tracks.size()); ++row) {
+        QCOMPARE(snapshot.findTrack(tracks[row].path()), row);
+    }
+    QCOMPARE(snapshot.findTrack("/music/b/03.mp3"), -1);
+    QCOMPARE(snapshot.findTrack(QString()), -1);
+}
+
+void TestLibrarySnapshot::groupsSortedByKey()
+{
+    QVERIFY(LibrarySnapshot::write(snapshotPath(), sampleTracks()));
+
+    LibrarySnapshot snapshot;
+    QVERIFY(snapshot.open(snapshotPath()));
+
+    const LibrarySnapshot::Index artist = LibrarySnapshot::Index::Artist;
+    QCOMPARE(snapshot.groupCount(artist), 3);
+    for (int i = 1; i < snapshot.groupCount(artist); ++i) {
+        QVERIFY(snapshot.group(artist, i - 1).key < snapshot.group(artist, i).key);
+    }
+
+    const int bjork = snapshot.findGroup(artist, QString::fromUtf8("Björk"));
+    QVERIFY(bjork >= 0);
+    const LibrarySnapshot::Group group = snapshot.group(artist, bjork);
+    QCOMPARE(group.key, QString::fromUtf8("Björk"));
+    QCOMPARE(group.count, 2);
+    QCOMPARE(group.rows[0], quint32(0));
+    QCOMPARE(group.rows[1], quint32(2));
+
+    const int jazz = snapshot.findGroup(LibrarySnapshot::Index::Genre, "Jazz");
+    QVERIFY(jazz >= 0);
+    QCOMPARE(snapshot.group(LibrarySnapshot::Index::Genre, jazz).count, 2);
+
+    QCOMPARE(snapshot.groupCount(LibrarySnapshot::Index::Album), 3);
+    QCOMPARE(snapshot.findGroup(LibrarySnapshot::Index::Album, "Debut"), -1);
+    QCOMPARE(snapshot.findGroup(artist, "björk"), -1);
+}
+
+void TestLibrarySnapshot::emptyLibrary()
+{
+    QVERIFY(LibrarySnapshot::write(snapshotPath(), {}));
+
+    LibrarySnapshot snapshot;
+    QVERIFY(snapshot.open(snapshotPath()));
+    QCOMPARE(snapshot.trackCount(), 0);
+    QCOMPARE(snapshot.totalDuration(), qint64(0));
+    QCOMPARE(snapshot.groupCount(LibrarySnapshot::Index::Artist), 0);
+    QCOMPARE(snapshot.findTrack("/music/a.mp3"), -1);
+}
+
+void TestLibrarySnapshot::rejectsTruncatedFile()
+{
+    QVERIFY(LibrarySnapshot::write(snapshotPath(), sampleTracks()));
+
+    QFile file(snapshotPath());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 8));
+    file.close();
+
+    LibrarySnapshot snapshot;
+    QVERIFY(!snapshot.open(snapshotPath()));
+    QVERIFY(!snapshot.isOpen());
+    QVERIFY(!snapshot.errorString().isEmpty());
+}
+
+void TestLibrarySnapshot::rejectsForeignFile()
+{
+    QFile file(snapshotPath());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(256, 'x'));
+    file.close();
+
+    QVERIFY(!LibrarySnapshot::isSnapshot(snapshotPath()));
+    LibrarySnapshot snapshot;
+    QVERIFY(!snapshot.open(snapshotPath()));
+}
+
+QTEST_GUILESS_MAIN(TestLibrarySnapshot)
+#include "tst_librarysnapshot.moc"
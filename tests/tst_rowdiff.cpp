@@ -0,0 +1,276 @@
+#include <QtTest>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "RowDiff.h"
+
+namespace {
+
+// Replays the edit script on its own copy of the old rows and checks it
+// against the rows RowDiff hands back after every step
+class Recorder : public RowDiff::Listener
+{
+public:
+    Recorder(const std::vector<int>& rows, const std::vector<int>& live)
+        : shadow(rows)
+        , m_live(live)
+    {
+    }
+
+    void beginReset() override { open("reset"); }
+    void endReset() override
+    {
+        close("reset");
+        shadow = m_live;
+        ++resets;
+    }
+
+    void beginRemove(int first, int last) override
+    {
+        open("remove");
+        valid &= first >= 0 && first <= last && last < int(shadow.size());
+        m_first = first;
+        m_last = last;
+    }
+    void endRemove() override
+    {
+        close("remove");
+        shadow.erase(shadow.begin() + m_first, shadow.begin() + m_last + 1);
+        check();
+        ++removals;
+    }
+
+    void beginMove(int from, int destination) override
+    {
+        open("move");
+        const int count = int(shadow.size());
+        valid &= from >= 0 && from < count && destination >= 0 && destination <= count
+                 && destination != from && destination != from + 1;
+        m_first = from;
+        m_last = destination;
+    }
+    void endMove() override
+    {
+        close("move");
+        const int id = shadow[m_first];
+        shadow.erase(shadow.begin() + m_first);
+        shadow.insert(shadow.begin() + (m_last > m_first ? m_last - 1 : m_last), id);
+        check();
+        ++moves;
+    }
+
+    void beginInsert(int first, int last) override
+    {
+        open("insert");
+        valid &= first >= 0 && first <= last && first <= int(shadow.size());
+        m_first = first;
+        m_last = last;
+    }
+    void endInsert() override
+    {
+        close("insert");
+        shadow.insert(shadow.begin() + m_first, m_live.begin() + m_first, m_live.begin() + m_last + 1);
+        check();
+        ++insertions;
+    }
+
+    void beginLayoutChange() override { open("layout"); }
+    void endLayoutChange(const std::vector<int>& newRows) override
+    {
+        close("layout");
+        std::vector<int> moved(shadow.size(), -1);
+        valid &= newRows.size() == shadow.size();
+        for (size_t row = 0; valid && row < newRows.size(); ++row) {
+            valid &= newRows[row] >= 0 && newRows[row] < int(moved.size()) && moved[newRows[row]] < 0;
+            if (valid)
+                moved[newRows[row]] = shadow[row];
+        }
+        shadow = moved;
+        check();
+        ++layouts;
+    }
+
+    std::vector<int> shadow;
+    bool valid = true;
+    int resets = 0;
+    int removals = 0;
+    int moves = 0;
+    int insertions = 0;
+    int layouts = 0;
+
+    int steps() const { return resets + removals + moves + insertions + layouts; }
+
+private:
+    void open(const char* step)
+    {
+        valid &= m_open == nullptr;
+        m_open = step;
+    }
+    void close(const char* step)
+    {
+        valid &= m_open == step;
+        m_open = nullptr;
+    }
+    void check() { valid &= shadow == m_live; }
+
+    const std::vector<int>& m_live;
+    const char* m_open = nullptr;
+    int m_first = 0;
+    int m_last = 0;
+};
+
+constexpr int kMaxOperations = 8;
+constexpr int kMaxMoves = 4;
+constexpr size_t kIdLimit = 1000;
+
+std::vector<int> range(int first, int last)
+{
+    std::vector<int> ids(last - first);
+    std::iota(ids.begin(), ids.end(), first);
+    return ids;
+}
+
+} // namespace
+
+class TestRowDiff : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void unchangedRowsNeedNoSteps();
+    void appendIsOneInsertion();
+    void removedRunIsOneRemoval();
+    void singleMoveKeepsOtherRows();
+    void resortIsOneLayoutChange();
+    void scatteredEditsReset();
+    void randomEditsReplay();
+
+private:
+    static void diff(std::vector<int>& rows, const std::vector<int>& next, Recorder& recorder);
+};
+
+void TestRowDiff::diff(std::vector<int>& rows, const std::vector<int>& next, Recorder& recorder)
+{
+    RowDiff(kMaxOperations, kMaxMoves).apply(rows, next, kIdLimit, recorder);
+}
+
+void TestRowDiff::unchangedRowsNeedNoSteps()
+{
+    std::vector<int> rows = range(0, 20);
+    Recorder recorder(rows, rows);
+    diff(rows, range(0, 20), recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.steps(), 0);
+    QVERIFY(rows == range(0, 20));
+}
+
+void TestRowDiff::appendIsOneInsertion()
+{
+    std::vector<int> rows = range(0, 10);
+    const std::vector<int> next = range(0, 15);
+    Recorder recorder(rows, rows);
+    diff(rows, next, recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.insertions, 1);
+    QCOMPARE(recorder.steps(), 1);
+    QVERIFY(rows == next);
+}
+
+void TestRowDiff::removedRunIsOneRemoval()
+{
+    std::vector<int> rows = range(0, 10);
+    std::vector<int> next = range(0, 3);
+    const std::vector<int> tail = range(7, 10);
+    next.insert(next.end(), tail.begin(), tail.end());
+
+    Recorder recorder(rows, rows);
+    diff(rows, next, recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.removals, 1);
+    QCOMPARE(recorder.steps(), 1);
+    QVERIFY(rows == next);
+}
+
+void TestRowDiff::singleMoveKeepsOtherRows()
+{
+    std::vector<int> rows = range(0, 10);
+    const std::vector<int> next = {0, 1, 8, 2, 3, 4, 5, 6, 7, 9};
+
+    Recorder recorder(rows, rows);
+    diff(rows, next, recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.moves, 1);
+    QCOMPARE(recorder.steps(), 1);
+    QVERIFY(rows == next);
+}
+
+void TestRowDiff::resortIsOneLayoutChange()
+{
+    std::vector<int> rows = range(0, 12);
+    std::vector<int> next = rows;
+    std::reverse(next.begin(), next.end());
+
+    Recorder recorder(rows, rows);
+    diff(rows, next, recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.layouts, 1);
+    QCOMPARE(recorder.steps(), 1);
+    QVERIFY(rows == next);
+}
+
+void TestRowDiff::scatteredEditsReset()
+{
+    // Every other row replaced: far more runs than kMaxOperations
+    std::vector<int> rows = range(0, 40);
+    std::vector<int> next;
+    for (int id = 0; id < 40; ++id) {
+        next.push_back(id % 2 ? id + 100 : id);
+    }
+
+    Recorder recorder(rows, rows);
+    diff(rows, next, recorder);
+
+    QVERIFY(recorder.valid);
+    QCOMPARE(recorder.resets, 1);
+    QCOMPARE(recorder.steps(), 1);
+    QVERIFY(rows == next);
+}
+
+void TestRowDiff::randomEditsReplay()
+{
+    std::mt19937 random(20240611);
+    for (int round = 0; round < 2000; ++round) {
+        std::vector<int> pool = range(0, 60);
+        std::shuffle(pool.begin(), pool.end(), random);
+        std::vector<int> rows(pool.begin(), pool.begin() + random() % 30);
+
+        // Drop a few, add a few and move a few, so most rounds stay under the limits
+        std::vector<int> next = rows;
+        for (int i = random() % 3; i > 0 && !next.empty(); --i) {
+            next.erase(next.begin() + random() % next.size());
+        }
+        for (int i = random() % 3; i > 0; --i) {
+            next.insert(next.begin() + random() % (next.size() + 1), pool[30 + i]);
+        }
+        for (int i = random() % 6; i > 0 && next.size() > 1; --i) {
+            const int id = next[random() % next.size()];
+            next.erase(std::find(next.begin(), next.end(), id));
+            next.insert(next.begin() + random() % (next.size() + 1), id);
+        }
+
+        Recorder recorder(rows, rows);
+        diff(rows, next, recorder);
+        QVERIFY(recorder.valid);
+        QVERIFY(rows == next);
+        QVERIFY(recorder.shadow == next);
+    }
+}
+
+QTEST_APPLESS_MAIN(TestRowDiff)
+#include "tst_rowdiff.moc"
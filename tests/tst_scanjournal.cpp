@@ -0,0 +1,157 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include "ScanJournal.h"
+
+class TestScanJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void roundTrip();
+    void removalIsPersisted();
+    void rejectsUnknownFormat();
+    void discardsTruncatedFile();
+    void rejectsImplausibleCount();
+    void pathsUnder();
+
+private:
+    static Track makeTrack(const QString& path, int number);
+    QString journalPath() const { return m_dir->filePath("journal.bin"); }
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+Track TestScanJournal::makeTrack(const QString& path, int number)
+{
+    Track track(path, QStringLiteral("Title %1").arg(number), QStringLiteral("Artist %1").arg(number));
+    track.setAlbum(QStringLiteral("Album %1").arg(number));
+    track.setGenre(QStringLiteral("Genre"));
+    track.setYear(1990 + number);
+    track.setTrackNumber(number);
+    track.setDuration(180000 + number);
+    return track;
+}
+
+void TestScanJournal::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+}
+
+void TestScanJournal::roundTrip()
+{
+    const FileState first{1234, 1700000000123, 42};
+    const FileState second{99, 1600000000000, 0};
+
+    ScanJournal journal(journalPath());
+    journal.update("/music/a.mp3", first, makeTrack("/music/a.mp3", 1));
+    journal.update("/music/b.flac", second, makeTrack("/music/b.flac", 2));
+    QVERIFY(journal.save());
+
+    ScanJournal loaded(journalPath());
+    QVERIFY(loaded.load());
+    QCOMPARE(loaded.size(), 2);
+
+    const ScanJournal::Entry* entry = loaded.find("/music/a.mp3");
+    QVERIFY(entry);
+    QVERIFY(entry->state == first);
+    QCOMPARE(entry->track.path(), QString("/music/a.mp3"));
+    QCOMPARE(entry->track.title(), QString("Title 1"));
+    QCOMPARE(entry->track.artist(), QString("Artist 1"));
+    QCOMPARE(entry->track.album(), QString("Album 1"));
+    QCOMPARE(entry->track.genre(), QString("Genre"));
+    QCOMPARE(entry->track.year(), 1991);
+    QCOMPARE(entry->track.trackNumber(), 1);
+    QCOMPARE(entry->track.duration(), qint64(180001));
+
+    entry = loaded.find("/music/b.flac");
+    QVERIFY(entry);
+    QVERIFY(entry->state == second);
+    QCOMPARE(entry->track.title(), QString("Title 2"));
+
+    QVERIFY(!loaded.find("/music/c.ogg"));
+}
+
+void TestScanJournal::removalIsPersisted()
+{
+    ScanJournal journal(journalPath());
+    journal.update("/music/a.mp3", FileState{1, 1, 1}, makeTrack("/music/a.mp3", 1));
+    journal.update("/music/b.mp3", FileState{2, 2, 2}, makeTrack("/music/b.mp3", 2));
+    QVERIFY(journal.save());
+
+    journal.remove("/music/a.mp3");
+    QVERIFY(journal.save());
+
+    ScanJournal loaded(journalPath());
+    QVERIFY(loaded.load());
+    QCOMPARE(loaded.size(), 1);
+    QVERIFY(!loaded.find("/music/a.mp3"));
+    QVERIFY(loaded.find("/music/b.mp3"));
+}
+
+void TestScanJournal::rejectsUnknownFormat()
+{
+    QFile file(journalPath());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("not a scan journal");
+    file.close();
+
+    ScanJournal journal(journalPath());
+    QVERIFY(!journal.load());
+    QCOMPARE(journal.size(), 0);
+}
+
+void TestScanJournal::discardsTruncatedFile()
+{
+    ScanJournal journal(journalPath());
+    for (int i = 0; i < 10; ++i) {
+        const QString path = QStringLiteral("/music/%1.mp3").arg(i);
+        journal.update(path, FileState{i, i, quint64(i)}, makeTrack(path, i));
+    }
+    QVERIFY(journal.save());
+
+    QFile file(journalPath());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() / 2));
+    file.close();
+
+    ScanJournal loaded(journalPath());
+    QVERIFY(!loaded.load());
+    QCOMPARE(loaded.size(), 0);
+}
+
+void TestScanJournal::rejectsImplausibleCount()
+{
+    // A valid header that claims far more entries than follow it
+    QFile file(journalPath());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(0x464A524E) << quint16(1) << quint32(0xFFFFFFFF);
+    file.close();
+
+    ScanJournal journal(journalPath());
+    QVERIFY(!journal.load());
+    QCOMPARE(journal.size(), 0);
+}
+
+void TestScanJournal::pathsUnder()
+{
+    ScanJournal journal(journalPath());
+    journal.update("/music/a/one.mp3", FileState{1, 1, 1}, Track());
+    journal.update("/music/a/sub/two.mp3", FileState{1, 1, 2}, Track());
+    journal.update("/music/ab/three.mp3", FileState{1, 1, 3}, Track());
+
+    QStringList paths = journal.pathsUnder("/music/a/");
+    paths.sort();
+    QCOMPARE(paths, QStringList({"/music/a/one.mp3", "/music/a/sub/two.mp3"}));
+    QCOMPARE(journal.pathsUnder("/music/a").size(), 2);
+    QCOMPARE(journal.pathsUnder("/other").size(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestScanJournal)
+#include "tst_scanjournal.moc"
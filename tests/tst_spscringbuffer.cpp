@@ -0,0 +1,142 @@
+#include <QtTest>
+#include <thread>
+#include <vector>
+#include "CircularBuffer.h"
+
+class TestSpscRingBuffer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void capacityRoundsUp();
+    void spansWrapAround();
+    void countsOverrunsAndUnderruns();
+    void twoThreadsKeepOrder();
+};
+
+void TestSpscRingBuffer::capacityRoundsUp()
+{
+    SpscRingBuffer<int> buffer(5);
+    QCOMPARE(buffer.capacity(), size_t(8));
+
+    buffer.reset(16);
+    QCOMPARE(buffer.capacity(), size_t(16));
+    QCOMPARE(buffer.size(), size_t(0));
+}
+
+void TestSpscRingBuffer::spansWrapAround()
+{
+    SpscRingBuffer<int> buffer(8);
+    std::vector<int> scratch(6);
+    QCOMPARE(buffer.pushN(scratch.data(), 6), size_t(6));
+    QCOMPARE(buffer.popN(scratch.data(), 6), size_t(6));
+
+    // Empty, with both positions two short of the end of the storage
+    SpscRingBuffer<int>::Spans write = buffer.writeSpans();
+    QCOMPARE(write.first.size, size_t(2));
+    QCOMPARE(write.second.size, size_t(6));
+    int value = 0;
+    for (size_t i = 0; i < write.first.size; ++i)
+        write.first.data[i] = value++;
+    for (size_t i = 0; i < write.second.size; ++i)
+        write.second.data[i] = value++;
+    buffer.commitWrite(write.size());
+
+    QCOMPARE(buffer.size(), size_t(8));
+    QCOMPARE(buffer.writeSpans().size(), size_t(0));
+
+    SpscRingBuffer<int>::Spans read = buffer.readSpans();
+    QCOMPARE(read.first.size, size_t(2));
+    QCOMPARE(read.second.size, size_t(6));
+    QCOMPARE(read.first.data, write.first.data);
+    QCOMPARE(read.second.data, write.second.data);
+
+    std::vector<int> items;
+    items.insert(items.end(), read.first.data, read.first.data + read.first.size);
+    items.insert(items.end(), read.second.data, read.second.data + read.second.size);
+    QCOMPARE(items, std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}));
+
+    buffer.commitRead(3);
+    QCOMPARE(buffer.size(), size_t(5));
+    read = buffer.readSpans();
+    QCOMPARE(read.first.size, size_t(5));
+    QCOMPARE(read.second.size, size_t(0));
+    QCOMPARE(read.first.data[0], 3);
+
+    // A pushN() that wraps lands in the same order
+    const int more[] = {8, 9, 10};
+    QCOMPARE(buffer.pushN(more, 3), size_t(3));
+    std::vector<int> out(8);
+    QCOMPARE(buffer.popN(out.data(), 8), size_t(8));
+    QCOMPARE(out, std::vector<int>({3, 4, 5, 6, 7, 8, 9, 10}));
+}
+
+void TestSpscRingBuffer::countsOverrunsAndUnderruns()
+{
+    SpscRingBuffer<int> buffer(4);
+    const int items[] = {1, 2, 3};
+    int out[6] = {};
+
+    QCOMPARE(buffer.pushN(items, 3), size_t(3));
+    QCOMPARE(buffer.overruns(), uint64_t(0));
+
+    // Only one fits; nothing already queued is overwritten
+    QCOMPARE(buffer.pushN(items, 3), size_t(1));
+    QCOMPARE(buffer.overruns(), uint64_t(1));
+    QCOMPARE(buffer.pushN(items, 1), size_t(0));
+    QCOMPARE(buffer.overruns(), uint64_t(2));
+
+    QCOMPARE(buffer.popN(out, 2), size_t(2));
+    QCOMPARE(buffer.underruns(), uint64_t(0));
+    QCOMPARE(buffer.popN(out, 6), size_t(2));
+    QCOMPARE(buffer.underruns(), uint64_t(1));
+    QCOMPARE(out[0], 3);
+    QCOMPARE(out[1], 1);
+
+    // Neither discard() nor the span interface counts anything
+    QCOMPARE(buffer.discard(4), size_t(0));
+    buffer.commitRead(buffer.readSpans().size());
+    QCOMPARE(buffer.underruns(), uint64_t(1));
+
+    buffer.clear();
+    QCOMPARE(buffer.overruns(), uint64_t(0));
+    QCOMPARE(buffer.underruns(), uint64_t(0));
+}
+
+void TestSpscRingBuffer::twoThreadsKeepOrder()
+{
+    constexpr uint32_t kCount = 1000000;
+    SpscRingBuffer<uint32_t> buffer(256);
+
+    // Odd chunk sizes so both sides keep crossing the end of the storage
+    std::thread producer([&buffer]() {
+        std::vector<uint32_t> chunk;
+        uint32_t next = 0;
+        size_t chunkSize = 1;
+        while (next < kCount) {
+            chunk.clear();
+            for (size_t i = 0; i < chunkSize && next + i < kCount; ++i)
+                chunk.push_back(next + static_cast<uint32_t>(i));
+            next += static_cast<uint32_t>(buffer.pushN(chunk.data(), chunk.size()));
+            chunkSize = chunkSize % 97 + 1;
+        }
+    });
+
+    uint32_t expected = 0;
+    uint32_t mismatches = 0;
+    std::vector<uint32_t> chunk(61);
+    while (expected < kCount) {
+        const size_t n = buffer.popN(chunk.data(), chunk.size());
+        for (size_t i = 0; i < n; ++i) {
+            if (chunk[i] != expected++)
+                ++mismatches;
+        }
+    }
+    producer.join();
+
+    QCOMPARE(mismatches, uint32_t(0));
+    QCOMPARE(buffer.size(), size_t(0));
+}
+
+QTEST_GUILESS_MAIN(TestSpscRingBuffer)
+#include "tst_spscringbuffer.moc"
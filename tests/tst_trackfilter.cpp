@@ -0,0 +1,239 @@
+#include <QDateTime>
+#include <QtTest>
+#include <vector>
+#include "TrackFilter.h"
+
+class TestTrackFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void expressions_data();
+    void expressions();
+    void lastPlayedDates();
+    void sidebarNames();
+    void selectKeepsToCandidates();
+    void errors_data();
+    void errors();
+
+private:
+    // Slots select() returns over the whole store
+    QList<int> selected(const TrackFilter& filter) const;
+    // Slots matches() accepts, one track at a time
+    QList<int> scanned(const TrackFilter& filter) const;
+
+    std::vector<Track> m_store;
+    FilterIndex m_index;
+    QDateTime m_now;
+};
+
+void TestTrackFilter::initTestCase()
+{
+    m_now = QDateTime::currentDateTime();
+
+    const struct {
+        const char* title;
+        const char* artist;
+        const char* album;
+        const char* genre;
+        int year;
+        int trackNumber;
+        qint64 durationMs;
+        int playCount;
+        qint64 playedSecsAgo;       // 0: never played
+    } tracks[] = {
+        {"One More Time", "Daft Punk", "Discovery", "House", 2001, 1, 225000, 12, 2 * 86400},
+        {"Da Funk", "Daft Punk", "Homework", "House", 1997, 2, 240000, 3, 40 * 86400},
+        {"So What", "Miles Davis", "Kind of Blue", "Jazz", 1959, 1, 562000, 20, 0},
+        {"Giant Steps", "John Coltrane", "Giant Steps", "Jazz", 1960, 1, 283000, 0, 0},
+        {"Every Day I Have the Blues", "B.B. King", "Live at the Regal", "Blues", 1965, 3, 171000, 7, 5 * 3600},
+        {"Feel Like Going Home", "Muddy Waters", "Folk Singer", "Blues", 1964, 2, 210000, 1, 400 * 86400},
+        {"La femme d'argent", "Air", "Moon Safari", "Electronic", 1998, 4, 300000, 5, 10 * 86400},
+        {"Around the World", "Daft Punk Tribute", "Covers", "house", 2010, 5, 180000, 0, 0},
+    };
+
+    for (const auto& entry : tracks) {
+        Track track(QStringLiteral("/music/%1.mp3").arg(m_store.size()), QString::fromUtf8(entry.title),
+                    QString::fromUtf8(entry.artist));
+        track.setAlbum(QString::fromUtf8(entry.album));
+        track.setGenre(QString::fromUtf8(entry.genre));
+        track.setYear(entry.year);
+        track.setTrackNumber(entry.trackNumber);
+        track.setDuration(entry.durationMs);
+        track.setPlayCount(entry.playCount);
+        if (entry.playedSecsAgo > 0)
+            track.setLastPlayed(m_now.addSecs(-entry.playedSecsAgo));
+
+        m_index.add(static_cast<int>(m_store.size()), track);
+        m_store.push_back(track);
+    }
+}
+
+QList<int> TestTrackFilter::selected(const TrackFilter& filter) const
+{
+    std::vector<int> all(m_store.size());
+    for (size_t slot = 0; slot < all.size(); ++slot) {
+        all[slot] = static_cast<int>(slot);
+    }
+
+    QList<int> result;
+    for (int slot : filter.select(m_store, m_index, all)) {
+        result.append(slot);
+    }
+    return result;
+}
+
+QList<int> TestTrackFilter::scanned(const TrackFilter& filter) const
+{
+    QList<int> result;
+    for (size_t slot = 0; slot < m_store.size(); ++slot) {
+        if (filter.matches(m_store[slot]))
+            result.append(static_cast<int>(slot));
+    }
+    return result;
+}
+
+// ==================== Expressions ====================
+
+void TestTrackFilter::expressions_data()
+{
+    QTest::addColumn<QString>("expression");
+    QTest::addColumn<QList<int>>("expected");
+
+    // Indexed terms: whole value, ignoring case
+    QTest::newRow("artist quoted") << QStringLiteral("artist:\"Daft Punk\"") << QList<int>{0, 1};
+    QTest::newRow("genre folded") << QStringLiteral("genre:HOUSE") << QList<int>{0, 1, 7};
+    QTest::newRow("album missing") << QStringLiteral("album:Nevermind") << QList<int>{};
+
+    // Numeric ranges and comparisons
+    QTest::newRow("year range") << QStringLiteral("year:1955..1965") << QList<int>{2, 3, 4, 5};
+    QTest::newRow("year open high") << QStringLiteral("year:1997..") << QList<int>{0, 1, 6, 7};
+    QTest::newRow("year open low") << QStringLiteral("year:..1960") << QList<int>{2, 3};
+    QTest::newRow("year equal") << QStringLiteral("year:1998") << QList<int>{6};
+    QTest::newRow("year greater") << QStringLiteral("year:>1998") << QList<int>{0, 7};
+    QTest::newRow("year at least") << QStringLiteral("year:>=1998") << QList<int>{0, 6, 7};
+    QTest::newRow("year less") << QStringLiteral("year:<1960") << QList<int>{2};
+    QTest::newRow("year at most") << QStringLiteral("year:<=1960") << QList<int>{2, 3};
+    QTest::newRow("playcount") << QStringLiteral("playcount:>10") << QList<int>{0, 2};
+    QTest::newRow("track alias") << QStringLiteral("tracknumber:2..3") << QList<int>{1, 4, 5};
+    QTest::newRow("duration m:ss") << QStringLiteral("duration:3:30..4:00") << QList<int>{0, 1, 5};
+    QTest::newRow("duration seconds") << QStringLiteral("length:>300") << QList<int>{2};
+
+    // Relative ages; tracks never played match none of them
+    QTest::newRow("age within") << QStringLiteral("lastplayed:30d") << QList<int>{0, 4, 6};
+    QTest::newRow("age less") << QStringLiteral("played:<1d") << QList<int>{4};
+    QTest::newRow("age at most") << QStringLiteral("lastplayed:<=1w") << QList<int>{0, 4};
+    QTest::newRow("age greater") << QStringLiteral("lastplayed:>30d") << QList<int>{1, 5};
+    QTest::newRow("age range") << QStringLiteral("lastplayed:1w..2m") << QList<int>{1, 6};
+    QTest::newRow("age hours") << QStringLiteral("lastplayed:..6h") << QList<int>{4};
+    QTest::newRow("age years") << QStringLiteral("lastplayed:>1y") << QList<int>{5};
+
+    // Text terms: substrings, ignoring case
+    QTest::newRow("title") << QStringLiteral("title:steps") << QList<int>{3};
+    QTest::newRow("bare word") << QStringLiteral("daft") << QList<int>{0, 1, 7};
+    QTest::newRow("bare words") << QStringLiteral("daft -tribute") << QList<int>{0, 1};
+
+    // AND, OR, NOT and grouping
+    QTest::newRow("implicit and") << QStringLiteral("genre:house year:<2005") << QList<int>{0, 1};
+    QTest::newRow("explicit and") << QStringLiteral("artist:air AND year:1998") << QList<int>{6};
+    QTest::newRow("or") << QStringLiteral("genre:jazz OR genre:electronic") << QList<int>{2, 3, 6};
+    QTest::newRow("and binds tighter") << QStringLiteral("genre:jazz OR genre:blues playcount:>5")
+                                       << QList<int>{2, 3, 4};
+    QTest::newRow("parentheses") << QStringLiteral("(genre:jazz OR genre:blues) AND playcount:>5")
+                                 << QList<int>{2, 4};
+    QTest::newRow("dash") << QStringLiteral("-genre:house") << QList<int>{2, 3, 4, 5, 6};
+    QTest::newRow("not") << QStringLiteral("NOT genre:house year:<1990") << QList<int>{2, 3, 4, 5};
+    QTest::newRow("not group") << QStringLiteral("NOT (genre:jazz OR genre:blues)") << QList<int>{0, 1, 6, 7};
+    QTest::newRow("double not") << QStringLiteral("NOT -genre:jazz") << QList<int>{2, 3};
+    QTest::newRow("not range") << QStringLiteral("-year:1960..2000") << QList<int>{0, 2, 7};
+    QTest::newRow("indexed and residual") << QStringLiteral("genre:blues title:blues") << QList<int>{4};
+    QTest::newRow("nested") << QStringLiteral("(artist:\"daft punk\" OR (genre:blues -lastplayed:>1y)) played:<=7d")
+                            << QList<int>{0, 4};
+    QTest::newRow("lowercase keywords are words") << QStringLiteral("jazz or blues") << QList<int>{};
+}
+
+void TestTrackFilter::expressions()
+{
+    QFETCH(QString, expression);
+    QFETCH(QList<int>, expected);
+
+    const TrackFilter filter(expression);
+    QVERIFY2(filter.isValid(), qPrintable(filter.errorString()));
+    QCOMPARE(selected(filter), expected);
+    QCOMPARE(scanned(filter), expected);
+}
+
+void TestTrackFilter::lastPlayedDates()
+{
+    // A date stands for the whole day, in local time
+    const QString day = m_now.addDays(-2).date().toString(Qt::ISODate);
+    const TrackFilter onDay(QStringLiteral("lastplayed:%1").arg(day));
+    QVERIFY2(onDay.isValid(), qPrintable(onDay.errorString()));
+    QCOMPARE(selected(onDay), QList<int>{0});
+    QCOMPARE(scanned(onDay), QList<int>{0});
+
+    const QString since = m_now.addDays(-11).date().toString(Qt::ISODate);
+    const TrackFilter sinceDay(QStringLiteral("lastplayed:>=%1").arg(since));
+    QCOMPARE(selected(sinceDay), (QList<int>{0, 4, 6}));
+    QCOMPARE(scanned(sinceDay), (QList<int>{0, 4, 6}));
+
+    const TrackFilter between(QStringLiteral("lastplayed:%1..%2").arg(since, day));
+    QCOMPARE(selected(between), (QList<int>{0, 6}));
+}
+
+void TestTrackFilter::sidebarNames()
+{
+    const TrackFilter all(QStringLiteral("All Tracks"));
+    QVERIFY(all.isValid());
+    QVERIFY(all.matchesAll());
+    QCOMPARE(all.name(), QStringLiteral("All Tracks"));
+    QCOMPARE(selected(all).size(), static_cast<qsizetype>(m_store.size()));
+
+    QVERIFY(TrackFilter(QStringLiteral("Albums")).matchesAll());
+    QCOMPARE(selected(TrackFilter(QStringLiteral("Favorites"))), (QList<int>{0, 2, 4, 6}));
+    QCOMPARE(selected(TrackFilter(QStringLiteral("Recently Played"))), (QList<int>{0, 4}));
+}
+
+void TestTrackFilter::selectKeepsToCandidates()
+{
+    const TrackFilter filter(QStringLiteral("genre:house OR genre:blues"));
+    const std::vector<int> candidates = {1, 2, 4, 7};
+    QCOMPARE(filter.select(m_store, m_index, candidates), (std::vector<int>{1, 4, 7}));
+
+    const TrackFilter residual(QStringLiteral("-title:the"));
+    QCOMPARE(residual.select(m_store, m_index, candidates), (std::vector<int>{1, 2}));
+    QVERIFY(residual.select(m_store, m_index, {}).empty());
+}
+
+// ==================== Errors ====================
+
+void TestTrackFilter::errors_data()
+{
+    QTest::addColumn<QString>("expression");
+
+    QTest::newRow("unknown field") << QStringLiteral("composer:bach");
+    QTest::newRow("bad number") << QStringLiteral("year:nineties");
+    QTest::newRow("bad age unit") << QStringLiteral("lastplayed:3x");
+    QTest::newRow("mixed date and age") << QStringLiteral("lastplayed:2020-01-01..30d");
+    QTest::newRow("missing close") << QStringLiteral("(genre:jazz OR genre:blues");
+    QTest::newRow("stray close") << QStringLiteral("genre:jazz)");
+    QTest::newRow("dangling or") << QStringLiteral("genre:jazz OR");
+    QTest::newRow("dangling not") << QStringLiteral("genre:jazz NOT");
+}
+
+void TestTrackFilter::errors()
+{
+    QFETCH(QString, expression);
+
+    // A broken filter reports why and hides nothing
+    const TrackFilter filter(expression);
+    QVERIFY(!filter.isValid());
+    QVERIFY(!filter.errorString().isEmpty());
+    QVERIFY(filter.matchesAll());
+    QCOMPARE(selected(filter).size(), static_cast<qsizetype>(m_store.size()));
+}
+
+QTEST_GUILESS_MAIN(TestTrackFilter)
+#include "tst_trackfilter.moc"
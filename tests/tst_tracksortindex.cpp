@@ -0,0 +1,195 @@
+#include <QThreadPool>
+#include <QtTest>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include "TrackSortIndex.h"
+
+class TestTrackSortIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void denseRanksShareTies();
+    void ranksFollowInsertAndRemove();
+    void multiKeySortIsStable();
+    void singleChunkSortIsStable();
+    void cancelledSortReturnsEmpty();
+
+private:
+    // Keys laid out as LibraryQuery does: rank per key, negated when descending
+    std::vector<int> sortKeys(TrackSortIndex& index, const TrackSortIndex::SortSpec& spec,
+                              const std::vector<int>& rows);
+    // Reference order: std::stable_sort on the fields themselves
+    std::vector<int> referenceOrder(const TrackSortIndex& index, const TrackSortIndex::SortSpec& spec,
+                                    const std::vector<int>& rows) const;
+    std::vector<int> allSlots() const;
+
+    std::vector<Track> m_store;
+    QThreadPool m_pool;
+};
+
+void TestTrackSortIndex::initTestCase()
+{
+    // Few distinct values per field, so most rows tie on one key or more
+    const char* const artists[] = {"Abba", "Beck", "Cher", "Dido", "Eels"};
+    const char* const albums[] = {"Gold", "Odelay", "Believe", "No Angel"};
+
+    m_store.reserve(40000);
+    for (int i = 0; i < 40000; ++i) {
+        Track track(QStringLiteral("/music/%1.mp3").arg(i), QStringLiteral("Song %1").arg(i % 97),
+                    QString::fromLatin1(artists[(i * 7) % 5]));
+        track.setAlbum(QString::fromLatin1(albums[(i / 3) % 4]));
+        track.setYear(1990 + (i * 13) % 11);
+        track.setTrackNumber(1 + i % 12);
+        m_store.push_back(track);
+    }
+
+    m_pool.setMaxThreadCount(4);
+}
+
+std::vector<int> TestTrackSortIndex::allSlots() const
+{
+    std::vector<int> all(m_store.size());
+    for (size_t slot = 0; slot < all.size(); ++slot) {
+        all[slot] = static_cast<int>(slot);
+    }
+    return all;
+}
+
+std::vector<int> TestTrackSortIndex::sortKeys(TrackSortIndex& index, const TrackSortIndex::SortSpec& spec,
+                                              const std::vector<int>& rows)
+{
+    const int keyCount = static_cast<int>(spec.size());
+    std::vector<int> keys(rows.size() * keyCount);
+    for (int k = 0; k < keyCount; ++k) {
+        const std::vector<int> ranks = index.denseRanks(spec[k].field);
+        const int sign = spec[k].descending ? -1 : 1;
+        for (size_t row = 0; row < rows.size(); ++row) {
+            keys[row * keyCount + k] = sign * ranks[rows[row]];
+        }
+    }
+    return keys;
+}
+
+std::vector<int> TestTrackSortIndex::referenceOrder(const TrackSortIndex& index, const TrackSortIndex::SortSpec& spec,
+                                                    const std::vector<int>& rows) const
+{
+    std::vector<int> order(rows.size());
+    for (size_t row = 0; row < order.size(); ++row) {
+        order[row] = static_cast<int>(row);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        for (const TrackSortIndex::SortKey& key : spec) {
+            const int c = index.compare(key.field, rows[a], rows[b]);
+            if (c != 0)
+                return key.descending ? c > 0 : c < 0;
+        }
+        return false;
+    });
+    return order;
+}
+
+void TestTrackSortIndex::denseRanksShareTies()
+{
+    TrackSortIndex index(m_store);
+    index.insert(allSlots());
+
+    const std::vector<int> ranks = index.denseRanks(TrackSortIndex::Artist);
+    QCOMPARE(*std::max_element(ranks.begin(), ranks.end()), 4);
+    for (int slot = 1; slot < 200; ++slot) {
+        const int c = index.compare(TrackSortIndex::Artist, slot - 1, slot);
+        QCOMPARE(ranks[slot - 1] < ranks[slot], c < 0);
+        QCOMPARE(ranks[slot - 1] == ranks[slot], c == 0);
+    }
+
+    const std::vector<int> years = index.denseRanks(TrackSortIndex::Year);
+    for (int slot = 0; slot < 200; ++slot) {
+        QCOMPARE(years[slot], m_store[slot].year() - 1990);
+    }
+}
+
+void TestTrackSortIndex::ranksFollowInsertAndRemove()
+{
+    // The cached permutation is merged and filtered, never rebuilt
+    TrackSortIndex index(m_store);
+    std::vector<int> first;
+    std::vector<int> second;
+    for (int slot = 0; slot < 1000; ++slot) {
+        (slot % 3 ? first : second).push_back(slot);
+    }
+    index.insert(first);
+    index.denseRanks(TrackSortIndex::Title);
+    index.insert(second);
+    index.remove({5, 6, 7});
+
+    const std::vector<int> ranks = index.denseRanks(TrackSortIndex::Title);
+    for (int a = 0; a < 1000; a += 37) {
+        for (int b = 0; b < 1000; b += 41) {
+            if (a >= 5 && a <= 7)
+                continue;
+            if (b >= 5 && b <= 7)
+                continue;
+            const int c = index.compare(TrackSortIndex::Title, a, b);
+            QCOMPARE(ranks[a] < ranks[b], c < 0);
+            QCOMPARE(ranks[a] == ranks[b], c == 0);
+        }
+    }
+}
+
+void TestTrackSortIndex::multiKeySortIsStable()
+{
+    TrackSortIndex index(m_store);
+    index.insert(allSlots());
+
+    // Every other slot, so rows and slots differ
+    std::vector<int> rows;
+    for (int slot = 0; slot < static_cast<int>(m_store.size()); slot += 2) {
+        rows.push_back(slot);
+    }
+
+    const TrackSortIndex::SortSpec spec = {
+        {TrackSortIndex::Artist, false},
+        {TrackSortIndex::Year, true},
+        {TrackSortIndex::Album, false},
+    };
+    const std::vector<int> keys = sortKeys(index, spec, rows);
+    const int rowCount = static_cast<int>(rows.size());
+
+    const std::vector<int> order = TrackSortIndex::parallelStableSort(keys, 3, rowCount, &m_pool, nullptr);
+    QVERIFY(order == referenceOrder(index, spec, rows));
+}
+
+void TestTrackSortIndex::singleChunkSortIsStable()
+{
+    TrackSortIndex index(m_store);
+    index.insert(allSlots());
+
+    std::vector<int> rows = allSlots();
+    rows.resize(500);
+    const TrackSortIndex::SortSpec spec = {
+        {TrackSortIndex::TrackNumber, true},
+        {TrackSortIndex::Artist, false},
+    };
+    const std::vector<int> keys = sortKeys(index, spec, rows);
+
+    const std::vector<int> order = TrackSortIndex::parallelStableSort(keys, 2, 500, &m_pool, nullptr);
+    QVERIFY(order == referenceOrder(index, spec, rows));
+}
+
+void TestTrackSortIndex::cancelledSortReturnsEmpty()
+{
+    const int rowCount = static_cast<int>(m_store.size());
+    std::vector<int> keys(rowCount);
+    for (int row = 0; row < rowCount; ++row) {
+        keys[row] = (row * 31) % 101;
+    }
+
+    const std::atomic<bool> cancelled{true};
+    QVERIFY(TrackSortIndex::parallelStableSort(keys, 1, rowCount, &m_pool, &cancelled).empty());
+}
+
+QTEST_GUILESS_MAIN(TestTrackSortIndex)
+#include "tst_tracksortindex.moc"